@@ -0,0 +1,25 @@
+#ifndef ASM_H
+#define ASM_H
+
+#include <stddef.h>
+
+#include "common.h"
+#include "strbuf.h"
+
+// turns the assembly in `src` into a bytecode file, which the caller frees;
+// see src/asm/asm.c for the syntax.  if the assembly is malformed, the
+// first mistake is reported against `fname` and NULL is returned.
+uint8_t *assemble(const char *fname, const char *src, size_t *length);
+
+// writes the assembly for the synthetic workload `kind` to `buf`, shaped
+// by `params`, which are `key=value` pairs; see src/asm/gen.c for the
+// workloads and what they take.  unknown workloads or parameters are
+// reported, and make it return false.
+bool generateWorkload(
+  StrBuf *buf,
+  const char *kind,
+  const char **params,
+  int paramCount
+);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "common.h"
+
+// a microbenchmark.  `setup` builds whatever state `run` needs for the
+// size `param` and says how many operations one call to `run` performs,
+// so that times come out per operation; `teardown` frees that state.
+typedef struct {
+  const char *name;
+  uint32_t param;
+
+  void *(*setup)(uint32_t param, uint32_t *ops);
+  void (*run)(void *state);
+  void (*teardown)(void *state);
+} Bench;
+
+// a result read back from an earlier --json run.
+typedef struct {
+  char *name;
+  double p50;
+} Baseline;
+
+typedef struct {
+  // only benchmarks whose name contains this run, if it isn’t NULL.
+  const char *filter;
+  uint32_t reps;
+  bool isJson;
+
+  // with --compare, the results of the run being compared against, and
+  // how much slower than them (in percent) counts as a regression.
+  Baseline *baselines;
+  uint32_t baselineCount;
+  uint32_t baselineCap;
+  double threshold;
+
+  uint32_t resultCount;
+  uint32_t regressions;
+} BenchRun;
+
+void initBenchRun(BenchRun *run);
+
+// reads the results of an earlier `neve-bench --json` from `fname`.
+bool readBaselines(BenchRun *run, const char *fname);
+
+void beginBenchRun(BenchRun *run);
+void endBenchRun(BenchRun *run);
+
+void runBench(BenchRun *run, const Bench *bench);
+
+// like runBench(), but `ops` counts bytes and the results come out in
+// GB/s, where higher is better.
+void runRateBench(BenchRun *run, const Bench *bench);
+
+// reports something that isn’t a time, such as an average probe length.
+// lower is taken to be better, same as times.
+void reportStat(
+  BenchRun *run,
+  const char *name,
+  const char *unit,
+  double value
+);
+
+// whether a benchmark or stat called `name` is to run at all.
+bool isBenchSelected(BenchRun *run, const char *name);
+
+void freeBenchRun(BenchRun *run);
+
+// keeps the compiler from optimizing away what a benchmark computes.
+void benchSink(uint64_t value);
+
+// a fast deterministic generator, so every run sees the same inputs.
+uint64_t benchRand(uint64_t *state);
+
+// the suites, one per subsystem.
+void hashBenches(BenchRun *run);
+void tableBenches(BenchRun *run);
+void strBenches(BenchRun *run);
+void constBenches(BenchRun *run);
+void dispatchBenches(BenchRun *run);
+void utf8Benches(BenchRun *run);
+
+#endif
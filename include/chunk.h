@@ -45,6 +45,12 @@ typedef enum {
   OP_TABLEGET,      // tableget rA rB rC: retrieves the value associated with the rC key in the rB table and stores it in rA
 
   OP_RET,           // ret      rA: (right now) prints the value in rA and halts
+
+  OP_CONCATN,       // concatn  rA rB C: concatenates the C registers starting at rB, showing non-strings, and stores the result in rA
+  OP_INTERP,        // interp   rA B rC: replaces each "{}" in the template constant B with rC, rC+1, ... and stores the result in rA
+  OP_SLICE,         // slice    rA rB rC rD: takes the code points of rB from index rC up to (but not including) rD and stores them in rA
+  OP_CHARAT,        // charat   rA rB rC: stores the code point at index rC of rB in rA as a string, or nil if there isn't one
+  OP_STRLEN,        // strlen   rA rB: stores the length of rB in code points in rA
 } OpCode;
 
 typedef struct {
@@ -81,4 +87,7 @@ void freeLineArr(LineArr *arr);
 
 int getLine(Chunk *ch, uint32_t offset);
 
+// the mnemonic in the comments above, or "?" if `op` isn’t an opcode.
+const char *opName(OpCode op);
+
 #endif
@@ -19,7 +19,21 @@
 
 #define MAX_INTERNED_STR_SIZE 128
 
+// concatenations at least this long become ropes instead of being copied.
+// it must stay above MAX_INTERNED_STR_SIZE, since interning needs the bytes
+// right away.
+#define MIN_ROPE_SIZE 256
+
+// tables probe with Swiss-table groups unless this is defined, in which 
+// case they use plain linear probing with tombstones.  it can also be 
+// passed with -D, see the README.
+// #define TABLE_LINEAR_PROBE
+
+// neve-bench measures the VM, and neve-test checks it, without any 
+// tracing.
+#if !defined(NEVE_BENCH) && !defined(NEVE_TEST)
 #define DEBUG_EXEC
 #define DEBUG_COMPILE
+#endif
 
 #endif
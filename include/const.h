@@ -7,6 +7,15 @@
 #include "vm.h"
 #include "obj.h"
 
+// object tags as they appear in the constant header (see bytecode_layout.md).
+// they are kept apart from `ObjType` so that the runtime representation can 
+// change without breaking existing bytecode files.
+typedef enum {
+  CONST_OBJ_STR,
+  CONST_OBJ_USTR,
+  CONST_OBJ_TABLE
+} ConstObjTag;
+
 bool readConsts(
   NeveVM *vm, 
   ValArr *arr, 
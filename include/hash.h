@@ -0,0 +1,14 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include "common.h"
+
+// picks this run’s hash seed; must be called before anything is hashed.
+// the seed only changes hash values, never what the program prints, since
+// tables iterate in insertion order.
+void initHashSeed(void);
+
+uint32_t hashBytes(const char *bytes, uint32_t length);
+uint32_t hashBits(uint64_t bits);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "common.h"
+#include "str.h"
+#include "strbuf.h"
+
+// NOLINTBEGIN
+#define MAX_SRC_PATH_LENGTH 4096
+// NOLINTEND
+
+// what’s left of the debug header for offset/line pairs once the longest
+// path, the last offset and the separator are in.  lines past that share
+// the last pair.
+#define MAX_LINES_LENGTH (                                  \
+  UINT16_MAX - sizeof (uint16_t) - MAX_SRC_PATH_LENGTH -    \
+  sizeof (uint32_t) - 1                                     \
+)
+
+// a bytecode file being put together in memory, in the layout described in
+// bytecode_layout.md.  constants and code can be written in any order,
+// since they go in separate buffers until finishImage() lays them out.
+typedef struct {
+  StrBuf consts;
+  StrBuf lines;
+  StrBuf code;
+
+  // the line the code written last came from, so that imageLine() only
+  // records changes.
+  uint32_t line;
+} Image;
+
+void initImage(Image *image);
+
+void imageNum(Image *image, double num);
+void imageBool(Image *image, bool boolean);
+void imageNil(Image *image);
+
+// plain strings are UTF-8, counted when they’re loaded; imageUStr() takes
+// any encoding.
+void imageStr(
+  Image *image,
+  const char *chars,
+  uint32_t byteLength,
+  bool isInterned
+);
+
+void imageUStr(
+  Image *image,
+  Encoding encoding,
+  const char *chars,
+  uint32_t length,
+  uint32_t byteLength,
+  bool isInterned
+);
+
+// the header of a table constant; its `count` keys and values are written
+// next, as constants of their own, alternating.
+void imageTable(Image *image, uint32_t count);
+
+// how many bytes of code have been written so far.
+uint32_t imageCodeOffset(Image *image);
+
+// code written from here on came from source line `line`.  the debug
+// header’s length only takes two bytes, so once it’s full, the rest of the
+// code stays on the last line recorded.
+void imageLine(Image *image, uint32_t line);
+
+void imageByte(Image *image, uint8_t byte);
+
+// the whole file, which the caller frees, with the debug header pointing at
+// `srcPath`, which must be shorter than MAX_SRC_PATH_LENGTH.  `image` is
+// left empty.
+uint8_t *finishImage(Image *image, const char *srcPath, size_t *length);
+
+void freeImage(Image *image);
+
+#endif
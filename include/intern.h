@@ -0,0 +1,40 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "str.h"
+#include "val.h"
+
+// each slot carries a copy of its string’s hash and byte length, so a probe
+// can reject almost every candidate without dereferencing the string.
+typedef struct {
+  uint32_t hash;
+  uint32_t byteLength;
+
+  ObjStr *str;
+} InternSlot;
+
+// the set of interned strings.  strings are never removed from it while 
+// the VM is alive, so there are no tombstones to deal with: a slot is 
+// either empty or holds a string.
+typedef struct {
+  uint32_t cap;
+  uint32_t count;
+
+  InternSlot *slots;
+} InternSet;
+
+void initInternSet(InternSet *set);
+
+ObjStr *internSetFind(
+  InternSet *set,
+  const char *chars,
+  Encoding encoding,
+  uint32_t byteLength,
+  uint32_t hash
+);
+
+void internSetAdd(InternSet *set, ObjStr *str);
+
+void freeInternSet(InternSet *set);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef NUM_H
+#define NUM_H
+
+#include "common.h"
+
+// enough for any number numAsStr() writes, e.g. "-2.2250738585072014e-308".
+#define NUM_STR_MAX 32
+
+// numbers are written with the fewest digits that still read back as the
+// same double, laid out the way printf’s "%.14g" would lay them out.
+uint32_t numAsStr(char *buffer, double num);
+
+#endif
@@ -8,51 +8,116 @@
 #define OBJ_TYPE(val)     (VAL_AS_OBJ(val)->type)
 
 #define VAL_AS_STR(val)   ((ObjStr *)VAL_AS_OBJ(val))
-#define VAL_AS_USTR(val)  ((ObjUStr *)VAL_AS_OBJ(val))
 #define VAL_AS_CSTR(val)  (((ObjStr *)VAL_AS_OBJ(val))->chars)
 
 #define VAL_AS_TABLE(val) ((ObjTable *)VAL_AS_OBJ(val))
 
+// bits in `Obj.flags` for strings.  the lowest two bits hold the
+// string’s `Encoding`.
+#define STR_ENCODING_MASK 0x03
+#define STR_OWNS_CHARS    0x04
+#define STR_INTERNED      0x08
+#define STR_ROPE          0x10
+#define STR_SLICE         0x20
+
+#define STR_ENCODING(str)   ((Encoding)((str)->obj.flags & STR_ENCODING_MASK))
+#define IS_STR_OWNING(str)  (((str)->obj.flags & STR_OWNS_CHARS) != 0)
+#define IS_STR_INTERNED(str) (((str)->obj.flags & STR_INTERNED) != 0)
+#define IS_STR_ROPE(str)    (((str)->obj.flags & STR_ROPE) != 0)
+#define IS_STR_SLICE(str)   (((str)->obj.flags & STR_SLICE) != 0)
+#define IS_STR_FLAT(str)    ((str)->chars != NULL)
+
+#define IS_VAL_STR(val)     (IS_VAL_OBJ(val) && OBJ_TYPE(val) == OBJ_STR)
+
+// bits in `Obj.flags` for tables.  constant tables are never written to;
+// pushing one hands out a shared table that borrows its storage until 
+// the first write, which copies it.  reading doesn’t count, not even 
+// reading a nested constant table out of it, see TableShare.
+#define TABLE_CONST  0x01
+#define TABLE_SHARED 0x02
+
+#define IS_TABLE_CONST(table)  (((table)->obj.flags & TABLE_CONST) != 0)
+#define IS_TABLE_SHARED(table) (((table)->obj.flags & TABLE_SHARED) != 0)
+
+#define IS_VAL_TABLE(val)   (IS_VAL_OBJ(val) && OBJ_TYPE(val) == OBJ_TABLE)
+
+// the hash of a string that hasn’t been hashed yet; hashStr() never
+// returns it.  see hashObj().
+#define STR_UNHASHED 0
+
 typedef enum {
   OBJ_STR,
-  OBJ_USTR,
   OBJ_TABLE
 } ObjType;
 
+// `type`, `flags` and `hash` all fit in what used to be padding before
+// `next`, which keeps the header at 16 bytes.
 struct Obj {
-  ObjType type;
+  uint8_t type;
+  uint8_t flags;
+
+  uint32_t hash;
 
   struct Obj *next;
 };
 
+// a single layout for every encoding.  `length` is the logical length 
+// (in code points); for ASCII strings it equals `byteLength`.
 struct ObjStr {
   Obj obj; 
 
-  uint32_t length;
-  const char *chars;
-
-  bool ownsStr;
-  uint32_t hash;
-};
-
-// OPTIMIZE: reduce the size of these structs
-struct ObjUStr {
-  Obj obj;
-
   uint32_t length;
   uint32_t byteLength;
-  const void *chars;
 
-  Encoding encoding;
+  const char *chars;
 
-  bool ownsStr;
-  uint32_t hash;
+  // where every STR_INDEX_STEP-th code point starts, NULL until
+  // strOffset() first needs it.  see strindex.h.
+  uint32_t *crumbs;
 };
 
+// a lazy concatenation of `left` and `right`.  `str.chars` stays NULL until 
+// something actually needs the bytes, at which point flattenStr() copies 
+// both sides into a single buffer and the rope behaves like any other 
+// string from then on.
+typedef struct {
+  ObjStr str;
+
+  ObjStr *left;
+  ObjStr *right;
+} ObjRope;
+
+// a substring that borrows its bytes from `parent`: `str.chars` points 
+// somewhere inside `parent->chars`.  a slice that copies its bytes out, 
+// see settleStr(), owns them and drops `parent` like a flattened rope 
+// drops its sides.  `parent` is always flat and holds its own bytes, so it
+// may be such an owning slice, but never one that still borrows.
+typedef struct {
+  ObjStr str;
+
+  ObjStr *parent;
+} ObjSlice;
+
+// what a shared table keeps track of until its first write.  reading a 
+// constant table out of it hands out a shared table for that one in 
+// turn, and every read of the same key has to get the same table, but 
+// storing it would mean copying first.  so it goes in `children` instead,
+// and only moves into the table once there’s a copy to store it in.
+typedef struct {
+  Table children;
+
+  // the shared table this one was read out of, if any.  writing to this
+  // one means writing to that one too, so it stops sharing as well.
+  ObjTable *parent;
+} TableShare;
+
 struct ObjTable {
   Obj obj;
 
   Table *table;
+
+  // NULL unless the table is shared.
+  TableShare *share;
 };
 
 /*
@@ -64,37 +129,58 @@ static inline bool isObjType(Val val, ObjType type) {
 }
 */
 
+// with `ownsStr`, `chars` is freed along with the string; it must have been
+// allocated as `byteLength + 1` bytes, the last one a '\0'.
 ObjStr *allocStr(
-  NeveVM *vm,
-  bool ownsStr,
-  bool isInterned,
-  const char *chars,
-  uint32_t length,
-  uint32_t hash
-);
-
-ObjUStr *allocUStr(
   NeveVM *vm,
   bool ownsStr,
   bool isInterned,
   Encoding encoding,
-  const void *chars,
+  const char *chars,
   uint32_t length,
   uint32_t byteLength,
   uint32_t hash
 );
 
+ObjStr *allocRope(NeveVM *vm, ObjStr *left, ObjStr *right);
+void flattenStr(ObjStr *str);
+
+// the byte offset at which code point `index` of `str` starts, or its
+// byte length if `index` is past the end.  long strings whose code points
+// vary in width get breadcrumbs for this, see strindex.h.
+uint32_t strOffset(ObjStr *str, uint32_t index);
+
+// code points `start` up to `end` of `str`, which must be in range.
+ObjStr *sliceStr(NeveVM *vm, ObjStr *str, uint32_t start, uint32_t end);
+
+// what should be stored in a table instead of `str`, which is about to 
+// outlive the registers.  see the comment in obj.c.
+ObjStr *settleStr(NeveVM *vm, ObjStr *str, bool isKey);
+
+// `str` itself if it’s already in `encoding`, and a transcoded copy if not.
+ObjStr *reencodeStr(NeveVM *vm, ObjStr *str, Encoding encoding);
+
+// appends `str` to `buf` as UTF-8, whatever its encoding.
+void strAsUtf8(StrBuf *buf, ObjStr *str);
+
 ObjTable *newTable(NeveVM *vm, uint32_t cap);
+ObjTable *shareTable(NeveVM *vm, ObjTable *table, ObjTable *parent);
+
+// a shared table for the constant table `field`, read out of `table` 
+// under `key`; the same one every time.
+Val shareField(NeveVM *vm, ObjTable *table, Val key, ObjTable *field);
+
+void unshareTable(ObjTable *table);
 
 uint32_t hashStr(const char *key, uint32_t length);
+uint32_t hashObj(Obj *obj);
 
 bool objsEq(Obj *a, Obj *b);
 
-void printObj(Val val);
+void printObj(Writer *out, Val val);
 
 void freeObj(Obj *obj);
 
-uint32_t objStrLength(Obj *obj);
-uint32_t objAsStr(const char *buffer, uint32_t size, Obj *obj);
+void objAsStr(StrBuf *buf, Obj *obj);
 
 #endif
@@ -0,0 +1,154 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "bytecode.h"
+#include "common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// NOLINTBEGIN
+// about one instruction in this many is timed; the gaps between samples
+// vary so that they don’t fall into step with repeating code.
+#define PROFILE_SAMPLE_PERIOD 16
+
+// how many of the timed instructions are kept for the line and
+// instruction tables.  once it’s full, each new one takes the place of a
+// random one, so that what’s kept stays an even sample of the whole run.
+#define PROFILE_RESERVOIR_SIZE 4096
+
+#define PROFILE_OPCODES 256
+// NOLINTEND
+
+#define NO_SAMPLE UINT32_MAX
+
+typedef struct {
+  uint32_t offset;
+  uint32_t ticks;
+} Sample;
+
+// what `neve --profile` collects while the VM runs: how often each opcode
+// ran, and how long a sample of the instructions took.  times are in TSC
+// ticks where there’s a TSC, and nanoseconds elsewhere.
+typedef struct {
+  const uint8_t *code;
+
+  // exact counts, and running totals of the samples, per opcode.
+  uint64_t opCounts[PROFILE_OPCODES];
+  uint64_t opSamples[PROFILE_OPCODES];
+  uint64_t opTicks[PROFILE_OPCODES];
+
+  // how many instructions were timed, and the ones kept of those.
+  uint64_t sampleCount;
+  uint32_t keptCount;
+  Sample kept[PROFILE_RESERVOIR_SIZE];
+
+  // what reading the clock twice costs on its own, which every sample
+  // would otherwise include.
+  uint64_t tickOverhead;
+
+  // the instruction being timed, if any, and when it started.
+  uint32_t sampledOffset;
+  uint8_t sampledOp;
+  uint64_t sampleStart;
+
+  uint32_t countdown;
+  uint64_t rand;
+} Profile;
+
+void initProfile(Profile *profile);
+
+// gets ready to profile `code`, which is about to run.
+void startProfile(Profile *profile, const uint8_t *code);
+
+// writes the report to stderr, mapping offsets back to source lines
+// through the debug header in `bytecode`.
+void reportProfile(Profile *profile, Bytecode *bytecode);
+
+static inline uint64_t profileTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  // NOLINTNEXTLINE
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// xorshift64.
+static inline uint64_t profileRand(Profile *profile) {
+  // NOLINTBEGIN
+  profile->rand ^= profile->rand << 13;
+  profile->rand ^= profile->rand >> 7;
+  profile->rand ^= profile->rand << 17;
+  // NOLINTEND
+
+  return profile->rand;
+}
+
+// spread evenly between 1 and twice the period.
+static inline uint32_t nextSamplePeriod(Profile *profile) {
+  const uint64_t rand = profileRand(profile);
+  return 1 + (uint32_t)(rand % (2 * PROFILE_SAMPLE_PERIOD - 1));
+}
+
+static inline void keepSample(Profile *profile, uint64_t ticks) {
+  ticks = ticks > profile->tickOverhead ? ticks - profile->tickOverhead : 0;
+
+  profile->opSamples[profile->sampledOp]++;
+  profile->opTicks[profile->sampledOp] += ticks;
+
+  const Sample sample = {
+    profile->sampledOffset,
+    ticks > UINT32_MAX ? UINT32_MAX : (uint32_t)ticks
+  };
+
+  const uint64_t seen = profile->sampleCount++;
+
+  if (profile->keptCount < PROFILE_RESERVOIR_SIZE) {
+    profile->kept[profile->keptCount++] = sample;
+    return;
+  }
+
+  const uint64_t slot = profileRand(profile) % (seen + 1);
+
+  if (slot < PROFILE_RESERVOIR_SIZE) {
+    profile->kept[slot] = sample;
+  }
+}
+
+// called by the VM before it runs the instruction at `offset`.  all it
+// does most of the time is count; the countdown runs out once to start
+// timing an instruction, and once more when the next one starts.
+static inline void profileInstr(
+  Profile *profile,
+  uint8_t op,
+  uint32_t offset
+) {
+  profile->opCounts[op]++;
+
+  if (--profile->countdown != 0) {
+    return;
+  }
+
+  if (profile->sampledOffset == NO_SAMPLE) {
+    profile->sampledOffset = offset;
+    profile->sampledOp = op;
+    profile->countdown = 1;
+
+    profile->sampleStart = profileTicks();
+    return;
+  }
+
+  keepSample(profile, profileTicks() - profile->sampleStart);
+
+  profile->sampledOffset = NO_SAMPLE;
+  profile->countdown = nextSamplePeriod(profile);
+}
+
+#endif
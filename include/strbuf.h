@@ -0,0 +1,50 @@
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include <string.h>
+
+#include "common.h"
+
+// a growable buffer that values are written into one after the other, so
+// that stringifying something takes a single pass over it.
+typedef struct {
+  uint32_t length;
+  uint32_t cap;
+
+  char *chars;
+} StrBuf;
+
+void initStrBuf(StrBuf *buf, uint32_t cap);
+
+void strBufGrow(StrBuf *buf, uint32_t minCap);
+
+// makes room for up to `length` more bytes and returns where they go; the
+// caller then adds however many it wrote to `buf->length`.
+static inline char *strBufReserve(StrBuf *buf, uint32_t length) {
+  if (buf->length + length > buf->cap) {
+    strBufGrow(buf, buf->length + length);
+  }
+
+  return &buf->chars[buf->length];
+}
+
+static inline void strBufAppend(
+  StrBuf *buf,
+  const char *chars,
+  uint32_t length
+) {
+  memcpy(strBufReserve(buf, length), chars, length);
+  buf->length += length;
+}
+
+// for string literals, whose length is known up front.
+#define STR_BUF_APPEND_LIT(buf, lit)                        \
+  strBufAppend((buf), (lit), (uint32_t)(sizeof (lit) - 1))
+
+// hands over the bytes, trimmed to fit and NUL-terminated, and leaves 
+// `buf` empty.
+char *strBufTake(StrBuf *buf);
+
+void freeStrBuf(StrBuf *buf);
+
+#endif
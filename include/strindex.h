@@ -0,0 +1,22 @@
+#ifndef STRINDEX_H
+#define STRINDEX_H
+
+#include "common.h"
+#include "val.h"
+
+// breadcrumbs are left every this many code points.
+#define STR_INDEX_STEP 64
+
+// how many breadcrumbs a string of `length` code points gets: code point
+// `k * STR_INDEX_STEP` starts at `crumbs[k]`.
+#define STR_CRUMB_COUNT(length)                                  \
+  (((length) + STR_INDEX_STEP - 1) / STR_INDEX_STEP)
+
+// the byte offset of code point `codePoint` of `str`, which must be flat
+// and longer than that.  the breadcrumbs are built the first time they’re
+// needed and stay on the string until it’s freed.
+uint32_t strIndexOffset(ObjStr *str, uint32_t codePoint);
+
+void freeStrIndex(ObjStr *str);
+
+#endif
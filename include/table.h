@@ -8,41 +8,99 @@ typedef struct {
   Val key;
 
   Val val;
+
+  // the key’s hash, kept so that rehashing never has to touch the key and
+  // most mismatching probes fail on an integer compare.
+  uint32_t hash;
 } Entry;
 
+#ifndef TABLE_LINEAR_PROBE
+#define TABLE_SWISS
+#endif
+
+// tables have an array part for keys that are small non-negative integers
+// and a hash part for everything else.  the array part is sized so that 
+// more than half of it is used, and keys move between the two parts 
+// whenever the hash part is resized.
+//
+// the hash part is a Swiss-table-style hash table.  every slot has a 
+// control byte in `ctrl` telling whether it’s empty, deleted or full--in
+// which case it also holds 7 bits of the key’s hash--so probing can scan 
+// whole groups of control bytes at once and only touch `entries` on a 
+// likely match.  TABLE_LINEAR_PROBE keeps the plain linear probing the 
+// Swiss table replaced, one slot at a time, so that the two can still be
+// benchmarked against each other.
+//
+// either way, the slots only hold an index into `entries`, which are kept
+// densely in insertion order.  that’s the order tables print in, and it
+// lets iteration skip straight over the slots.
 typedef struct {
+  // live entries, in both parts.
+  uint32_t count;
+
+  uint32_t arrCap;
+  uint32_t arrCount;
+
+  // missing keys are EMPTY_VAL.
+  Val *arr;
+
   uint32_t cap;
+
+  // used entries, live or deleted; this is what the load factor counts.
   uint32_t next; 
 
+  uint32_t entryCap;
+
+#if defined(TABLE_LINEAR_PROBE)
+  uint32_t *indices;
+#else
+  uint8_t *ctrl;
+  uint32_t *indices;
+#endif
+
+  // deleted entries stay behind as holes with an empty key until the 
+  // table is next resized.
   Entry *entries;
 } Table;
 
+// the array part’s slot for `key`, if that’s where it belongs.
+static inline Val *tableArrSlot(Table *table, Val key) {
+  if (!IS_VAL_NUM(key)) {
+    return NULL;
+  }
+
+  const double num = VAL_AS_NUM(key);
+
+  if (!(num >= 0 && num < (double)table->arrCap)) {
+    return NULL;
+  }
+
+  const uint32_t index = (uint32_t)num;
+
+  return (double)index == num ? &table->arr[index] : NULL;
+}
+
 void initTable(Table *table, uint32_t cap);
 
 bool tableSet(Table *table, Val key, Val val);
 Val tableGet(Table *table, Val key);
 bool tableDel(Table *table, Val key);
 
-ObjStr *tableFindStr(
-  Table *table,
-  const char *chars,
-  uint32_t length,
-  uint32_t hash
-);
-
-ObjUStr *tableFindUStr(
-  Table *table,
-  const void *chars,
-  Encoding encoding,
-  uint32_t length,
-  uint32_t byteLength,
-  uint32_t hash
-);
-
-void printTable(Table *table);
-
-uint32_t tableStrLength(Table *table);
-uint32_t tableAsStr(const char *buffer, uint32_t size, Table *table);
+// tables already shrink on their own after enough deletions; this squeezes
+// out every hole and spare slot right away, for tables that are done 
+// changing.
+void tableCompact(Table *table);
+
+// walks both parts, the array part first, one entry per call; `*i` 
+// starts at 0.
+bool tableNext(Table *table, uint32_t *i, Val *key, Val *val);
+
+// `into` ends up with the same entries in the same order, holes and all.
+void copyTable(Table *into, const Table *from);
+
+void printTable(Writer *out, Table *table);
+
+void tableAsStr(StrBuf *buf, Table *table);
 
 void freeTable(Table *table);
 
@@ -0,0 +1,49 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include "common.h"
+#include "vm.h"
+
+// fails the test it’s in, after saying which check it was.
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      testFailed(__FILE__, __LINE__, #cond);                          \
+      return false;                                                   \
+    }                                                                 \
+  } while (false)
+
+// a test gets a fresh VM, which is freed once it returns.
+typedef struct {
+  const char *name;
+  bool (*run)(NeveVM *vm);
+} Test;
+
+void testFailed(const char *file, int line, const char *cond);
+
+void runTests(const Test *tests, size_t count);
+
+// assembles `src` (see src/asm/asm.c) and runs it in `vm`.  its output 
+// is thrown away; whatever it leaves in the registers stays there until
+// the test returns.
+Aftermath runAsm(NeveVM *vm, const char *src);
+
+// like runAsm(), but first overwrites the first `from` in the assembled
+// bytes with `to`, which must be as long.  this gets bytecode past the
+// assembler that it would never write.
+Aftermath runPatchedAsm(
+  NeveVM *vm,
+  const char *src,
+  const char *from,
+  const char *to
+);
+
+// the suites, one per subsystem.
+void tableTests(void);
+void constTests(void);
+void strTests(void);
+void utf8Tests(void);
+void transcodeTests(void);
+void numTests(void);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TRANSCODE_H
+#define TRANSCODE_H
+
+#include "common.h"
+#include "str.h"
+
+// UTF-16 and UTF-32 strings are stored little-endian, one code unit after
+// the other in `chars`, the same way they’re laid out in bytecode.
+
+// same as validateUtf8(), for any encoding.  UTF-16 must pair up its
+// surrogates; UTF-32 can’t hold surrogates or anything past U+10FFFF.
+bool validateStr(
+  Encoding encoding,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t *length
+);
+
+// the most bytes `byteLength` bytes of `from` can take up once they’re
+// transcoded to `to`.
+size_t transcodedCap(Encoding from, Encoding to, uint32_t byteLength);
+
+// writes `chars`, which must be valid, to `into` as `to`, and returns how
+// many bytes it wrote.  `into` must have room for transcodedCap() bytes,
+// and whatever comes after the bytes written may have been scribbled on.
+uint32_t transcode(
+  Encoding from,
+  Encoding to,
+  const char *chars,
+  uint32_t byteLength,
+  char *into
+);
+
+// how many of the first `maxLength` bytes of `chars` hold whole code
+// points, so that a long string can be transcoded a chunk at a time.
+uint32_t wholeCodePoints(
+  Encoding encoding,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t maxLength
+);
+
+// the byte offset at which code point `index` of `chars` starts, or
+// `byteLength` if there aren’t that many.
+uint32_t codePointOffset(
+  Encoding encoding,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t index
+);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include "common.h"
+
+// checks that `chars` is well-formed UTF-8: no stray continuation bytes,
+// truncated or overlong sequences, surrogates, or code points past
+// U+10FFFF.  if it is, the number of code points goes in `length`.
+bool validateUtf8(const char *chars, uint32_t byteLength, uint32_t *length);
+
+// the kernels validateUtf8() picks from, slowest first.
+typedef enum {
+  UTF8_KERNEL_SCALAR,
+  UTF8_KERNEL_SSE2,
+  UTF8_KERNEL_SSSE3,
+  UTF8_KERNEL_AVX2
+} Utf8Kernel;
+
+// whether this build, on this CPU, can run `kernel`.
+bool hasUtf8Kernel(Utf8Kernel kernel);
+
+// validateUtf8() with `kernel`, which must be available, rather than the
+// fastest one.  this is for benchmarks.
+bool validateUtf8With(
+  Utf8Kernel kernel,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t *length
+);
+
+// the number of code points in `chars`, which must be valid.
+uint32_t countUtf8(const char *chars, uint32_t byteLength);
+
+#endif
@@ -2,10 +2,11 @@
 #define VAL_H
 
 #include "common.h"
+#include "strbuf.h"
+#include "writer.h"
 
 typedef struct Obj Obj;
 typedef struct ObjStr ObjStr;
-typedef struct ObjUStr ObjUStr;
 typedef struct ObjTable ObjTable;
 
 #define BOOL_VAL(val) ((Val){ VAL_BOOL, {.boolean = (val) } })
@@ -54,13 +55,12 @@ typedef struct {
 ValArr newValArr();
 void writeValArr(ValArr *arr, Val val);
 void freeValArr(ValArr *arr);
-void printVal(Val val);
+void printVal(Writer *out, Val val);
 
 uint32_t hashVal(Val val);
 
 bool valsEq(Val a, Val b);
 
-uint32_t valStrLength(Val val);
-uint32_t valAsStr(char *buffer, uint32_t size, Val val);
+void valAsStr(StrBuf *buf, Val val);
 
 #endif
@@ -3,8 +3,11 @@
 
 #include "bytecode.h"
 #include "chunk.h"
+#include "intern.h"
+#include "profile.h"
 #include "table.h"
 #include "val.h"
+#include "writer.h"
 
 #define STACK_MAX 256
 
@@ -15,8 +18,13 @@ typedef struct {
   Val regs[STACK_MAX];
   Val *top;
 
-  Table strs;
+  InternSet strs;
   Obj *objs;
+
+  Writer out;
+
+  // NULL unless the run is being profiled.
+  Profile *profile;
 } NeveVM;
 
 typedef enum {
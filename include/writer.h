@@ -0,0 +1,67 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <string.h>
+
+#include "common.h"
+
+// how much a Writer holds on to before handing it to the OS.  terminals
+// get a small buffer so output shows up promptly; pipes and files get a
+// big one, so that dumping a large table takes a handful of syscalls.
+#define WRITER_TTY_CAP (1 << 12)
+#define WRITER_CAP (1 << 16)
+
+// payloads at least this long skip the buffer altogether, and go out in
+// the same writev() call as whatever was already buffered.
+#define WRITER_DIRECT_MIN (1 << 12)
+
+// buffers output on its way to a file descriptor.  nothing reaches the
+// descriptor until the buffer fills up or writerFlush() is called.
+typedef struct {
+  int fd;
+
+  uint32_t length;
+  uint32_t cap;
+
+  char *chars;
+} Writer;
+
+void initWriter(Writer *out, int fd);
+
+void writerFlush(Writer *out);
+
+// writes out what’s buffered along with `chars`, in that order.
+void writerSpill(Writer *out, const char *chars, uint32_t length);
+
+// makes room for up to `length` more bytes, which must not exceed
+// WRITER_TTY_CAP, and returns where they go; the caller then adds
+// however many it wrote to `out->length`.
+static inline char *writerReserve(Writer *out, uint32_t length) {
+  if (out->length + length > out->cap) {
+    writerFlush(out);
+  }
+
+  return &out->chars[out->length];
+}
+
+static inline void writerAppend(
+  Writer *out,
+  const char *chars,
+  uint32_t length
+) {
+  if (out->length + length > out->cap || length >= WRITER_DIRECT_MIN) {
+    writerSpill(out, chars, length);
+    return;
+  }
+
+  memcpy(&out->chars[out->length], chars, length);
+  out->length += length;
+}
+
+#define WRITER_APPEND_LIT(out, lit)                         \
+  writerAppend((out), (lit), (uint32_t)(sizeof (lit) - 1))
+
+// flushes whatever is left.
+void freeWriter(Writer *out);
+
+#endif
@@ -0,0 +1,865 @@
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm.h"
+#include "chunk.h"
+#include "err.h"
+#include "hash.h"
+#include "image.h"
+#include "mem.h"
+#include "transcode.h"
+#include "utf8.h"
+
+// the assembly is line based: each line holds at most one directive or
+// instruction, and `;` starts a comment that runs to the end of it.
+//
+//   .src "/abs/path/prog.ne"   the source file the debug header points at
+//   .line 12                   the code that follows came from line 12
+//   .const greeting "hi"       adds a constant, which may be named
+//   .const 1.5
+//
+//   push r0 greeting           constants go by name, or by index: #1
+//   add r2 r0 r1
+//   concatn r3 r0 2            counts are plain numbers
+//
+// mnemonics and operands are the ones in chunk.h.  constants are numbers,
+// `true`, `false`, `nil`, strings and tables, `{key: val, ...}`, which may
+// span lines.  strings are UTF-8 unless prefixed with `u16` or `u32`, and
+// take the escapes \n, \t, \r, \0, \\, \", \xHH and \u{HHHH}.
+//
+// `push` falls back to `pushlong` once the constant’s index doesn’t fit in
+// a byte.  without `.src` or `.line`, the debug header maps each
+// instruction to its line in the assembly, so runtime errors point there.
+
+// NOLINTBEGIN
+#define MAX_OPERANDS     4
+#define MAX_WORD_LENGTH  64
+#define MAX_ERR_LENGTH   256
+#define MAX_LONG_CONST   0xFFFFFF
+#define MIN_NAMES_CAP    64
+// NOLINTEND
+
+// `operands` has a letter per operand: `r` for a register, `c` for a
+// constant that fits in a byte, `l` for one that takes three, and `n` for
+// a plain count.
+typedef struct {
+  OpCode op;
+  const char *operands;
+} InstrInfo;
+
+static const InstrInfo instrs[] = {
+  {OP_PUSH, "rc"},
+  {OP_PUSHLONG, "rl"},
+  {OP_TRUE, "r"},
+  {OP_FALSE, "r"},
+  {OP_NIL, "r"},
+  {OP_ZERO, "r"},
+  {OP_ONE, "r"},
+  {OP_MINUSONE, "r"},
+  {OP_NEG, "rr"},
+  {OP_NOT, "rr"},
+  {OP_ISNIL, "rr"},
+  {OP_ISNOTNIL, "rr"},
+  {OP_ISZ, "rr"},
+  {OP_SHOW, "rr"},
+  {OP_ADD, "rrr"},
+  {OP_SUB, "rrr"},
+  {OP_MUL, "rrr"},
+  {OP_DIV, "rrr"},
+  {OP_SHL, "rrr"},
+  {OP_SHR, "rrr"},
+  {OP_BAND, "rrr"},
+  {OP_XOR, "rrr"},
+  {OP_BOR, "rrr"},
+  {OP_NEQ, "rrr"},
+  {OP_EQ, "rrr"},
+  {OP_GT, "rrr"},
+  {OP_LT, "rrr"},
+  {OP_GTE, "rrr"},
+  {OP_LTE, "rrr"},
+  {OP_CONCAT, "rrr"},
+  {OP_UCONCAT, "rrr"},
+  {OP_TABLENEW, "r"},
+  {OP_TABLESET, "rrr"},
+  {OP_TABLEGET, "rrr"},
+  {OP_RET, "r"},
+  {OP_CONCATN, "rrn"},
+  {OP_INTERP, "rcr"},
+  {OP_SLICE, "rrrr"},
+  {OP_CHARAT, "rrr"},
+  {OP_STRLEN, "rr"}
+};
+
+typedef struct {
+  const char *chars;
+  uint32_t length;
+} Word;
+
+typedef struct {
+  Word name;
+  uint32_t index;
+} ConstName;
+
+// open addressing over the names’ hashes; names are never removed.
+typedef struct {
+  uint32_t cap;
+  uint32_t count;
+
+  ConstName *slots;
+} ConstNames;
+
+typedef struct {
+  const char *fname;
+  const char *at;
+  uint32_t line;
+
+  Image image;
+  uint32_t constCount;
+  ConstNames names;
+
+  // set by `.src`; the assembly file itself until then.
+  const char *srcPath;
+  StrBuf srcPathBuf;
+
+  // whether `.src` or `.line` took over the line mapping.
+  bool hasLines;
+} Asm;
+
+static bool asmErr(Asm *as, const char *fmt, ...) {
+  char msg[MAX_ERR_LENGTH];
+
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(msg, sizeof (msg), fmt, args);
+  va_end(args);
+
+  cliErr("%s:%u: %s", as->fname, as->line, msg);
+  return false;
+}
+
+static bool isWordChar(char c) {
+  return isalnum((unsigned char)c) ||
+    c == '_' || c == '#' || c == '.' || c == '-' || c == '+';
+}
+
+static bool wordIs(Word word, const char *text) {
+  return strlen(text) == word.length &&
+    memcmp(word.chars, text, word.length) == 0;
+}
+
+// skips spaces and comments, and newlines too if `crossLines` is set.
+static void skipBlank(Asm *as, bool crossLines) {
+  while (true) {
+    const char c = *as->at;
+
+    if (c == ' ' || c == '\t' || c == '\r') {
+      as->at++;
+    } else if (c == ';') {
+      while (*as->at != '\n' && *as->at != '\0') {
+        as->at++;
+      }
+    } else if (c == '\n' && crossLines) {
+      as->at++;
+      as->line++;
+    } else {
+      return;
+    }
+  }
+}
+
+static bool isLineEnd(Asm *as) {
+  skipBlank(as, false);
+  return *as->at == '\n' || *as->at == '\0';
+}
+
+static Word readWord(Asm *as) {
+  skipBlank(as, false);
+
+  const char *start = as->at;
+
+  while (isWordChar(*as->at)) {
+    as->at++;
+  }
+
+  return (Word){start, (uint32_t)(as->at - start)};
+}
+
+static bool expectChar(Asm *as, char c, bool crossLines) {
+  skipBlank(as, crossLines);
+
+  if (*as->at != c) {
+    return asmErr(as, "expected `%c`", c);
+  }
+
+  as->at++;
+  return true;
+}
+
+// `word` as a NUL-terminated string in `into`, for strtod() and friends.
+static bool wordText(Asm *as, Word word, char *into) {
+  if (word.length == 0) {
+    return asmErr(as, "expected an operand");
+  }
+
+  if (word.length >= MAX_WORD_LENGTH) {
+    return asmErr(as, "`%.*s...` is too long", 16, word.chars);
+  }
+
+  memcpy(into, word.chars, word.length);
+  into[word.length] = '\0';
+
+  return true;
+}
+
+static bool parseUInt(Asm *as, Word word, uint32_t max, uint32_t *into) {
+  char text[MAX_WORD_LENGTH];
+
+  if (!wordText(as, word, text)) {
+    return false;
+  }
+
+  char *end;
+  const unsigned long value = strtoul(text, &end, 10);
+
+  if (!isdigit((unsigned char)text[0]) || *end != '\0' || value > max) {
+    return asmErr(as, "expected a number up to %u, got `%s`", max, text);
+  }
+
+  *into = (uint32_t)value;
+  return true;
+}
+
+static uint32_t hashWord(Word word) {
+  return hashBytes(word.chars, word.length);
+}
+
+static ConstName *findName(ConstNames *names, Word name) {
+  uint32_t index = hashWord(name) & (names->cap - 1);
+
+  while (true) {
+    ConstName *slot = &names->slots[index];
+
+    if (slot->name.chars == NULL || (
+      slot->name.length == name.length &&
+      memcmp(slot->name.chars, name.chars, name.length) == 0
+    )) {
+      return slot;
+    }
+
+    index = (index + 1) & (names->cap - 1);
+  }
+}
+
+static void growNames(ConstNames *names) {
+  const uint32_t oldCap = names->cap;
+  ConstName *oldSlots = names->slots;
+
+  names->cap = oldCap < MIN_NAMES_CAP ? MIN_NAMES_CAP : oldCap * 2;
+  names->slots = ALLOC(ConstName, names->cap);
+
+  memset(names->slots, 0, sizeof (ConstName) * names->cap);
+
+  for (uint32_t i = 0; i < oldCap; i++) {
+    if (oldSlots[i].name.chars != NULL) {
+      *findName(names, oldSlots[i].name) = oldSlots[i];
+    }
+  }
+
+  FREE_ARR(ConstName, oldSlots, oldCap);
+}
+
+// names point into the assembly, which outlives them.
+static bool nameConst(Asm *as, Word name, uint32_t index) {
+  ConstNames *names = &as->names;
+
+  if ((names->count + 1) * 4 > names->cap * 3) {
+    growNames(names);
+  }
+
+  ConstName *slot = findName(names, name);
+
+  if (slot->name.chars != NULL) {
+    return asmErr(
+      as,
+      "`%.*s` is already defined",
+      (int)name.length,
+      name.chars
+    );
+  }
+
+  *slot = (ConstName){name, index};
+  names->count++;
+
+  return true;
+}
+
+static void appendCodePoint(StrBuf *buf, uint32_t codePoint) {
+  // NOLINTBEGIN
+  char bytes[4];
+  uint32_t length;
+
+  if (codePoint < 0x80) {
+    bytes[0] = (char)codePoint;
+    length = 1;
+  } else if (codePoint < 0x800) {
+    bytes[0] = (char)(0xC0 | codePoint >> 6);
+    bytes[1] = (char)(0x80 | (codePoint & 0x3F));
+    length = 2;
+  } else if (codePoint < 0x10000) {
+    bytes[0] = (char)(0xE0 | codePoint >> 12);
+    bytes[1] = (char)(0x80 | (codePoint >> 6 & 0x3F));
+    bytes[2] = (char)(0x80 | (codePoint & 0x3F));
+    length = 3;
+  } else {
+    bytes[0] = (char)(0xF0 | codePoint >> 18);
+    bytes[1] = (char)(0x80 | (codePoint >> 12 & 0x3F));
+    bytes[2] = (char)(0x80 | (codePoint >> 6 & 0x3F));
+    bytes[3] = (char)(0x80 | (codePoint & 0x3F));
+    length = 4;
+  }
+  // NOLINTEND
+
+  strBufAppend(buf, bytes, length);
+}
+
+static bool readHex(Asm *as, uint32_t maxDigits, uint32_t *into) {
+  uint32_t value = 0;
+  uint32_t digits = 0;
+
+  while (digits < maxDigits && isxdigit((unsigned char)*as->at)) {
+    const char c = (char)tolower((unsigned char)*as->at++);
+
+    // NOLINTNEXTLINE
+    value = value * 16 + (uint32_t)(isdigit(c) ? c - '0' : c - 'a' + 10);
+    digits++;
+  }
+
+  if (digits == 0) {
+    return asmErr(as, "expected a hexadecimal number");
+  }
+
+  *into = value;
+  return true;
+}
+
+// the byte a one-letter escape stands for, or -1 if it isn’t one.
+static int simpleEscape(char c) {
+  switch (c) {
+    case 'n':
+      return '\n';
+
+    case 't':
+      return '\t';
+
+    case 'r':
+      return '\r';
+
+    case '0':
+      return '\0';
+
+    case '\\':
+    case '"':
+      return c;
+
+    default:
+      return -1;
+  }
+}
+
+static bool readEscape(Asm *as, StrBuf *buf) {
+  const char c = *as->at++;
+  const int simple = simpleEscape(c);
+
+  uint32_t value = 0;
+
+  if (simple != -1) {
+    const char byte = (char)simple;
+
+    strBufAppend(buf, &byte, 1);
+    return true;
+  }
+
+  switch (c) {
+    case 'x': {
+      if (!readHex(as, 2, &value)) {
+        return false;
+      }
+
+      const char byte = (char)value;
+      strBufAppend(buf, &byte, 1);
+      return true;
+    }
+
+    case 'u': {
+      // NOLINTBEGIN
+      if (!expectChar(as, '{', false) || !readHex(as, 6, &value)) {
+        return false;
+      }
+
+      if (value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF)) {
+        return asmErr(as, "\\u{%X} isn’t a code point", value);
+      }
+      // NOLINTEND
+
+      appendCodePoint(buf, value);
+      return expectChar(as, '}', false);
+    }
+
+    default:
+      return asmErr(as, "unknown escape `\\%c`", c);
+  }
+}
+
+// the contents of the string literal starting at the cursor, as UTF-8.
+static bool readStrLit(Asm *as, StrBuf *buf) {
+  if (!expectChar(as, '"', false)) {
+    return false;
+  }
+
+  while (*as->at != '"') {
+    if (*as->at == '\n' || *as->at == '\0') {
+      return asmErr(as, "unterminated string");
+    }
+
+    if (*as->at == '\\') {
+      as->at++;
+
+      if (!readEscape(as, buf)) {
+        return false;
+      }
+
+      continue;
+    }
+
+    strBufAppend(buf, as->at++, 1);
+  }
+
+  as->at++;
+  return true;
+}
+
+static bool parseStr(Asm *as, Encoding encoding) {
+  StrBuf buf;
+  initStrBuf(&buf, 0);
+
+  if (!readStrLit(as, &buf)) {
+    freeStrBuf(&buf);
+    return false;
+  }
+
+  uint32_t length;
+
+  if (!validateUtf8(buf.chars, buf.length, &length)) {
+    freeStrBuf(&buf);
+    return asmErr(as, "string isn’t valid UTF-8");
+  }
+
+  const bool isInterned = buf.length <= MAX_INTERNED_STR_SIZE;
+
+  if (encoding == STR_UTF8 && length == buf.length) {
+    imageStr(&as->image, buf.chars, buf.length, isInterned);
+  } else if (encoding == STR_UTF8) {
+    imageUStr(
+      &as->image,
+      STR_UTF8,
+      buf.chars,
+      length,
+      buf.length,
+      isInterned
+    );
+  } else {
+    char *into = ALLOC(
+      char,
+      transcodedCap(STR_UTF8, encoding, buf.length)
+    );
+
+    const uint32_t byteLength = transcode(
+      STR_UTF8,
+      encoding,
+      buf.chars,
+      buf.length,
+      into
+    );
+
+    imageUStr(&as->image, encoding, into, length, byteLength, isInterned);
+    FREE_ARR(char, into, transcodedCap(STR_UTF8, encoding, buf.length));
+  }
+
+  freeStrBuf(&buf);
+  return true;
+}
+
+static bool parseVal(Asm *as);
+
+// the entries go to a buffer of their own first, since the table’s header
+// needs their count.
+static bool parseTable(Asm *as) {
+  as->at++;
+
+  StrBuf outer = as->image.consts;
+  initStrBuf(&as->image.consts, 0);
+
+  uint32_t count = 0;
+  bool ok = true;
+
+  skipBlank(as, true);
+
+  while (ok && *as->at != '}') {
+    if (count != 0) {
+      ok = expectChar(as, ',', true);
+      skipBlank(as, true);
+    }
+
+    ok = ok &&
+      parseVal(as) &&
+      expectChar(as, ':', true) &&
+      parseVal(as);
+
+    count++;
+    skipBlank(as, true);
+  }
+
+  StrBuf entries = as->image.consts;
+  as->image.consts = outer;
+
+  if (ok) {
+    as->at++;
+
+    imageTable(&as->image, count);
+    strBufAppend(&as->image.consts, entries.chars, entries.length);
+  }
+
+  freeStrBuf(&entries);
+  return ok;
+}
+
+static bool parseWordVal(Asm *as, Word word) {
+  if (wordIs(word, "true") || wordIs(word, "false")) {
+    imageBool(&as->image, wordIs(word, "true"));
+    return true;
+  }
+
+  if (wordIs(word, "nil")) {
+    imageNil(&as->image);
+    return true;
+  }
+
+  if (word.length == 0) {
+    return asmErr(as, "expected a constant");
+  }
+
+  char text[MAX_WORD_LENGTH];
+
+  if (!wordText(as, word, text)) {
+    return false;
+  }
+
+  char *end;
+  const double num = strtod(text, &end);
+
+  if (*end != '\0') {
+    return asmErr(as, "`%s` isn’t a constant", text);
+  }
+
+  imageNum(&as->image, num);
+  return true;
+}
+
+static bool parseVal(Asm *as) {
+  skipBlank(as, true);
+
+  if (*as->at == '{') {
+    return parseTable(as);
+  }
+
+  if (*as->at == '"') {
+    return parseStr(as, STR_UTF8);
+  }
+
+  const Word word = readWord(as);
+
+  if (*as->at == '"' && (wordIs(word, "u16") || wordIs(word, "u32"))) {
+    return parseStr(as, wordIs(word, "u16") ? STR_UTF16 : STR_UTF32);
+  }
+
+  return parseWordVal(as, word);
+}
+
+static bool isName(Word word) {
+  return word.length != 0 &&
+    (isalpha((unsigned char)word.chars[0]) || word.chars[0] == '_') &&
+    !wordIs(word, "true") &&
+    !wordIs(word, "false") &&
+    !wordIs(word, "nil") &&
+    !wordIs(word, "u16") &&
+    !wordIs(word, "u32");
+}
+
+static bool parseConst(Asm *as) {
+  const char *start = as->at;
+  const Word word = readWord(as);
+
+  if (isName(word) && !isLineEnd(as)) {
+    if (!nameConst(as, word, as->constCount)) {
+      return false;
+    }
+  } else {
+    as->at = start;
+  }
+
+  if (!parseVal(as)) {
+    return false;
+  }
+
+  as->constCount++;
+  return true;
+}
+
+static bool parseSrc(Asm *as) {
+  freeStrBuf(&as->srcPathBuf);
+  initStrBuf(&as->srcPathBuf, 0);
+
+  if (!readStrLit(as, &as->srcPathBuf)) {
+    return false;
+  }
+
+  if (as->srcPathBuf.length >= MAX_SRC_PATH_LENGTH) {
+    return asmErr(as, "the source path is too long");
+  }
+
+  // NUL-terminated, for finishImage().
+  strBufAppend(&as->srcPathBuf, "", 1);
+
+  as->srcPath = as->srcPathBuf.chars;
+  as->hasLines = true;
+
+  return true;
+}
+
+static bool parseLine(Asm *as) {
+  uint32_t line;
+
+  if (!parseUInt(as, readWord(as), UINT32_MAX, &line)) {
+    return false;
+  }
+
+  imageLine(&as->image, line);
+  as->hasLines = true;
+
+  return true;
+}
+
+static bool parseDirective(Asm *as, Word word) {
+  if (wordIs(word, ".const")) {
+    return parseConst(as);
+  }
+
+  if (wordIs(word, ".src")) {
+    return parseSrc(as);
+  }
+
+  if (wordIs(word, ".line")) {
+    return parseLine(as);
+  }
+
+  return asmErr(as, "unknown directive `%.*s`", (int)word.length, word.chars);
+}
+
+static bool parseReg(Asm *as, Word word, uint32_t *into) {
+  if (word.length == 0) {
+    return asmErr(as, "expected a register");
+  }
+
+  if (word.length < 2 || word.chars[0] != 'r') {
+    return asmErr(
+      as,
+      "expected a register, got `%.*s`",
+      (int)word.length,
+      word.chars
+    );
+  }
+
+  const Word index = {word.chars + 1, word.length - 1};
+  return parseUInt(as, index, UINT8_MAX, into);
+}
+
+static bool parseConstRef(Asm *as, Word word, uint32_t *into) {
+  if (word.length != 0 && word.chars[0] == '#') {
+    const Word index = {word.chars + 1, word.length - 1};
+
+    if (!parseUInt(as, index, UINT32_MAX, into)) {
+      return false;
+    }
+  } else {
+    const ConstName *slot = as->names.cap == 0 ?
+      NULL : findName(&as->names, word);
+
+    if (slot == NULL || slot->name.chars == NULL) {
+      return asmErr(
+        as,
+        "no constant named `%.*s`",
+        (int)word.length,
+        word.chars
+      );
+    }
+
+    *into = slot->index;
+  }
+
+  if (*into >= as->constCount) {
+    return asmErr(as, "there’s no constant #%u yet", *into);
+  }
+
+  return true;
+}
+
+static bool parseOperand(Asm *as, char kind, uint32_t *into) {
+  const Word word = readWord(as);
+
+  switch (kind) {
+    case 'r':
+      return parseReg(as, word, into);
+
+    case 'n':
+      return parseUInt(as, word, UINT8_MAX, into);
+
+    default:
+      break;
+  }
+
+  if (!parseConstRef(as, word, into)) {
+    return false;
+  }
+
+  const uint32_t max = kind == 'l' ? MAX_LONG_CONST : UINT8_MAX;
+
+  if (*into > max) {
+    return asmErr(as, "constant #%u doesn’t fit in the operand", *into);
+  }
+
+  return true;
+}
+
+static const InstrInfo *findInstr(Word mnemonic) {
+  for (size_t i = 0; i < sizeof (instrs) / sizeof (instrs[0]); i++) {
+    if (wordIs(mnemonic, opName(instrs[i].op))) {
+      return &instrs[i];
+    }
+  }
+
+  return NULL;
+}
+
+// pushlong’s constant index comes first, in three bytes, least significant
+// first; that’s the layout debug.c and the VM read.
+static void emitPushLong(Asm *as, uint32_t reg, uint32_t index) {
+  const uint8_t byteLength = 8;
+
+  imageByte(&as->image, OP_PUSHLONG);
+  imageByte(&as->image, (uint8_t)index);
+  imageByte(&as->image, (uint8_t)(index >> byteLength));
+  imageByte(&as->image, (uint8_t)(index >> byteLength * 2));
+  imageByte(&as->image, (uint8_t)reg);
+}
+
+static bool parseInstr(Asm *as, Word mnemonic) {
+  const InstrInfo *info = findInstr(mnemonic);
+
+  if (info == NULL) {
+    return asmErr(
+      as,
+      "unknown instruction `%.*s`",
+      (int)mnemonic.length,
+      mnemonic.chars
+    );
+  }
+
+  uint32_t operands[MAX_OPERANDS];
+  const size_t count = strlen(info->operands);
+
+  for (size_t i = 0; i < count; i++) {
+    // a push whose constant doesn’t fit in a byte becomes a pushlong.
+    const char kind = info->op == OP_PUSH && info->operands[i] == 'c' ?
+      'l' : info->operands[i];
+
+    if (!parseOperand(as, kind, &operands[i])) {
+      return false;
+    }
+  }
+
+  if (!as->hasLines) {
+    imageLine(&as->image, as->line);
+  }
+
+  const bool isLong = info->op == OP_PUSHLONG ||
+    (info->op == OP_PUSH && operands[1] > UINT8_MAX);
+
+  if (isLong) {
+    emitPushLong(as, operands[0], operands[1]);
+    return true;
+  }
+
+  imageByte(&as->image, (uint8_t)info->op);
+
+  for (size_t i = 0; i < count; i++) {
+    imageByte(&as->image, (uint8_t)operands[i]);
+  }
+
+  return true;
+}
+
+static bool parseStatement(Asm *as) {
+  const Word word = readWord(as);
+
+  if (word.length == 0) {
+    return isLineEnd(as) || asmErr(as, "unexpected `%c`", *as->at);
+  }
+
+  const bool ok = word.chars[0] == '.' ?
+    parseDirective(as, word) :
+    parseInstr(as, word);
+
+  if (ok && !isLineEnd(as)) {
+    return asmErr(as, "unexpected `%c` at the end of the line", *as->at);
+  }
+
+  return ok;
+}
+
+uint8_t *assemble(const char *fname, const char *src, size_t *length) {
+  Asm as = {
+    .fname = fname,
+    .at = src,
+    .line = 1,
+    .srcPath = fname
+  };
+
+  initImage(&as.image);
+  initStrBuf(&as.srcPathBuf, 0);
+
+  bool ok = true;
+
+  while (ok && *as.at != '\0') {
+    ok = parseStatement(&as);
+
+    if (*as.at == '\n') {
+      as.at++;
+      as.line++;
+    }
+  }
+
+  uint8_t *bytes = NULL;
+
+  if (ok) {
+    bytes = finishImage(&as.image, as.srcPath, length);
+  } else {
+    freeImage(&as.image);
+  }
+
+  FREE_ARR(ConstName, as.names.slots, as.names.cap);
+  freeStrBuf(&as.srcPathBuf);
+
+  return bytes;
+}
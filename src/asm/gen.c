@@ -0,0 +1,478 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm.h"
+#include "err.h"
+
+// synthetic workloads, written out as assembly so that they can be read,
+// tweaked and assembled like anything else.  every workload takes a
+// `seed`, and the same parameters always make the same program.
+//
+//   consts n=4096 kind=nums|strs|ustrs len=8
+//     `n` constants, each loaded into a register once.  strings are `len`
+//     code points long; ustrs are mostly Cyrillic, so UTF-8 but not ASCII.
+//
+//   table entries=1024 keys=strs|nums|ints lookups=4096 hits=100
+//     a table constant with `entries` entries, then `lookups` reads from
+//     it, `hits` percent of which find their key.
+//
+//   ops n=65536 mix=arith|strs|tables
+//     a straight run of `n` instructions picked at random from the mix.
+//     registers are split so that every operand has the right type.
+
+// NOLINTBEGIN
+#define MAX_PARAMS       16
+#define MAX_LINE_LENGTH  128
+#define KEY_REG_COUNT    64
+#define FIRST_KEY_REG    16
+#define CONST_REG_COUNT  16
+#define DEFAULT_SEED     1
+// NOLINTEND
+
+typedef struct {
+  const char **pairs;
+  int count;
+
+  bool isUsed[MAX_PARAMS];
+  bool hadErr;
+} Params;
+
+typedef struct {
+  const char *name;
+  void (*generate)(StrBuf *buf, Params *params, uint64_t *seed);
+} Workload;
+
+// splitmix64: small, and the same everywhere.
+static uint64_t nextRand(uint64_t *seed) {
+  // NOLINTBEGIN
+  uint64_t z = (*seed += 0x9E3779B97F4A7C15);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+  // NOLINTEND
+
+  return z ^ (z >> 31);
+}
+
+static uint32_t randBelow(uint64_t *seed, uint32_t bound) {
+  return (uint32_t)(nextRand(seed) % bound);
+}
+
+static void emitf(StrBuf *buf, const char *fmt, ...) {
+  va_list args;
+
+  va_start(args, fmt);
+  const int length = vsnprintf(
+    strBufReserve(buf, MAX_LINE_LENGTH),
+    MAX_LINE_LENGTH,
+    fmt,
+    args
+  );
+  va_end(args);
+
+  // the lines written here are short; anything longer is cut off.
+  buf->length += (uint32_t)(
+    length < MAX_LINE_LENGTH ? length : MAX_LINE_LENGTH - 1
+  );
+}
+
+// the value after `key=`, or NULL if `key` wasn’t given.
+static const char *findParam(Params *params, const char *key) {
+  const size_t keyLength = strlen(key);
+
+  for (int i = 0; i < params->count; i++) {
+    const char *pair = params->pairs[i];
+
+    if (strncmp(pair, key, keyLength) == 0 && pair[keyLength] == '=') {
+      params->isUsed[i] = true;
+      return pair + keyLength + 1;
+    }
+  }
+
+  return NULL;
+}
+
+static uint32_t numParam(
+  Params *params,
+  const char *key,
+  uint32_t fallback,
+  uint32_t max
+) {
+  const char *value = findParam(params, key);
+
+  if (value == NULL) {
+    return fallback;
+  }
+
+  char *end;
+  const unsigned long num = strtoul(value, &end, 10);
+
+  if (*value == '\0' || *end != '\0' || num > max) {
+    cliErr("`%s` must be a number up to %u", key, max);
+    params->hadErr = true;
+
+    return fallback;
+  }
+
+  return (uint32_t)num;
+}
+
+// the index of the value in `choices`, which is NULL-terminated and whose
+// first entry is the default.
+static uint32_t choiceParam(
+  Params *params,
+  const char *key,
+  const char **choices
+) {
+  const char *value = findParam(params, key);
+
+  if (value == NULL) {
+    return 0;
+  }
+
+  for (uint32_t i = 0; choices[i] != NULL; i++) {
+    if (strcmp(value, choices[i]) == 0) {
+      return i;
+    }
+  }
+
+  cliErr("`%s` can’t be `%s`", key, value);
+  params->hadErr = true;
+
+  return 0;
+}
+
+// `length` code points, starting with the digits of `i` so that no two
+// strings are the same.
+static void emitStr(
+  StrBuf *buf,
+  uint64_t *seed,
+  uint32_t i,
+  uint32_t length,
+  bool isAscii
+) {
+  static const char *cyrillic[] = {
+    "а", "б", "в", "г", "д", "е", "ж", "з", "и", "к", "л", "м"
+  };
+
+  const uint32_t cyrillicCount = sizeof (cyrillic) / sizeof (cyrillic[0]);
+
+  char digits[16];
+  const uint32_t digitCount = (uint32_t)snprintf(
+    digits,
+    sizeof (digits),
+    "%u",
+    i
+  );
+
+  strBufAppend(buf, "\"", 1);
+  strBufAppend(buf, digits, digitCount);
+
+  for (uint32_t j = digitCount; j < length; j++) {
+    if (isAscii) {
+      const char c = (char)('a' + randBelow(seed, 26));
+      strBufAppend(buf, &c, 1);
+    } else {
+      const char *c = cyrillic[randBelow(seed, cyrillicCount)];
+      strBufAppend(buf, c, (uint32_t)strlen(c));
+    }
+  }
+
+  strBufAppend(buf, "\"", 1);
+}
+
+static void generateConsts(StrBuf *buf, Params *params, uint64_t *seed) {
+  static const char *kinds[] = {"nums", "strs", "ustrs", NULL};
+
+  const uint32_t count = numParam(params, "n", 4096, 0xFFFFFF);
+  const uint32_t kind = choiceParam(params, "kind", kinds);
+  const uint32_t length = numParam(params, "len", 8, 4096);
+
+  for (uint32_t i = 0; i < count; i++) {
+    STR_BUF_APPEND_LIT(buf, ".const ");
+
+    if (kind == 0) {
+      emitf(buf, "%.17g\n", randBelow(seed, 1000000) / 8.0);
+      continue;
+    }
+
+    emitStr(buf, seed, i, length, kind == 1);
+    STR_BUF_APPEND_LIT(buf, "\n");
+  }
+
+  STR_BUF_APPEND_LIT(buf, "\n");
+
+  for (uint32_t i = 0; i < count; i++) {
+    emitf(buf, "push r%u #%u\n", i % CONST_REG_COUNT, i);
+  }
+
+  STR_BUF_APPEND_LIT(buf, "nil r0\nret r0\n");
+}
+
+static void emitKey(StrBuf *buf, uint32_t keys, uint32_t i) {
+  switch (keys) {
+    case 0:
+      emitf(buf, "\"key%u\"", i);
+      break;
+
+    case 1:
+      emitf(buf, "%u.5", i);
+      break;
+
+    default:
+      emitf(buf, "%u", i);
+      break;
+  }
+}
+
+static void generateTable(StrBuf *buf, Params *params, uint64_t *seed) {
+  static const char *keyKinds[] = {"strs", "nums", "ints", NULL};
+
+  const uint32_t entries = numParam(params, "entries", 1024, 0xFFFFFF);
+  const uint32_t keys = choiceParam(params, "keys", keyKinds);
+  const uint32_t lookups = numParam(params, "lookups", 4096, 0xFFFFFF);
+  const uint32_t hits = numParam(params, "hits", 100, 100);
+
+  STR_BUF_APPEND_LIT(buf, ".const table {\n");
+
+  for (uint32_t i = 0; i < entries; i++) {
+    STR_BUF_APPEND_LIT(buf, "  ");
+    emitKey(buf, keys, i);
+    emitf(buf, ": %u%s\n", i, i + 1 < entries ? "," : "");
+  }
+
+  STR_BUF_APPEND_LIT(buf, "}\n\n");
+
+  // the keys looked up; misses are keys past the last entry.
+  for (uint32_t i = 0; i < KEY_REG_COUNT; i++) {
+    const bool isHit = entries != 0 && randBelow(seed, 100) < hits;
+    const uint32_t key = isHit ?
+      randBelow(seed, entries) :
+      entries + randBelow(seed, entries + 1);
+
+    STR_BUF_APPEND_LIT(buf, ".const ");
+    emitKey(buf, keys, key);
+    STR_BUF_APPEND_LIT(buf, "\n");
+  }
+
+  STR_BUF_APPEND_LIT(buf, "\npush r0 table\nnil r1\n");
+
+  for (uint32_t i = 0; i < KEY_REG_COUNT; i++) {
+    emitf(buf, "push r%u #%u\n", FIRST_KEY_REG + i, i + 1);
+  }
+
+  for (uint32_t i = 0; i < lookups; i++) {
+    const uint32_t keyReg = FIRST_KEY_REG + randBelow(seed, KEY_REG_COUNT);
+    emitf(buf, "tableget r1 r0 r%u\n", keyReg);
+  }
+
+  STR_BUF_APPEND_LIT(buf, "ret r1\n");
+}
+
+// r0-r7 hold constants and r8-r15 numeric results, which are read back
+// too; r16-r23 hold booleans.
+static void emitArithInstr(StrBuf *buf, uint64_t *seed) {
+  static const char *binaryOps[] = {"add", "sub", "mul", "div"};
+
+  const uint32_t num = 8 + randBelow(seed, 8);
+  const uint32_t boolean = 16 + randBelow(seed, 8);
+
+  const uint32_t a = randBelow(seed, 16);
+  const uint32_t b = randBelow(seed, 16);
+
+  switch (randBelow(seed, 8)) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+      emitf(buf, "%s r%u r%u r%u\n", binaryOps[a % 4], num, a, b);
+      break;
+
+    case 4:
+      emitf(buf, "lt r%u r%u r%u\n", boolean, a, b);
+      break;
+
+    case 5:
+      emitf(buf, "eq r%u r%u r%u\n", boolean, a, b);
+      break;
+
+    case 6:
+      emitf(buf, "not r%u r%u\n", boolean, 16 + b % 8);
+      break;
+
+    default:
+      emitf(buf, "neg r%u r%u\n", num, a);
+      break;
+  }
+}
+
+// r0-r3 hold short strings and r4-r5 indices; results go to r8-r11 and
+// are never read, so strings don’t keep growing.
+static void emitStrInstr(StrBuf *buf, uint64_t *seed) {
+  const uint32_t dest = 8 + randBelow(seed, 4);
+  const uint32_t a = randBelow(seed, 4);
+  const uint32_t b = randBelow(seed, 4);
+
+  switch (randBelow(seed, 6)) {
+    case 0:
+      emitf(buf, "concat r%u r%u r%u\n", dest, a, b);
+      break;
+
+    case 1:
+      emitf(buf, "concatn r%u r0 4\n", dest);
+      break;
+
+    case 2:
+      emitf(buf, "interp r%u template r%u\n", dest, a);
+      break;
+
+    case 3:
+      emitf(buf, "slice r%u r%u r4 r5\n", dest, a);
+      break;
+
+    case 4:
+      emitf(buf, "charat r%u r%u r4\n", dest, a);
+      break;
+
+    default:
+      emitf(buf, "strlen r12 r%u\n", a);
+      break;
+  }
+}
+
+static void emitOpsPrologue(StrBuf *buf, uint32_t mix, uint64_t *seed) {
+  switch (mix) {
+    case 0:
+      for (uint32_t i = 0; i < 8; i++) {
+        emitf(buf, ".const %u\n", 1 + randBelow(seed, 100));
+      }
+
+      for (uint32_t i = 0; i < 8; i++) {
+        emitf(buf, "push r%u #%u\nzero r%u\ntrue r%u\n", i, i, i + 8, i + 16);
+      }
+
+      break;
+
+    case 1:
+      STR_BUF_APPEND_LIT(
+        buf,
+        ".const \"ab\"\n"
+        ".const \"cdef\"\n"
+        ".const \"ключ\"\n"
+        ".const 3\n"
+        ".const template \"<{}>\"\n\n"
+        "push r0 #0\npush r1 #1\npush r2 #2\nconcat r3 r0 r2\n"
+        "one r4\npush r5 #3\n"
+        "concat r8 r0 r1\nconcat r9 r0 r1\n"
+        "concat r10 r0 r1\nconcat r11 r0 r1\n"
+      );
+
+      break;
+
+    default:
+      for (uint32_t i = 0; i < KEY_REG_COUNT; i++) {
+        if (i % 2 == 0) {
+          emitf(buf, ".const \"key%u\"\n", i);
+        } else {
+          emitf(buf, ".const %u.5\n", i);
+        }
+      }
+
+      STR_BUF_APPEND_LIT(buf, "\ntablenew r0\none r1\nnil r2\n");
+
+      for (uint32_t i = 0; i < KEY_REG_COUNT; i++) {
+        emitf(buf, "push r%u #%u\n", FIRST_KEY_REG + i, i);
+      }
+
+      break;
+  }
+}
+
+static void generateOps(StrBuf *buf, Params *params, uint64_t *seed) {
+  static const char *mixes[] = {"arith", "strs", "tables", NULL};
+
+  const uint32_t count = numParam(params, "n", 65536, 0xFFFFFF);
+  const uint32_t mix = choiceParam(params, "mix", mixes);
+
+  emitOpsPrologue(buf, mix, seed);
+  STR_BUF_APPEND_LIT(buf, "\n");
+
+  for (uint32_t i = 0; i < count; i++) {
+    switch (mix) {
+      case 0:
+        emitArithInstr(buf, seed);
+        break;
+
+      case 1:
+        emitStrInstr(buf, seed);
+        break;
+
+      default: {
+        const uint32_t key = FIRST_KEY_REG + randBelow(seed, KEY_REG_COUNT);
+
+        if (randBelow(seed, 2) == 0) {
+          emitf(buf, "tableset r0 r%u r1\n", key);
+        } else {
+          emitf(buf, "tableget r2 r0 r%u\n", key);
+        }
+
+        break;
+      }
+    }
+  }
+
+  emitf(buf, "ret r%u\n", mix == 2 ? 2 : 8);
+}
+
+static const Workload workloads[] = {
+  {"consts", generateConsts},
+  {"table", generateTable},
+  {"ops", generateOps}
+};
+
+bool generateWorkload(
+  StrBuf *buf,
+  const char *kind,
+  const char **params,
+  int paramCount
+) {
+  const Workload *workload = NULL;
+
+  for (size_t i = 0; i < sizeof (workloads) / sizeof (workloads[0]); i++) {
+    if (strcmp(kind, workloads[i].name) == 0) {
+      workload = &workloads[i];
+    }
+  }
+
+  if (workload == NULL) {
+    cliErr("unknown workload `%s`; try consts, table or ops", kind);
+    return false;
+  }
+
+  if (paramCount > MAX_PARAMS) {
+    cliErr("too many parameters");
+    return false;
+  }
+
+  Params given = {.pairs = params, .count = paramCount};
+  uint64_t seed = numParam(&given, "seed", DEFAULT_SEED, UINT32_MAX);
+
+  emitf(buf, "; neve-asm --gen %s", kind);
+
+  for (int i = 0; i < paramCount; i++) {
+    emitf(buf, " %.*s", MAX_LINE_LENGTH / 2, params[i]);
+  }
+
+  STR_BUF_APPEND_LIT(buf, "\n\n");
+  workload->generate(buf, &given, &seed);
+
+  for (int i = 0; i < paramCount; i++) {
+    if (!given.isUsed[i]) {
+      cliErr("`%s` isn’t a parameter of %s", params[i], kind);
+      given.hadErr = true;
+    }
+  }
+
+  return !given.hadErr;
+}
@@ -0,0 +1,164 @@
+#include <string.h>
+
+#include "const.h"
+#include "image.h"
+#include "mem.h"
+#include "val.h"
+
+// the debug header ends with an offset no instruction can have, which is
+// what stops the line lookup in err.c.
+#define LAST_LINE_OFFSET 0xFFFFFFFF
+
+static void appendU16(StrBuf *buf, uint16_t u16) {
+  strBufAppend(buf, (const char *)&u16, sizeof (uint16_t));
+}
+
+static void appendU32(StrBuf *buf, uint32_t u32) {
+  strBufAppend(buf, (const char *)&u32, sizeof (uint32_t));
+}
+
+static void appendByte(StrBuf *buf, uint8_t byte) {
+  strBufAppend(buf, (const char *)&byte, 1);
+}
+
+void initImage(Image *image) {
+  initStrBuf(&image->consts, 0);
+  initStrBuf(&image->lines, 0);
+  initStrBuf(&image->code, 0);
+
+  image->line = 0;
+}
+
+void imageNum(Image *image, double num) {
+  appendByte(&image->consts, VAL_NUM);
+  strBufAppend(&image->consts, (const char *)&num, sizeof (double));
+}
+
+void imageBool(Image *image, bool boolean) {
+  appendByte(&image->consts, VAL_BOOL);
+  appendByte(&image->consts, boolean ? 1 : 0);
+}
+
+void imageNil(Image *image) {
+  appendByte(&image->consts, VAL_NIL);
+}
+
+void imageStr(
+  Image *image,
+  const char *chars,
+  uint32_t byteLength,
+  bool isInterned
+) {
+  appendByte(&image->consts, VAL_OBJ);
+  appendByte(&image->consts, CONST_OBJ_STR);
+
+  appendU32(&image->consts, byteLength);
+  strBufAppend(&image->consts, chars, byteLength);
+  appendByte(&image->consts, isInterned ? 1 : 0);
+}
+
+void imageUStr(
+  Image *image,
+  Encoding encoding,
+  const char *chars,
+  uint32_t length,
+  uint32_t byteLength,
+  bool isInterned
+) {
+  appendByte(&image->consts, VAL_OBJ);
+  appendByte(&image->consts, CONST_OBJ_USTR);
+  appendByte(&image->consts, (uint8_t)encoding);
+
+  appendU32(&image->consts, length);
+  appendU32(&image->consts, byteLength);
+  strBufAppend(&image->consts, chars, byteLength);
+  appendByte(&image->consts, isInterned ? 1 : 0);
+}
+
+void imageTable(Image *image, uint32_t count) {
+  appendByte(&image->consts, VAL_OBJ);
+  appendByte(&image->consts, CONST_OBJ_TABLE);
+
+  appendU32(&image->consts, count);
+}
+
+uint32_t imageCodeOffset(Image *image) {
+  return image->code.length;
+}
+
+void imageLine(Image *image, uint32_t line) {
+  const bool isFull =
+    image->lines.length + 2 * sizeof (uint32_t) > MAX_LINES_LENGTH;
+
+  if ((line == image->line && image->lines.length != 0) || isFull) {
+    return;
+  }
+
+  appendU32(&image->lines, image->code.length);
+  appendU32(&image->lines, line);
+
+  image->line = line;
+}
+
+void imageByte(Image *image, uint8_t byte) {
+  appendByte(&image->code, byte);
+}
+
+// an empty buffer has no `chars` to copy from yet.
+static void appendBuf(StrBuf *file, const StrBuf *buf) {
+  if (buf->length != 0) {
+    strBufAppend(file, buf->chars, buf->length);
+  }
+}
+
+uint8_t *finishImage(Image *image, const char *srcPath, size_t *length) {
+  if (image->lines.length == 0) {
+    imageLine(image, 1);
+  }
+
+  const uint16_t pathLength = (uint16_t)strlen(srcPath);
+
+  // everything after the header’s own length, up to and including the
+  // separator that ends it.
+  const uint16_t headerLength = (uint16_t)(
+    sizeof (uint16_t) + pathLength +
+    image->lines.length + sizeof (uint32_t) + 1
+  );
+
+  StrBuf file;
+  initStrBuf(
+    &file,
+    (uint32_t)(
+      sizeof (uint32_t) + image->consts.length + 1 +
+      sizeof (uint16_t) + headerLength +
+      image->code.length + EOF_PADDING_SIZE
+    )
+  );
+
+  appendU32(&file, NEVE_MAGIC_NUMBER);
+  appendBuf(&file, &image->consts);
+  appendByte(&file, NEVE_CONST_HEADER_SEPARATOR);
+
+  appendU16(&file, headerLength);
+  appendU16(&file, pathLength);
+  strBufAppend(&file, srcPath, pathLength);
+  appendBuf(&file, &image->lines);
+  appendU32(&file, LAST_LINE_OFFSET);
+  appendByte(&file, NEVE_CONST_HEADER_SEPARATOR);
+
+  appendBuf(&file, &image->code);
+  strBufAppend(&file, EOF_PADDING, EOF_PADDING_SIZE);
+
+  freeImage(image);
+
+  *length = file.length;
+  return (uint8_t *)strBufTake(&file);
+}
+
+void freeImage(Image *image) {
+  freeStrBuf(&image->consts);
+  freeStrBuf(&image->lines);
+  freeStrBuf(&image->code);
+
+  image->line = 0;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm.h"
+#include "err.h"
+
+// NOLINTBEGIN
+#define MAX_GEN_PARAMS 16
+// NOLINTEND
+
+#define USAGE                                                         \
+  "usage: `neve-asm <path> [-o <out>]` or "                             \
+  "`neve-asm --gen <workload> [key=value ...] [-o <out>]`"
+
+static void usage(void) {
+  cliErr(USAGE);
+  exit(1);
+}
+
+// asked for, usage isn’t an error.
+static void help(void) {
+  printf("%s\n", USAGE);
+  exit(0);
+}
+
+static char *readSrc(const char *fname) {
+  FILE *f = fopen(fname, "rb");
+
+  if (f == NULL) {
+    cliErr("%s: file not found", fname);
+    exit(1);
+  }
+
+  fseek(f, 0L, SEEK_END);
+  size_t size = (size_t)ftell(f);
+  rewind(f);
+
+  char *buf = malloc(size + 1);
+
+  if (buf == NULL) {
+    cliErr("not enough memory available to read %s", fname);
+    exit(1);
+  }
+
+  if (fread(buf, sizeof (char), size, f) < size) {
+    cliErr("%s: couldn't read the full file", fname);
+    exit(1);
+  }
+
+  buf[size] = '\0';
+
+  fclose(f);
+  return buf;
+}
+
+static void writeOut(const char *fname, const void *bytes, size_t length) {
+  FILE *f = strcmp(fname, "-") == 0 ? stdout : fopen(fname, "wb");
+
+  if (f == NULL) {
+    cliErr("%s: couldn't open the file for writing", fname);
+    exit(1);
+  }
+
+  if (fwrite(bytes, 1, length, f) < length) {
+    cliErr("%s: couldn't write the full file", fname);
+    exit(1);
+  }
+
+  if (f != stdout) {
+    fclose(f);
+  }
+}
+
+// `path` with its extension swapped for .nv, or with .nv added.
+static char *defaultOut(const char *path) {
+  const char *slash = strrchr(path, '/');
+  const char *dot = strrchr(path, '.');
+
+  const size_t stem = dot != NULL && (slash == NULL || dot > slash) ?
+    (size_t)(dot - path) : strlen(path);
+
+  char *out = malloc(stem + sizeof (".nv"));
+
+  if (out == NULL) {
+    cliErr("not enough memory available");
+    exit(1);
+  }
+
+  memcpy(out, path, stem);
+  memcpy(out + stem, ".nv", sizeof (".nv"));
+
+  return out;
+}
+
+static void assembleOut(
+  const char *fname,
+  const char *src,
+  const char *outPath
+) {
+  size_t length;
+  uint8_t *bytes = assemble(fname, src, &length);
+
+  if (bytes == NULL) {
+    exit(1);
+  }
+
+  writeOut(outPath, bytes, length);
+  free(bytes);
+}
+
+// without `-o`, the assembly itself is printed, to be kept around or
+// edited before it's assembled.
+static void runGen(
+  const char *kind,
+  const char **params,
+  int paramCount,
+  const char *outPath
+) {
+  StrBuf buf;
+  initStrBuf(&buf, 0);
+
+  if (!generateWorkload(&buf, kind, params, paramCount)) {
+    exit(1);
+  }
+
+  char *src = strBufTake(&buf);
+
+  if (outPath == NULL) {
+    writeOut("-", src, strlen(src));
+  } else {
+    assembleOut(kind, src, outPath);
+  }
+
+  free(src);
+}
+
+int main(const int argc, const char **argv) {
+  const char *inPath = NULL;
+  const char *outPath = NULL;
+  const char *kind = NULL;
+
+  const char *params[MAX_GEN_PARAMS];
+  int paramCount = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0) {
+      help();
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (strcmp(argv[i], "--gen") == 0 && i + 1 < argc) {
+      kind = argv[++i];
+    } else if (kind != NULL && strchr(argv[i], '=') != NULL) {
+      if (paramCount == MAX_GEN_PARAMS) {
+        usage();
+      }
+
+      params[paramCount++] = argv[i];
+    } else if (inPath == NULL && argv[i][0] != '-') {
+      inPath = argv[i];
+    } else {
+      usage();
+    }
+  }
+
+  if ((kind == NULL) == (inPath == NULL)) {
+    usage();
+  }
+
+  if (kind != NULL) {
+    runGen(kind, params, paramCount, outPath);
+    return 0;
+  }
+
+  char *src = readSrc(inPath);
+  char *out = outPath == NULL ? defaultOut(inPath) : NULL;
+
+  assembleOut(inPath, src, outPath == NULL ? out : outPath);
+
+  free(out);
+  free(src);
+
+  return 0;
+}
@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "mem.h"
+
+#define BENCH_NAME_MAX 64
+#define BASELINE_LINE_MAX 512
+
+// NOLINTBEGIN
+#define NS_PER_SEC 1000000000ULL
+
+// every benchmark runs for at least this long before it’s measured, and
+// each measured repetition calls `run` enough times to take at least
+// MIN_REP_NS, so that the timer’s resolution doesn’t matter.
+#define WARMUP_NS  (20 * 1000000ULL)
+#define MIN_REP_NS (2 * 1000000ULL)
+#define MAX_BATCH  (1u << 24)
+// NOLINTEND
+
+static volatile uint64_t sink;
+
+void benchSink(uint64_t value) {
+  sink += value;
+}
+
+// NOLINTBEGIN
+uint64_t benchRand(uint64_t *state) {
+  // splitmix64.
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+// NOLINTEND
+
+static uint64_t nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+void initBenchRun(BenchRun *run) {
+  run->filter = NULL;
+  run->reps = 0;
+  run->isJson = false;
+
+  run->baselines = NULL;
+  run->baselineCount = 0;
+  run->baselineCap = 0;
+  run->threshold = 0;
+
+  run->resultCount = 0;
+  run->regressions = 0;
+}
+
+// pulls the string after `"field": "` out of `line`.
+static char *readJsonStr(const char *line, const char *field) {
+  const char *start = strstr(line, field);
+  if (start == NULL) {
+    return NULL;
+  }
+
+  start += strlen(field);
+
+  const char *end = strchr(start, '"');
+  if (end == NULL) {
+    return NULL;
+  }
+
+  const size_t length = (size_t)(end - start);
+  char *str = ALLOC(char, length + 1);
+
+  memcpy(str, start, length);
+  str[length] = '\0';
+
+  return str;
+}
+
+// the results are read back the way report() writes them, one object
+// per line, rather than with a general JSON parser.
+bool readBaselines(BenchRun *run, const char *fname) {
+  FILE *f = fopen(fname, "r");
+  if (f == NULL) {
+    return false;
+  }
+
+  char line[BASELINE_LINE_MAX];
+
+  while (fgets(line, sizeof (line), f) != NULL) {
+    char *name = readJsonStr(line, "\"name\": \"");
+    const char *p50 = strstr(line, "\"p50\": ");
+
+    if (name == NULL || p50 == NULL) {
+      if (name != NULL) {
+        FREE_VAR_ARR(name, strlen(name) + 1);
+      }
+
+      continue;
+    }
+
+    if (run->baselineCount + 1 > run->baselineCap) {
+      const uint32_t oldCap = run->baselineCap;
+      run->baselineCap = GROW_CAP(oldCap);
+
+      run->baselines = GROW_ARR(
+        Baseline,
+        run->baselines,
+        oldCap,
+        run->baselineCap
+      );
+    }
+
+    run->baselines[run->baselineCount++] = (Baseline){
+      .name = name,
+      .p50 = strtod(p50 + strlen("\"p50\": "), NULL)
+    };
+  }
+
+  fclose(f);
+  return run->baselineCount != 0;
+}
+
+static const Baseline *findBaseline(BenchRun *run, const char *name) {
+  for (uint32_t i = 0; i < run->baselineCount; i++) {
+    if (strcmp(run->baselines[i].name, name) == 0) {
+      return &run->baselines[i];
+    }
+  }
+
+  return NULL;
+}
+
+void beginBenchRun(BenchRun *run) {
+  if (run->isJson) {
+    printf("[\n");
+  } else if (run->baselineCount != 0) {
+    printf(
+      "%-36s %12s %12s %9s\n",
+      "benchmark", "baseline", "p50", "change"
+    );
+  } else {
+    printf(
+      "%-36s %12s %12s %12s %12s\n",
+      "benchmark", "min", "p50", "p90", "p99"
+    );
+  }
+}
+
+void endBenchRun(BenchRun *run) {
+  if (run->isJson) {
+    printf("\n]\n");
+  }
+
+  if (run->baselineCount != 0 && !run->isJson) {
+    printf(
+      "\n%u regression%s beyond %.1f%%\n",
+      run->regressions,
+      run->regressions == 1 ? "" : "s",
+      run->threshold
+    );
+  }
+}
+
+static void compareResult(
+  BenchRun *run,
+  const char *name,
+  const char *unit,
+  bool isRate,
+  double p50
+) {
+  const Baseline *baseline = findBaseline(run, name);
+
+  if (baseline == NULL) {
+    if (!run->isJson) {
+      printf("%-36s %12s %12.2f %9s  %s\n", name, "-", p50, "new", unit);
+    }
+
+    return;
+  }
+
+  const double change = (p50 - baseline->p50) / baseline->p50 * 100;
+  const bool isRegression = (
+    isRate ? change < -run->threshold : change > run->threshold
+  );
+
+  if (isRegression) {
+    run->regressions++;
+  }
+
+  if (!run->isJson) {
+    printf(
+      "%-36s %12.2f %12.2f %+8.1f%%  %s%s\n",
+      name,
+      baseline->p50,
+      p50,
+      change,
+      unit,
+      isRegression ? "  SLOWER" : ""
+    );
+  }
+}
+
+// `sorted` runs from the best result to the worst, so for a rate the
+// "min" column holds the highest one.
+static void report(
+  BenchRun *run,
+  const char *name,
+  const char *unit,
+  bool isRate,
+  const double *sorted,
+  uint32_t count
+) {
+  // nearest-rank percentiles.
+  const double p50 = sorted[(count - 1) * 50 / 100];
+  const double p90 = sorted[(count - 1) * 90 / 100];
+  const double p99 = sorted[(count - 1) * 99 / 100];
+
+  if (run->baselineCount != 0) {
+    compareResult(run, name, unit, isRate, p50);
+  }
+
+  if (run->isJson) {
+    printf(
+      "%s  {\"name\": \"%s\", \"unit\": \"%s\", \"reps\": %u, "
+      "\"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f}",
+      run->resultCount == 0 ? "" : ",\n",
+      name,
+      unit,
+      count,
+      sorted[0],
+      p50,
+      p90,
+      p99
+    );
+  } else if (run->baselineCount == 0) {
+    printf(
+      "%-36s %12.2f %12.2f %12.2f %12.2f  %s\n",
+      name,
+      sorted[0],
+      p50,
+      p90,
+      p99,
+      unit
+    );
+  }
+
+  run->resultCount++;
+  fflush(stdout);
+}
+
+bool isBenchSelected(BenchRun *run, const char *name) {
+  return run->filter == NULL || strstr(name, run->filter) != NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+static uint64_t timeBatch(const Bench *bench, void *state, uint32_t batch) {
+  const uint64_t start = nowNs();
+
+  for (uint32_t i = 0; i < batch; i++) {
+    bench->run(state);
+  }
+
+  return nowNs() - start;
+}
+
+static void measure(BenchRun *run, const Bench *bench, bool isRate) {
+  char name[BENCH_NAME_MAX];
+
+  if (bench->param == 0) {
+    snprintf(name, sizeof (name), "%s", bench->name);
+  } else {
+    snprintf(name, sizeof (name), "%s/%u", bench->name, bench->param);
+  }
+
+  if (!isBenchSelected(run, name)) {
+    return;
+  }
+
+  uint32_t ops = 1;
+  void *state = bench->setup(bench->param, &ops);
+
+  // warming up also finds how many calls make up a repetition.
+  uint32_t batch = 1;
+  const uint64_t warmupEnd = nowNs() + WARMUP_NS;
+
+  while (true) {
+    const uint64_t elapsed = timeBatch(bench, state, batch);
+
+    if (elapsed < MIN_REP_NS && batch < MAX_BATCH) {
+      batch *= 2;
+      continue;
+    }
+
+    if (nowNs() >= warmupEnd) {
+      break;
+    }
+  }
+
+  double *samples = ALLOC(double, run->reps);
+
+  for (uint32_t i = 0; i < run->reps; i++) {
+    const uint64_t elapsed = timeBatch(bench, state, batch);
+
+    samples[i] = (double)elapsed / ((double)batch * ops);
+  }
+
+  bench->teardown(state);
+
+  qsort(samples, run->reps, sizeof (double), compareDoubles);
+
+  // a byte per nanosecond is a gigabyte per second.
+  if (isRate) {
+    for (uint32_t i = 0; i < run->reps; i++) {
+      samples[i] = 1 / samples[i];
+    }
+  }
+
+  report(
+    run,
+    name,
+    isRate ? "GB/s" : "ns/op",
+    isRate,
+    samples,
+    run->reps
+  );
+
+  FREE_ARR(double, samples, run->reps);
+}
+
+void runBench(BenchRun *run, const Bench *bench) {
+  measure(run, bench, false);
+}
+
+void runRateBench(BenchRun *run, const Bench *bench) {
+  measure(run, bench, true);
+}
+
+void reportStat(
+  BenchRun *run,
+  const char *name,
+  const char *unit,
+  double value
+) {
+  if (isBenchSelected(run, name)) {
+    report(run, name, unit, false, &value, 1);
+  }
+}
+
+void freeBenchRun(BenchRun *run) {
+  for (uint32_t i = 0; i < run->baselineCount; i++) {
+    char *name = run->baselines[i].name;
+    FREE_VAR_ARR(name, strlen(name) + 1);
+  }
+
+  FREE_ARR(Baseline, run->baselines, run->baselineCap);
+  initBenchRun(run);
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "const.h"
+#include "image.h"
+#include "mem.h"
+#include "vm.h"
+
+// NOLINTBEGIN
+#define CONST_STR_MAX 32
+// NOLINTEND
+
+typedef enum {
+  CONSTS_NUMS,
+  CONSTS_STRS,
+  CONSTS_USTRS,
+  CONSTS_TABLE
+} ConstKind;
+
+typedef struct {
+  uint8_t *bytes;
+  size_t length;
+} ConstState;
+
+static void imageNthStr(Image *image, ConstKind kind, uint32_t i) {
+  char chars[CONST_STR_MAX];
+
+  if (kind == CONSTS_USTRS) {
+    // 4 two-byte code points, then the digits.
+    const int length = snprintf(chars, sizeof (chars), "ключ%u", i);
+    const uint32_t byteLength = (uint32_t)length;
+
+    imageUStr(image, STR_UTF8, chars, byteLength - 4, byteLength, true);
+    return;
+  }
+
+  const int length = snprintf(chars, sizeof (chars), "const%u", i);
+  imageStr(image, chars, (uint32_t)length, true);
+}
+
+static ConstState *newConstState(ConstKind kind, uint32_t count) {
+  Image image;
+  initImage(&image);
+
+  if (kind == CONSTS_TABLE) {
+    imageTable(&image, count);
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    switch (kind) {
+      case CONSTS_NUMS:
+        imageNum(&image, i * 0.5);
+        break;
+
+      case CONSTS_STRS:
+      case CONSTS_USTRS:
+        imageNthStr(&image, kind, i);
+        break;
+
+      case CONSTS_TABLE:
+        imageNthStr(&image, CONSTS_STRS, i);
+        imageNum(&image, i);
+        break;
+    }
+  }
+
+  imageByte(&image, OP_NIL);
+  imageByte(&image, 0);
+  imageByte(&image, OP_RET);
+  imageByte(&image, 0);
+
+  ConstState *state = ALLOC(ConstState, 1);
+  state->bytes = finishImage(&image, "bench.ne", &state->length);
+
+  return state;
+}
+
+static void *setupNums(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newConstState(CONSTS_NUMS, count);
+}
+
+static void *setupStrs(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newConstState(CONSTS_STRS, count);
+}
+
+static void *setupUStrs(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newConstState(CONSTS_USTRS, count);
+}
+
+static void *setupTable(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newConstState(CONSTS_TABLE, count);
+}
+
+// every constant is loaded into a fresh VM, the way a program starts.
+static void runReadConsts(void *state) {
+  ConstState *consts = state;
+
+  NeveVM vm = newVM();
+  ValArr arr = newValArr();
+
+  Bytecode bytecode = newBytecode(consts->bytes, consts->length);
+  size_t offset = 0;
+
+  if (!readConsts(&vm, &arr, &bytecode, &offset)) {
+    fprintf(stderr, "neve-bench: failed to load constants\n");
+    exit(1);
+  }
+
+  benchSink(arr.next);
+
+  freeValArr(&arr);
+  freeVM(&vm);
+}
+
+static void teardownConsts(void *state) {
+  ConstState *consts = state;
+
+  free(consts->bytes);
+  FREE(ConstState, consts);
+}
+
+void constBenches(BenchRun *run) {
+  const uint32_t count = 4096;
+
+  const Bench benches[] = {
+    {"readConsts/nums", count, setupNums, runReadConsts, teardownConsts},
+    {"readConsts/strs", count, setupStrs, runReadConsts, teardownConsts},
+    {"readConsts/ustrs", count, setupUStrs, runReadConsts, teardownConsts},
+    {"readConsts/table", count, setupTable, runReadConsts, teardownConsts}
+  };
+
+  for (size_t i = 0; i < sizeof (benches) / sizeof (benches[0]); i++) {
+    runBench(run, &benches[i]);
+  }
+
+  // a table constant whose hash part doesn’t fit in cache.
+  const Bench bigTable = {
+    "readConsts/table",
+    262144,
+    setupTable,
+    runReadConsts,
+    teardownConsts
+  };
+
+  runBench(run, &bigTable);
+}
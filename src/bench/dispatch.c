@@ -0,0 +1,212 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "image.h"
+#include "mem.h"
+#include "vm.h"
+
+// NOLINTBEGIN
+#define TABLE_KEY_COUNT 64
+#define FIRST_KEY_REG   16
+// NOLINTEND
+
+#define ARR_LENGTH(arr) (sizeof (arr) / sizeof ((arr)[0]))
+
+typedef enum {
+  PROGRAM_ARITH,
+  PROGRAM_STRS,
+  PROGRAM_TABLES
+} Program;
+
+typedef struct {
+  uint8_t *bytes;
+  size_t length;
+
+  // OP_RET prints, and printing isn’t what’s being measured.
+  int devNull;
+} DispatchState;
+
+typedef struct {
+  uint8_t length;
+  uint8_t bytes[5];
+} Instr;
+
+// number crunching: every instruction is a cheap one, so this is mostly
+// the cost of dispatching.
+static const Instr arithInstrs[] = {
+  {4, {OP_ADD, 2, 0, 1}},
+  {4, {OP_MUL, 3, 2, 1}},
+  {4, {OP_SUB, 4, 3, 0}},
+  {4, {OP_LT, 5, 4, 0}},
+  {3, {OP_NOT, 6, 5}},
+  {4, {OP_EQ, 7, 4, 3}},
+  {3, {OP_NEG, 8, 4}},
+  {3, {OP_ISZ, 9, 8}}
+};
+
+// short strings, which all end up interned.
+static const Instr strInstrs[] = {
+  {4, {OP_CONCAT, 4, 0, 1}},
+  {4, {OP_CONCATN, 5, 0, 3}},
+  {4, {OP_INTERP, 6, 2, 0}},
+  {5, {OP_SLICE, 7, 4, 8, 9}},
+  {4, {OP_CHARAT, 10, 5, 9}}
+};
+
+static void emit(Image *image, Instr instr) {
+  for (uint8_t i = 0; i < instr.length; i++) {
+    imageByte(image, instr.bytes[i]);
+  }
+}
+
+// alternately stores into and reads back from the table in r0, cycling
+// through the keys.
+static Instr tableInstr(uint32_t i) {
+  const uint8_t keyReg = (uint8_t)(FIRST_KEY_REG + i / 2 % TABLE_KEY_COUNT);
+
+  if (i % 2 == 0) {
+    return (Instr){4, {OP_TABLESET, 0, keyReg, 1}};
+  }
+
+  return (Instr){4, {OP_TABLEGET, 2, 0, keyReg}};
+}
+
+static void emitPrologue(Image *image, Program program) {
+  switch (program) {
+    case PROGRAM_ARITH:
+      imageNum(image, 1.5);
+      imageNum(image, 2.25);
+
+      emit(image, (Instr){3, {OP_PUSH, 0, 0}});
+      emit(image, (Instr){3, {OP_PUSH, 1, 1}});
+      break;
+
+    case PROGRAM_STRS:
+      imageStr(image, "ab", 2, true);
+      imageStr(image, "cd", 2, true);
+      imageStr(image, "<{}>", 4, true);
+      imageNum(image, 3);
+
+      emit(image, (Instr){3, {OP_PUSH, 0, 0}});
+      emit(image, (Instr){3, {OP_PUSH, 1, 1}});
+      emit(image, (Instr){2, {OP_NIL, 2}});
+      emit(image, (Instr){2, {OP_ONE, 8}});
+      emit(image, (Instr){3, {OP_PUSH, 9, 3}});
+      emit(image, (Instr){4, {OP_CONCAT, 4, 0, 1}});
+      emit(image, (Instr){4, {OP_CONCAT, 5, 0, 1}});
+      break;
+
+    case PROGRAM_TABLES:
+      emit(image, (Instr){2, {OP_TABLENEW, 0}});
+      emit(image, (Instr){2, {OP_ONE, 1}});
+
+      // half strings, half numbers that aren’t list indices.
+      for (uint32_t i = 0; i < TABLE_KEY_COUNT; i++) {
+        char key[16];
+        const int length = snprintf(key, sizeof (key), "key%u", i);
+
+        if (i % 2 == 0) {
+          imageStr(image, key, (uint32_t)length, true);
+        } else {
+          imageNum(image, i + 0.5);
+        }
+
+        const uint8_t keyReg = (uint8_t)(FIRST_KEY_REG + i);
+        emit(image, (Instr){3, {OP_PUSH, keyReg, (uint8_t)i}});
+      }
+
+      break;
+  }
+}
+
+static DispatchState *newDispatchState(Program program, uint32_t count) {
+  Image image;
+  initImage(&image);
+
+  emitPrologue(&image, program);
+
+  for (uint32_t i = 0; i < count; i++) {
+    switch (program) {
+      case PROGRAM_ARITH:
+        emit(&image, arithInstrs[i % ARR_LENGTH(arithInstrs)]);
+        break;
+
+      case PROGRAM_STRS:
+        emit(&image, strInstrs[i % ARR_LENGTH(strInstrs)]);
+        break;
+
+      case PROGRAM_TABLES:
+        emit(&image, tableInstr(i));
+        break;
+    }
+  }
+
+  emit(&image, (Instr){2, {OP_RET, 2}});
+
+  DispatchState *state = ALLOC(DispatchState, 1);
+
+  state->bytes = finishImage(&image, "bench.ne", &state->length);
+  state->devNull = open("/dev/null", O_WRONLY);
+
+  return state;
+}
+
+static void *setupArith(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newDispatchState(PROGRAM_ARITH, count);
+}
+
+static void *setupStrs(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newDispatchState(PROGRAM_STRS, count);
+}
+
+static void *setupTables(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newDispatchState(PROGRAM_TABLES, count);
+}
+
+// the program has no loops, so it’s long and straight instead; times are
+// per instruction, VM start-up included.
+static void runProgram(void *state) {
+  DispatchState *dispatch = state;
+
+  NeveVM vm = newVM();
+  vm.out.fd = dispatch->devNull;
+  resetStack(&vm);
+
+  Bytecode bytecode = newBytecode(dispatch->bytes, dispatch->length);
+
+  if (interpret("bench.nv", &vm, &bytecode) != AFTERMATH_OK) {
+    fprintf(stderr, "neve-bench: the dispatch program failed\n");
+    exit(1);
+  }
+
+  freeVM(&vm);
+}
+
+static void teardownDispatch(void *state) {
+  DispatchState *dispatch = state;
+
+  close(dispatch->devNull);
+  free(dispatch->bytes);
+
+  FREE(DispatchState, dispatch);
+}
+
+void dispatchBenches(BenchRun *run) {
+  const uint32_t count = 65536;
+
+  const Bench benches[] = {
+    {"dispatch/arith", count, setupArith, runProgram, teardownDispatch},
+    {"dispatch/strs", count, setupStrs, runProgram, teardownDispatch},
+    {"dispatch/tables", count, setupTables, runProgram, teardownDispatch}
+  };
+
+  for (size_t i = 0; i < sizeof (benches) / sizeof (benches[0]); i++) {
+    runBench(run, &benches[i]);
+  }
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "hash.h"
+#include "mem.h"
+#include "obj.h"
+
+// NOLINTBEGIN
+#define HASH_KEY_COUNT 256
+
+// the probe-length stats insert this many keys into a linear-probing table
+// of PROBE_CAP slots, which puts it at about 76% load.
+#define PROBE_KEY_COUNT 200000
+#define PROBE_CAP       (1u << 18)
+#define PROBE_KEY_MAX   16
+// NOLINTEND
+
+typedef struct {
+  uint32_t length;
+  char *bytes;
+} HashKeys;
+
+static void *setupHashStr(uint32_t length, uint32_t *ops) {
+  HashKeys *keys = ALLOC(HashKeys, 1);
+  const size_t size = (size_t)length * HASH_KEY_COUNT;
+
+  keys->length = length;
+  keys->bytes = ALLOC(char, size);
+
+  uint64_t seed = length;
+
+  for (size_t i = 0; i < size; i++) {
+    keys->bytes[i] = (char)('a' + benchRand(&seed) % 26);
+  }
+
+  *ops = HASH_KEY_COUNT;
+  return keys;
+}
+
+static void runHashStr(void *state) {
+  const HashKeys *keys = state;
+  uint64_t sum = 0;
+
+  for (uint32_t i = 0; i < HASH_KEY_COUNT; i++) {
+    sum += hashStr(&keys->bytes[(size_t)i * keys->length], keys->length);
+  }
+
+  benchSink(sum);
+}
+
+static void teardownHashStr(void *state) {
+  HashKeys *keys = state;
+
+  FREE_ARR(char, keys->bytes, (size_t)keys->length * HASH_KEY_COUNT);
+  FREE(HashKeys, keys);
+}
+
+static void *setupHashNum(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  Val *nums = ALLOC(Val, HASH_KEY_COUNT);
+
+  for (uint32_t i = 0; i < HASH_KEY_COUNT; i++) {
+    nums[i] = NUM_VAL(i * 0.1);
+  }
+
+  *ops = HASH_KEY_COUNT;
+  return nums;
+}
+
+static void runHashNum(void *state) {
+  const Val *nums = state;
+  uint64_t sum = 0;
+
+  for (uint32_t i = 0; i < HASH_KEY_COUNT; i++) {
+    sum += hashVal(nums[i]);
+  }
+
+  benchSink(sum);
+}
+
+static void teardownHashNum(void *state) {
+  FREE_ARR(Val, state, HASH_KEY_COUNT);
+}
+
+typedef enum {
+  KEYS_INTS,
+  KEYS_SPREAD_INTS,
+  KEYS_FRACTIONS,
+  KEYS_NUMBERED_STRS,
+  KEYS_WORDS
+} KeySet;
+
+static uint32_t keyHash(KeySet keySet, uint32_t i) {
+  char key[PROBE_KEY_MAX];
+
+  switch (keySet) {
+    case KEYS_INTS:
+      return hashVal(NUM_VAL(i));
+
+    case KEYS_SPREAD_INTS:
+      return hashVal(NUM_VAL((double)i * 1024));
+
+    case KEYS_FRACTIONS:
+      return hashVal(NUM_VAL(i * 0.1));
+
+    case KEYS_NUMBERED_STRS: {
+      const int length = snprintf(key, sizeof (key), "key%u", i);
+      return hashStr(key, (uint32_t)length);
+    }
+
+    case KEYS_WORDS:
+      // every 4-letter lowercase word, in order.
+      for (int j = 3; j >= 0; j--) {
+        key[j] = (char)('a' + i % 26);
+        i /= 26;
+      }
+
+      return hashStr(key, 4);
+  }
+
+  return 0;
+}
+
+// how many slots a lookup looks at on average once every key is in a
+// table that probes linearly from `hash & (cap - 1)`.  it only depends on
+// how well the hash spreads the keys, not on how the real tables probe:
+// for a perfect hash at this load it’s about 2.6.
+static double averageProbes(KeySet keySet) {
+  bool *isFull = ALLOC(bool, PROBE_CAP);
+  memset(isFull, 0, sizeof (bool) * PROBE_CAP);
+
+  uint64_t probes = 0;
+
+  for (uint32_t i = 0; i < PROBE_KEY_COUNT; i++) {
+    uint32_t slot = keyHash(keySet, i) & (PROBE_CAP - 1);
+    probes++;
+
+    while (isFull[slot]) {
+      slot = (slot + 1) & (PROBE_CAP - 1);
+      probes++;
+    }
+
+    isFull[slot] = true;
+  }
+
+  FREE_ARR(bool, isFull, PROBE_CAP);
+  return (double)probes / PROBE_KEY_COUNT;
+}
+
+void hashBenches(BenchRun *run) {
+  static const uint32_t lengths[] = {4, 16, 64, 256, 4096};
+
+  for (size_t i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++) {
+    const Bench bench = {
+      .name = "hashStr",
+      .param = lengths[i],
+      .setup = setupHashStr,
+      .run = runHashStr,
+      .teardown = teardownHashStr
+    };
+
+    runBench(run, &bench);
+  }
+
+  const Bench hashNum = {
+    .name = "hashVal/num",
+    .setup = setupHashNum,
+    .run = runHashNum,
+    .teardown = teardownHashNum
+  };
+
+  runBench(run, &hashNum);
+
+  static const struct {
+    const char *name;
+    KeySet keySet;
+  } keySets[] = {
+    {"probes/ints", KEYS_INTS},
+    {"probes/ints*1024", KEYS_SPREAD_INTS},
+    {"probes/i*0.1", KEYS_FRACTIONS},
+    {"probes/key%u", KEYS_NUMBERED_STRS},
+    {"probes/4-letter-words", KEYS_WORDS}
+  };
+
+  for (size_t i = 0; i < sizeof (keySets) / sizeof (keySets[0]); i++) {
+    if (isBenchSelected(run, keySets[i].name)) {
+      reportStat(
+        run,
+        keySets[i].name,
+        "probes",
+        averageProbes(keySets[i].keySet)
+      );
+    }
+  }
+}
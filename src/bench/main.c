@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "err.h"
+#include "hash.h"
+
+// NOLINTBEGIN
+#define DEFAULT_REPS      25
+#define DEFAULT_THRESHOLD 5.0
+// NOLINTEND
+
+#define USAGE                                                         \
+  "usage: `neve-bench [--filter <text>] [--reps <n>] [--json] "         \
+  "[--compare <results.json>] [--threshold <percent>]`"
+
+static void usage(void) {
+  cliErr(USAGE);
+  exit(1);
+}
+
+// asked for, usage isn’t an error.
+static void help(void) {
+  printf("%s\n", USAGE);
+  exit(0);
+}
+
+static const char *nextArg(int *i, const int argc, const char **argv) {
+  if (*i + 1 >= argc) {
+    usage();
+  }
+
+  return argv[++*i];
+}
+
+int main(const int argc, const char **argv) {
+  BenchRun run;
+  initBenchRun(&run);
+
+  run.reps = DEFAULT_REPS;
+  run.threshold = DEFAULT_THRESHOLD;
+
+  const char *baselinePath = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0) {
+      help();
+    } else if (strcmp(argv[i], "--filter") == 0) {
+      run.filter = nextArg(&i, argc, argv);
+    } else if (strcmp(argv[i], "--reps") == 0) {
+      run.reps = (uint32_t)strtoul(nextArg(&i, argc, argv), NULL, 10);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      run.isJson = true;
+    } else if (strcmp(argv[i], "--compare") == 0) {
+      baselinePath = nextArg(&i, argc, argv);
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      run.threshold = strtod(nextArg(&i, argc, argv), NULL);
+    } else {
+      usage();
+    }
+  }
+
+  if (run.reps == 0) {
+    usage();
+  }
+
+  if (baselinePath != NULL && !readBaselines(&run, baselinePath)) {
+    cliErr("%s: no results to compare against", baselinePath);
+    exit(1);
+  }
+
+  initHashSeed();
+
+  beginBenchRun(&run);
+
+  hashBenches(&run);
+  tableBenches(&run);
+  strBenches(&run);
+  constBenches(&run);
+  dispatchBenches(&run);
+  utf8Benches(&run);
+
+  endBenchRun(&run);
+
+  const bool hasRegressed = run.regressions != 0;
+  freeBenchRun(&run);
+
+  return hasRegressed ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "mem.h"
+#include "obj.h"
+#include "vm.h"
+
+// NOLINTBEGIN
+#define STR_COUNT    4096
+#define LOOKUP_COUNT 1024
+#define STR_STRIDE   16
+// NOLINTEND
+
+typedef struct {
+  NeveVM vm;
+
+  char *chars;
+  uint32_t lengths[STR_COUNT];
+  uint32_t hashes[STR_COUNT];
+
+  uint32_t lookups[LOOKUP_COUNT];
+} StrState;
+
+static StrState *newStrState(void) {
+  StrState *state = ALLOC(StrState, 1);
+
+  state->vm = newVM();
+  state->chars = ALLOC(char, (size_t)STR_COUNT * STR_STRIDE);
+
+  for (uint32_t i = 0; i < STR_COUNT; i++) {
+    char *chars = &state->chars[(size_t)i * STR_STRIDE];
+    const int length = snprintf(chars, STR_STRIDE, "str%u", i);
+
+    state->lengths[i] = (uint32_t)length;
+    state->hashes[i] = hashStr(chars, (uint32_t)length);
+  }
+
+  uint64_t seed = STR_COUNT;
+
+  for (uint32_t i = 0; i < LOOKUP_COUNT; i++) {
+    state->lookups[i] = (uint32_t)(benchRand(&seed) % STR_COUNT);
+  }
+
+  return state;
+}
+
+static ObjStr *allocNth(
+  NeveVM *vm,
+  StrState *state,
+  uint32_t i,
+  bool isInterned,
+  uint32_t hash
+) {
+  return allocStr(
+    vm,
+    false,
+    isInterned,
+    STR_UTF8,
+    &state->chars[(size_t)i * STR_STRIDE],
+    state->lengths[i],
+    state->lengths[i],
+    hash
+  );
+}
+
+// every string is already interned, so each call is a successful probe.
+static void *setupInternHits(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  StrState *state = newStrState();
+
+  for (uint32_t i = 0; i < STR_COUNT; i++) {
+    allocNth(&state->vm, state, i, true, state->hashes[i]);
+  }
+
+  *ops = LOOKUP_COUNT;
+  return state;
+}
+
+static void runInternHits(void *state) {
+  StrState *strs = state;
+  uint64_t sum = 0;
+
+  for (uint32_t i = 0; i < LOOKUP_COUNT; i++) {
+    const uint32_t pick = strs->lookups[i];
+
+    sum += allocNth(&strs->vm, strs, pick, true, strs->hashes[pick])->length;
+  }
+
+  benchSink(sum);
+}
+
+static void *setupNewStrs(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+
+  *ops = STR_COUNT;
+  return newStrState();
+}
+
+// strings are never freed before the VM is, so every call starts from a
+// fresh VM; that’s part of what’s timed.  hashing is too, since that’s
+// what newStrVal() does before interning.
+static void runInternNew(void *state) {
+  StrState *strs = state;
+  NeveVM vm = newVM();
+
+  for (uint32_t i = 0; i < STR_COUNT; i++) {
+    const char *chars = &strs->chars[(size_t)i * STR_STRIDE];
+    const uint32_t hash = hashStr(chars, strs->lengths[i]);
+
+    allocNth(&vm, strs, i, true, hash);
+  }
+
+  benchSink(vm.strs.count);
+  freeVM(&vm);
+}
+
+static void runUninterned(void *state) {
+  StrState *strs = state;
+  NeveVM vm = newVM();
+
+  for (uint32_t i = 0; i < STR_COUNT; i++) {
+    allocNth(&vm, strs, i, false, STR_UNHASHED);
+  }
+
+  benchSink((uint64_t)(uintptr_t)vm.objs);
+  freeVM(&vm);
+}
+
+static void teardownStrs(void *state) {
+  StrState *strs = state;
+
+  freeVM(&strs->vm);
+
+  FREE_ARR(char, strs->chars, (size_t)STR_COUNT * STR_STRIDE);
+  FREE(StrState, strs);
+}
+
+// a string of alternating 'a's and 'é's, `byteLength` bytes long, looked
+// up at random code points.  the first lookup leaves breadcrumbs on it.
+typedef struct {
+  NeveVM vm;
+
+  ObjStr *str;
+  char *chars;
+  uint32_t byteLength;
+
+  uint32_t lookups[LOOKUP_COUNT];
+} OffsetState;
+
+static void *setupOffsets(uint32_t byteLength, uint32_t *ops) {
+  OffsetState *state = ALLOC(OffsetState, 1);
+
+  state->vm = newVM();
+  state->chars = ALLOC(char, byteLength);
+  state->byteLength = byteLength;
+
+  const char pair[] = "a\xC3\xA9";
+  const uint32_t pairSize = sizeof (pair) - 1;
+
+  uint32_t used = 0;
+
+  for (; used + pairSize <= byteLength; used += pairSize) {
+    memcpy(&state->chars[used], pair, pairSize);
+  }
+
+  const uint32_t length = used / pairSize * 2;
+
+  state->str = allocStr(
+    &state->vm,
+    false,
+    false,
+    STR_UTF8,
+    state->chars,
+    length,
+    used,
+    STR_UNHASHED
+  );
+
+  uint64_t seed = byteLength;
+
+  for (uint32_t i = 0; i < LOOKUP_COUNT; i++) {
+    state->lookups[i] = (uint32_t)(benchRand(&seed) % length);
+  }
+
+  *ops = LOOKUP_COUNT;
+  return state;
+}
+
+static void runOffsets(void *state) {
+  OffsetState *offsets = state;
+  uint64_t sum = 0;
+
+  for (uint32_t i = 0; i < LOOKUP_COUNT; i++) {
+    sum += strOffset(offsets->str, offsets->lookups[i]);
+  }
+
+  benchSink(sum);
+}
+
+static void teardownOffsets(void *state) {
+  OffsetState *offsets = state;
+
+  freeVM(&offsets->vm);
+
+  FREE_ARR(char, offsets->chars, offsets->byteLength);
+  FREE(OffsetState, offsets);
+}
+
+void strBenches(BenchRun *run) {
+  const Bench benches[] = {
+    {"allocStr/intern-hit", 0, setupInternHits, runInternHits, teardownStrs},
+    {"allocStr/intern-new", 0, setupNewStrs, runInternNew, teardownStrs},
+    {"allocStr/uninterned", 0, setupNewStrs, runUninterned, teardownStrs}
+  };
+
+  for (size_t i = 0; i < sizeof (benches) / sizeof (benches[0]); i++) {
+    runBench(run, &benches[i]);
+  }
+
+  static const uint32_t sizes[] = {4096, 65536, 1048576};
+
+  for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+    const Bench bench = {
+      "strOffset/utf8",
+      sizes[i],
+      setupOffsets,
+      runOffsets,
+      teardownOffsets
+    };
+
+    runBench(run, &bench);
+  }
+}
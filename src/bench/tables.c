@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "mem.h"
+#include "obj.h"
+#include "table.h"
+#include "vm.h"
+
+// NOLINTBEGIN
+#define LOOKUP_COUNT 1024
+
+// tables this big get this many lookups instead, too many for them all to
+// stay in cache between calls.
+#define COLD_MIN_COUNT    (1 << 22)
+#define COLD_LOOKUP_COUNT (1 << 20)
+#define KEY_STRIDE   16
+
+// the load factor benchmarks all fill a hash part of this many slots to
+// some percentage of it.  reserving 7/8 of it up front, the maximum load,
+// keeps it from growing on the way.
+#define LOAD_SLOTS   (1 << 16)
+#define LOAD_RESERVE (LOAD_SLOTS - LOAD_SLOTS / 8)
+// NOLINTEND
+
+typedef struct {
+  NeveVM vm;
+  Table table;
+
+  uint32_t count;
+  char *chars;
+
+  // the keys that went in, and the ones that are looked up.
+  Val *keys;
+  Val *lookups;
+  uint32_t lookupCount;
+
+  // how many of `lookups` are deleted by each call, when deleting.
+  uint32_t delCount;
+
+  // churning replaces `keys` with fresh ones, numbered from here on.
+  uint64_t nextKey;
+  uint64_t seed;
+} TableState;
+
+// strings keep pointing into `chars`, which outlives them.  they’re hashed
+// up front, the way keys that have been looked up before would be.
+static Val strKey(TableState *state, uint32_t i, const char *format) {
+  char *chars = &state->chars[(size_t)i * KEY_STRIDE];
+  const int length = snprintf(chars, KEY_STRIDE, format, i);
+
+  ObjStr *str = allocStr(
+    &state->vm,
+    false,
+    false,
+    STR_UTF8,
+    chars,
+    (uint32_t)length,
+    (uint32_t)length,
+    STR_UNHASHED
+  );
+
+  hashObj(&str->obj);
+  return OBJ_VAL(str);
+}
+
+// the numbers aren’t integers, so they all go in the hash part.
+static Val numKey(uint32_t i) {
+  return NUM_VAL(i + 0.5);
+}
+
+static TableState *newTableState(
+  uint32_t count,
+  uint32_t reserve,
+  bool isStr,
+  bool isHit
+) {
+  TableState *state = ALLOC(TableState, 1);
+
+  state->vm = newVM();
+  initTable(&state->table, reserve);
+
+  state->count = count;
+  state->delCount = 0;
+  state->chars = isStr ? ALLOC(char, (size_t)count * 2 * KEY_STRIDE) : NULL;
+  state->keys = ALLOC(Val, count);
+
+  state->lookupCount = (
+    count >= COLD_MIN_COUNT ? COLD_LOOKUP_COUNT : LOOKUP_COUNT
+  );
+
+  state->lookups = ALLOC(Val, state->lookupCount);
+
+  for (uint32_t i = 0; i < count; i++) {
+    state->keys[i] = isStr ? strKey(state, i, "key%u") : numKey(i);
+    tableSet(&state->table, state->keys[i], NUM_VAL(i));
+  }
+
+  uint64_t seed = count;
+
+  for (uint32_t i = 0; i < state->lookupCount; i++) {
+    const uint32_t pick = (uint32_t)(benchRand(&seed) % count);
+
+    if (isHit) {
+      state->lookups[i] = state->keys[pick];
+    } else if (isStr) {
+      state->lookups[i] = strKey(state, count + pick, "nokey%u");
+    } else {
+      state->lookups[i] = numKey(count + pick);
+    }
+  }
+
+  return state;
+}
+
+static void *setupGets(
+  uint32_t count,
+  uint32_t *ops,
+  bool isStr,
+  bool isHit
+) {
+  TableState *state = newTableState(count, 0, isStr, isHit);
+
+  *ops = state->lookupCount;
+  return state;
+}
+
+static void *setupStrHits(uint32_t count, uint32_t *ops) {
+  return setupGets(count, ops, true, true);
+}
+
+static void *setupStrMisses(uint32_t count, uint32_t *ops) {
+  return setupGets(count, ops, true, false);
+}
+
+static void *setupNumHits(uint32_t count, uint32_t *ops) {
+  return setupGets(count, ops, false, true);
+}
+
+static uint32_t loadCount(uint32_t percent) {
+  return (uint32_t)((uint64_t)LOAD_SLOTS * percent / 100);
+}
+
+static void *setupLoadHits(uint32_t percent, uint32_t *ops) {
+  *ops = LOOKUP_COUNT;
+  return newTableState(loadCount(percent), LOAD_RESERVE, false, true);
+}
+
+static void *setupLoadMisses(uint32_t percent, uint32_t *ops) {
+  *ops = LOOKUP_COUNT;
+  return newTableState(loadCount(percent), LOAD_RESERVE, false, false);
+}
+
+static void runGets(void *state) {
+  TableState *tables = state;
+  uint64_t sum = 0;
+
+  for (uint32_t i = 0; i < tables->lookupCount; i++) {
+    sum += (uint64_t)tableGet(&tables->table, tables->lookups[i]).type;
+  }
+
+  benchSink(sum);
+}
+
+static void *setupSets(uint32_t count, uint32_t *ops) {
+  *ops = count;
+  return newTableState(count, 0, false, true);
+}
+
+static void runSets(void *state) {
+  TableState *tables = state;
+
+  Table table;
+  initTable(&table, 0);
+
+  for (uint32_t i = 0; i < tables->count; i++) {
+    tableSet(&table, tables->keys[i], NUM_VAL(i));
+  }
+
+  benchSink(table.count);
+  freeTable(&table);
+}
+
+// `count` different keys out of `keys`, in random order, go in `lookups`.
+static void pickDistinct(TableState *state, uint32_t count) {
+  Val *keys = ALLOC(Val, state->count);
+  memcpy(keys, state->keys, sizeof (Val) * state->count);
+
+  uint64_t seed = state->count;
+
+  for (uint32_t i = 0; i < count; i++) {
+    const uint32_t left = state->count - i;
+    const uint32_t pick = i + (uint32_t)(benchRand(&seed) % left);
+
+    state->lookups[i] = keys[pick];
+    keys[pick] = keys[i];
+  }
+
+  FREE_ARR(Val, keys, state->count);
+}
+
+// deletes are undone within the same call, so that every call starts from
+// the same table.  an eighth of it goes each time, which keeps it well 
+// clear of shrinking; the holes left behind still pile up until they’re
+// squeezed out, which is part of what deleting costs.
+static void *setupDels(uint32_t count, uint32_t *ops) {
+  TableState *state = newTableState(count, 0, false, true);
+
+  const uint32_t eighth = count / 8;
+  state->delCount = eighth < LOOKUP_COUNT ? eighth : LOOKUP_COUNT;
+
+  pickDistinct(state, state->delCount);
+
+  // each delete and each re-add counts as an operation.
+  *ops = 2 * state->delCount;
+  return state;
+}
+
+static void runDels(void *state) {
+  TableState *tables = state;
+
+  for (uint32_t i = 0; i < tables->delCount; i++) {
+    tableDel(&tables->table, tables->lookups[i]);
+  }
+
+  for (uint32_t i = 0; i < tables->delCount; i++) {
+    tableSet(&tables->table, tables->lookups[i], NUM_VAL(i));
+  }
+
+  benchSink(tables->table.count);
+}
+
+// a table that stays at `live` keys while the keys themselves keep 
+// changing: each round deletes a random one and inserts a key it’s never 
+// seen.  this is where tombstones, or holes in `entries`, pile up.
+static void *setupChurn(uint32_t live, uint32_t *ops) {
+  TableState *state = newTableState(live, 0, false, true);
+
+  state->nextKey = live;
+  state->seed = live;
+
+  *ops = LOOKUP_COUNT;
+  return state;
+}
+
+static void runChurn(void *state) {
+  TableState *tables = state;
+
+  for (uint32_t i = 0; i < LOOKUP_COUNT; i++) {
+    const uint32_t pick = (uint32_t)(
+      benchRand(&tables->seed) % tables->count
+    );
+
+    tableDel(&tables->table, tables->keys[pick]);
+
+    const Val key = NUM_VAL((double)tables->nextKey++ + 0.5);
+
+    tables->keys[pick] = key;
+    tableSet(&tables->table, key, NUM_VAL(i));
+  }
+
+  benchSink(tables->table.count);
+}
+
+static void teardownTables(void *state) {
+  TableState *tables = state;
+
+  freeTable(&tables->table);
+  freeVM(&tables->vm);
+
+  FREE_ARR(char, tables->chars, (size_t)tables->count * 2 * KEY_STRIDE);
+  FREE_ARR(Val, tables->keys, tables->count);
+  FREE_ARR(Val, tables->lookups, tables->lookupCount);
+  FREE(TableState, tables);
+}
+
+// findEntry() is long gone; lookups and inserts go through the public
+// entry points, which is what the VM calls anyway.  the same benchmarks 
+// build with every index mode in table.h, so that they can be compared
+// with --compare.
+void tableBenches(BenchRun *run) {
+  static const uint32_t sizes[] = {1024, 262144};
+
+  for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+    const Bench benches[] = {
+      {"tableGet/str-hit", sizes[i], setupStrHits, runGets, teardownTables},
+      {"tableGet/str-miss", sizes[i], setupStrMisses, runGets, teardownTables},
+      {"tableGet/num-hit", sizes[i], setupNumHits, runGets, teardownTables},
+      {"tableSet/num-new", sizes[i], setupSets, runSets, teardownTables},
+      {"tableDel/num-readd", sizes[i], setupDels, runDels, teardownTables}
+    };
+
+    for (size_t j = 0; j < sizeof (benches) / sizeof (benches[0]); j++) {
+      runBench(run, &benches[j]);
+    }
+  }
+
+  // a table well out of cache, which most lookups miss.
+  const Bench coldGets = {
+    "tableGet/num-hit",
+    COLD_MIN_COUNT,
+    setupNumHits,
+    runGets,
+    teardownTables
+  };
+
+  runBench(run, &coldGets);
+
+  static const uint32_t lives[] = {1024, 16384, 262144};
+
+  for (size_t i = 0; i < sizeof (lives) / sizeof (lives[0]); i++) {
+    const Bench churn = {
+      "tableChurn/num",
+      lives[i],
+      setupChurn,
+      runChurn,
+      teardownTables
+    };
+
+    runBench(run, &churn);
+  }
+
+  // the parameter is the load factor, in percent; 87 is as full as a
+  // hash part gets.
+  static const uint32_t loads[] = {25, 50, 75, 87};
+
+  for (size_t i = 0; i < sizeof (loads) / sizeof (loads[0]); i++) {
+    const Bench benches[] = {
+      {"tableGet/load-hit", loads[i], setupLoadHits, runGets, teardownTables},
+      {
+        "tableGet/load-miss",
+        loads[i],
+        setupLoadMisses,
+        runGets,
+        teardownTables
+      }
+    };
+
+    for (size_t j = 0; j < sizeof (benches) / sizeof (benches[0]); j++) {
+      runBench(run, &benches[j]);
+    }
+  }
+}
@@ -0,0 +1,210 @@
+#include <stdio.h>
+
+#include "bench.h"
+#include "mem.h"
+#include "transcode.h"
+#include "utf8.h"
+
+// NOLINTBEGIN
+#define CORPUS_SIZE    (1u << 20)
+#define BENCH_NAME_MAX 64
+// NOLINTEND
+
+// each corpus draws its code points from one of these ranges, or, for
+// the mixed one, from any of them.
+typedef struct {
+  uint32_t low;
+  uint32_t high;
+} Corpus;
+
+// NOLINTBEGIN
+static const Corpus corpora[] = {
+  {0x20, 0x7E},
+  {0xC0, 0x17F},
+  {0x400, 0x4FF},
+  {0x4E00, 0x9FFF},
+  {0x1F300, 0x1F64F}
+};
+// NOLINTEND
+
+#define CORPUS_COUNT (sizeof (corpora) / sizeof (corpora[0]))
+#define CORPUS_MIXED CORPUS_COUNT
+
+typedef struct {
+  char *chars;
+  uint32_t byteLength;
+  size_t cap;
+} Utf8State;
+
+// NOLINTBEGIN
+static uint32_t utf8Length(uint32_t codePoint) {
+  return codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 :
+    codePoint < 0x10000 ? 3 : 4;
+}
+// NOLINTEND
+
+// draws code points until their UTF-8 would pass CORPUS_SIZE bytes, and
+// lets the VM’s own encoder write them out.
+static void *setupCorpus(size_t corpus, uint32_t *ops) {
+  uint32_t *codePoints = ALLOC(uint32_t, CORPUS_SIZE);
+
+  uint64_t seed = corpus;
+  uint32_t count = 0;
+  uint32_t byteLength = 0;
+
+  while (true) {
+    const size_t range = (
+      corpus == CORPUS_MIXED ? benchRand(&seed) % CORPUS_COUNT : corpus
+    );
+
+    const Corpus *from = &corpora[range];
+    const uint32_t codePoint = (
+      from->low + (uint32_t)(benchRand(&seed) % (from->high - from->low + 1))
+    );
+
+    if (byteLength + utf8Length(codePoint) > CORPUS_SIZE) {
+      break;
+    }
+
+    codePoints[count++] = codePoint;
+    byteLength += utf8Length(codePoint);
+  }
+
+  const uint32_t utf32Length = count * (uint32_t)sizeof (uint32_t);
+
+  Utf8State *state = ALLOC(Utf8State, 1);
+  state->cap = transcodedCap(STR_UTF32, STR_UTF8, utf32Length);
+  state->chars = ALLOC(char, state->cap);
+
+  state->byteLength = transcode(
+    STR_UTF32,
+    STR_UTF8,
+    (const char *)codePoints,
+    utf32Length,
+    state->chars
+  );
+
+  FREE_ARR(uint32_t, codePoints, CORPUS_SIZE);
+
+  *ops = state->byteLength;
+  return state;
+}
+
+static void *setupAscii(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  return setupCorpus(0, ops);
+}
+
+static void *setupLatin(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  return setupCorpus(1, ops);
+}
+
+static void *setupCyrillic(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  return setupCorpus(2, ops);
+}
+
+static void *setupCjk(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  return setupCorpus(3, ops);
+}
+
+static void *setupEmoji(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  return setupCorpus(4, ops);
+}
+
+static void *setupMixed(uint32_t param, uint32_t *ops) {
+  IGNORE(param);
+  return setupCorpus(CORPUS_MIXED, ops);
+}
+
+static void runKernel(const Utf8State *state, Utf8Kernel kernel) {
+  uint32_t length = 0;
+
+  const bool isValid = validateUtf8With(
+    kernel,
+    state->chars,
+    state->byteLength,
+    &length
+  );
+
+  benchSink(isValid ? length : 0);
+}
+
+static void runScalar(void *state) {
+  runKernel(state, UTF8_KERNEL_SCALAR);
+}
+
+static void runSse2(void *state) {
+  runKernel(state, UTF8_KERNEL_SSE2);
+}
+
+static void runSsse3(void *state) {
+  runKernel(state, UTF8_KERNEL_SSSE3);
+}
+
+static void runAvx2(void *state) {
+  runKernel(state, UTF8_KERNEL_AVX2);
+}
+
+static void teardownCorpus(void *state) {
+  Utf8State *utf8 = state;
+
+  FREE_ARR(char, utf8->chars, utf8->cap);
+  FREE(Utf8State, utf8);
+}
+
+void utf8Benches(BenchRun *run) {
+  void *(*const setups[])(uint32_t, uint32_t *) = {
+    setupAscii,
+    setupLatin,
+    setupCyrillic,
+    setupCjk,
+    setupEmoji,
+    setupMixed
+  };
+
+  const char *corpusNames[] = {
+    "ascii", "latin", "cyrillic", "cjk", "emoji", "mixed"
+  };
+
+  const struct {
+    const char *name;
+    Utf8Kernel kernel;
+    void (*run)(void *state);
+  } kernels[] = {
+    {"scalar", UTF8_KERNEL_SCALAR, runScalar},
+    {"sse2", UTF8_KERNEL_SSE2, runSse2},
+    {"ssse3", UTF8_KERNEL_SSSE3, runSsse3},
+    {"avx2", UTF8_KERNEL_AVX2, runAvx2}
+  };
+
+  for (size_t i = 0; i < sizeof (setups) / sizeof (setups[0]); i++) {
+    for (size_t j = 0; j < sizeof (kernels) / sizeof (kernels[0]); j++) {
+      if (!hasUtf8Kernel(kernels[j].kernel)) {
+        continue;
+      }
+
+      char name[BENCH_NAME_MAX];
+      snprintf(
+        name,
+        sizeof (name),
+        "utf8/%s/%s",
+        corpusNames[i],
+        kernels[j].name
+      );
+
+      const Bench bench = {
+        name,
+        0,
+        setups[i],
+        kernels[j].run,
+        teardownCorpus
+      };
+
+      runRateBench(run, &bench);
+    }
+  }
+}
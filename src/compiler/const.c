@@ -3,6 +3,8 @@
 
 #include "const.h"
 #include "obj.h"
+#include "transcode.h"
+#include "utf8.h"
 
 #define READ(into, bytes, offset, type)                 \
   do {                                                  \
@@ -29,13 +31,29 @@ static size_t readStr(
 
   char *chars = (char *)(bytes + newOffset);
 
+  // plain strings carry only their byte length, so the logical one is
+  // counted here.
+  uint32_t codePoints;
+  if (!validateUtf8(chars, length, &codePoints)) {
+    return UNEXPECTED_BYTE;
+  }
+
   newOffset += length;
 
-  uint32_t hash = hashStr(chars, length);
-  
   const bool isInterned = bytes[newOffset++];
 
-  ObjStr *str = allocStr(vm, false, isInterned, chars, length, hash);
+  const uint32_t hash = isInterned ? hashStr(chars, length) : STR_UNHASHED;
+
+  ObjStr *str = allocStr(
+    vm, 
+    false, 
+    isInterned, 
+    STR_UTF8, 
+    chars, 
+    codePoints, 
+    length, 
+    hash
+  );
   *into = OBJ_VAL(str);
 
   return newOffset;
@@ -56,9 +74,6 @@ static size_t readTable(
   ObjTable *obj = newTable(vm, tableSize);
   Table *table = obj->table;
 
-  // TODO: determine whether we should keep things this way
-  // or avoid the overhead of tableSet(), even if this overhead
-  // only affects startup time.
   for (uint32_t i = 0; i < tableSize; i++) {
     Val key;
     newOffset = readConst(vm, &key, newOffset, bytecode);
@@ -77,6 +92,10 @@ static size_t readTable(
     tableSet(table, key, val);
   }
 
+  // constant tables are built once and read from then on.
+  tableCompact(table);
+  obj->obj.flags |= TABLE_CONST;
+
   *into = OBJ_VAL(obj);
 
   return newOffset;
@@ -92,6 +111,10 @@ static size_t readUStr(
   size_t newOffset = offset;
 
   const uint8_t byte = bytes[newOffset++];
+  if (byte > STR_UTF32) {
+    return UNEXPECTED_BYTE;
+  }
+
   const Encoding encoding = (Encoding)byte;
 
   uint32_t length;
@@ -105,16 +128,32 @@ static size_t readUStr(
     return UNEXPECTED_BYTE;
   }
 
-  void *contents = (void *)(bytes + newOffset);  
-  newOffset += byteLength;
+  const char *contents = (char *)(bytes + newOffset);  
+
+  // the logical length comes from the producer, and everything that 
+  // indexes or concatenates strings trusts it.
+  uint32_t codePoints;
+
+  const bool isValid = validateStr(
+    encoding,
+    contents,
+    byteLength,
+    &codePoints
+  );
+
+  if (!isValid || codePoints != length) {
+    return UNEXPECTED_BYTE;
+  }
 
-  // i'm not sure whether this is safe?
-  const char *key = (char *)contents;
-  const uint32_t hash = hashStr(key, byteLength);
+  newOffset += byteLength;
 
   const bool isInterned = (bool)bytes[newOffset++]; 
 
-  ObjUStr *str = allocUStr(
+  const uint32_t hash = (
+    isInterned ? hashStr(contents, byteLength) : STR_UNHASHED
+  );
+
+  ObjStr *str = allocStr(
     vm, 
     false, 
     isInterned, 
@@ -141,18 +180,18 @@ size_t readObj(
   const uint8_t *bytes = bytecode->bytes;
 
   uint8_t byte = bytes[newOffset++]; 
-  ObjType type = (ObjType)byte;
+  ConstObjTag tag = (ConstObjTag)byte;
 
-  switch (type) {
-    case OBJ_STR:
+  switch (tag) {
+    case CONST_OBJ_STR:
       newOffset = readStr(vm, into, newOffset, bytecode);
       break;
 
-    case OBJ_USTR:
+    case CONST_OBJ_USTR:
       newOffset = readUStr(vm, into, newOffset, bytecode);
       break;
 
-    case OBJ_TABLE:
+    case CONST_OBJ_TABLE:
       newOffset = readTable(vm, into, newOffset, bytecode);
       break;
 
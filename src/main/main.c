@@ -40,16 +40,28 @@ static const uint8_t *readFile(const char *fname, size_t *length) {
   return buf;
 }
 
-static void runFile(const char *fname) {
+static void runFile(const char *fname, bool isProfiled) {
   NeveVM vm = newVM();
   resetStack(&vm);
 
+  Profile profile;
+
+  if (isProfiled) {
+    initProfile(&profile);
+    vm.profile = &profile;
+  }
+
   size_t length;
   const uint8_t *bytes = readFile(fname, &length);
 
   Bytecode bytecode = newBytecode(bytes, length);
   Aftermath aftermath = interpret(fname, &vm, &bytecode); 
 
+  // a file that didn’t load never ran.
+  if (isProfiled && aftermath != AFTERMATH_FILE_FORMAT_ERR) {
+    reportProfile(&profile, &bytecode);
+  }
+
   freeVM(&vm);
   free((uint8_t *)bytes);
 
@@ -59,12 +71,14 @@ static void runFile(const char *fname) {
 }
 
 int main(const int argc, const char **argv) {
-  if (argc != 2) {
-    cliErr("usage: `neve <path>`");
+  const bool isProfiled = argc == 3 && strcmp(argv[1], "--profile") == 0;
+
+  if (argc != 2 && !isProfiled) {
+    cliErr("usage: `neve [--profile] <path>`");
     exit(1);
   }
 
-  runFile(argv[1]);
+  runFile(argv[argc - 1], isProfiled);
 
   return 0;
 }
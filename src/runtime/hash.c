@@ -0,0 +1,95 @@
+#include <string.h>
+#include <time.h>
+
+#include "hash.h"
+
+// xxHash64’s primes.
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+#define ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t hashSeed = 0;
+
+// murmur3’s 64-bit finalizer: every input bit affects every output bit.
+static uint64_t avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+
+  return h;
+}
+
+static uint64_t readWord(const char *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof (word));
+
+  return word;
+}
+
+static uint32_t readHalfWord(const char *bytes) {
+  uint32_t half;
+  memcpy(&half, bytes, sizeof (half));
+
+  return half;
+}
+
+static uint64_t mixWord(uint64_t h, uint64_t word) {
+  h ^= word * PRIME2;
+  h = ROTL(h, 31);
+
+  return h * PRIME1;
+}
+
+void initHashSeed(void) {
+  // nothing here is secret, but the address of a local moves around with
+  // ASLR, so it’s different enough from run to run to keep colliding keys
+  // from being baked into a program.
+  const uint64_t local = (uint64_t)(uintptr_t)&local;
+
+  hashSeed = avalanche(
+    local ^ 
+    ((uint64_t)time(NULL) * PRIME3) ^
+    ((uint64_t)clock() * PRIME5)
+  );
+}
+
+uint32_t hashBytes(const char *bytes, uint32_t length) {
+  uint64_t h = hashSeed + PRIME5 + length;
+
+  // every read below has a fixed size; short tails overlap bytes that were
+  // already read instead of being copied out one by one.  the length went
+  // into `h`, so that can’t make two different strings collide.
+  if (length >= 8) {
+    uint32_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+      h = mixWord(h, readWord(&bytes[i]));
+    }
+
+    if (i < length) {
+      h = mixWord(h, readWord(&bytes[length - 8]));
+    }
+  } else if (length >= 4) {
+    const uint64_t lo = readHalfWord(bytes);
+    const uint64_t hi = readHalfWord(&bytes[length - 4]);
+
+    h = mixWord(h, lo | hi << 32);
+  } else if (length > 0) {
+    const uint64_t first = (uint8_t)bytes[0];
+    const uint64_t middle = (uint8_t)bytes[length / 2];
+    const uint64_t last = (uint8_t)bytes[length - 1];
+
+    h = mixWord(h, first << 16 | middle << 8 | last);
+  }
+
+  return (uint32_t)avalanche(h);
+}
+
+uint32_t hashBits(uint64_t bits) {
+  return (uint32_t)avalanche(bits ^ hashSeed);
+}
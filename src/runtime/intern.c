@@ -0,0 +1,101 @@
+#include <string.h>
+
+#include "intern.h"
+#include "mem.h"
+#include "obj.h"
+
+#define INTERN_MAX_LOAD(cap) ((cap) - (cap) / 4)
+
+static InternSlot *allocSlots(uint32_t cap) {
+  InternSlot *slots = ALLOC(InternSlot, cap);
+  memset(slots, 0, sizeof (InternSlot) * cap);
+
+  return slots;
+}
+
+// only used when growing, where every string is known to be distinct.
+static void insertSlot(InternSlot *slots, uint32_t cap, InternSlot slot) {
+  const uint32_t mask = cap - 1;
+  uint32_t index = slot.hash & mask;
+
+  while (slots[index].str != NULL) {
+    index = (index + 1) & mask;
+  }
+
+  slots[index] = slot;
+}
+
+static void adjustCap(InternSet *set, uint32_t cap) {
+  InternSlot *slots = allocSlots(cap);
+
+  for (uint32_t i = 0; i < set->cap; i++) {
+    if (set->slots[i].str != NULL) {
+      insertSlot(slots, cap, set->slots[i]);
+    }
+  }
+
+  FREE_ARR(InternSlot, set->slots, set->cap);
+
+  set->slots = slots;
+  set->cap = cap;
+}
+
+void initInternSet(InternSet *set) {
+  set->cap = 0;
+  set->count = 0;
+  set->slots = NULL;
+}
+
+ObjStr *internSetFind(
+  InternSet *set,
+  const char *chars,
+  Encoding encoding,
+  uint32_t byteLength,
+  uint32_t hash
+) {
+  if (set->count == 0) {
+    return NULL;
+  }
+
+  const uint32_t mask = set->cap - 1;
+  uint32_t index = hash & mask;
+
+  while (true) {
+    const InternSlot *slot = &set->slots[index];
+
+    if (slot->str == NULL) {
+      return NULL;
+    }
+
+    if (
+      slot->hash == hash &&
+      slot->byteLength == byteLength &&
+      STR_ENCODING(slot->str) == encoding &&
+      memcmp(slot->str->chars, chars, byteLength) == 0
+    ) {
+      return slot->str;
+    }
+
+    index = (index + 1) & mask;
+  }
+}
+
+void internSetAdd(InternSet *set, ObjStr *str) {
+  if (set->count + 1 > INTERN_MAX_LOAD(set->cap)) {
+    adjustCap(set, GROW_CAP(set->cap));
+  }
+
+  const InternSlot slot = {
+    .hash = str->obj.hash,
+    .byteLength = str->byteLength,
+    .str = str
+  };
+
+  insertSlot(set->slots, set->cap, slot);
+  set->count++;
+}
+
+void freeInternSet(InternSet *set) {
+  FREE_ARR(InternSlot, set->slots, set->cap);
+  initInternSet(set);
+}
@@ -0,0 +1,467 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "num.h"
+
+// numbers whose first digit lands this far from the decimal point switch
+// to exponent notation, same as with "%.14g".
+#define MIN_FIXED_EXP -4
+#define MAX_FIXED_EXP 14
+
+#define SIGNIFICAND_BITS 52
+#define HIDDEN_BIT       (1ULL << SIGNIFICAND_BITS)
+#define SIGNIFICAND_MASK (HIDDEN_BIT - 1)
+#define EXP_MASK         0x7FF
+#define EXP_BIAS         (1023 + SIGNIFICAND_BITS)
+
+#define CACHED_POWER_MIN -348
+#define CACHED_POWER_STEP 8
+
+// NOLINTBEGIN
+
+// the digits come from Grisu3, from Florian Loitsch’s “Printing 
+// Floating-Point Numbers Quickly and Accurately with Integers”: the 
+// shortest ones that read back as the same double, and the closest of 
+// those.  it works out all but about one number in two hundred with 
+// 64-bit integers alone, and says so when it can’t.
+
+// a “do-it-yourself” float: f × 2^e, with all 64 bits of `f` to work with.
+typedef struct {
+  uint64_t f;
+  int e;
+} DiyFp;
+
+// 10^k for k = -348, -340, ..., 340, normalized.
+static const DiyFp cachedPowers[] = {
+  { 0xfa8fd5a0081c0288ULL, -1220 }, { 0xbaaee17fa23ebf76ULL, -1193 },
+  { 0x8b16fb203055ac76ULL, -1166 }, { 0xcf42894a5dce35eaULL, -1140 },
+  { 0x9a6bb0aa55653b2dULL, -1113 }, { 0xe61acf033d1a45dfULL, -1087 },
+  { 0xab70fe17c79ac6caULL, -1060 }, { 0xff77b1fcbebcdc4fULL, -1034 },
+  { 0xbe5691ef416bd60cULL, -1007 }, { 0x8dd01fad907ffc3cULL, -980 },
+  { 0xd3515c2831559a83ULL, -954 }, { 0x9d71ac8fada6c9b5ULL, -927 },
+  { 0xea9c227723ee8bcbULL, -901 }, { 0xaecc49914078536dULL, -874 },
+  { 0x823c12795db6ce57ULL, -847 }, { 0xc21094364dfb5637ULL, -821 },
+  { 0x9096ea6f3848984fULL, -794 }, { 0xd77485cb25823ac7ULL, -768 },
+  { 0xa086cfcd97bf97f4ULL, -741 }, { 0xef340a98172aace5ULL, -715 },
+  { 0xb23867fb2a35b28eULL, -688 }, { 0x84c8d4dfd2c63f3bULL, -661 },
+  { 0xc5dd44271ad3cdbaULL, -635 }, { 0x936b9fcebb25c996ULL, -608 },
+  { 0xdbac6c247d62a584ULL, -582 }, { 0xa3ab66580d5fdaf6ULL, -555 },
+  { 0xf3e2f893dec3f126ULL, -529 }, { 0xb5b5ada8aaff80b8ULL, -502 },
+  { 0x87625f056c7c4a8bULL, -475 }, { 0xc9bcff6034c13053ULL, -449 },
+  { 0x964e858c91ba2655ULL, -422 }, { 0xdff9772470297ebdULL, -396 },
+  { 0xa6dfbd9fb8e5b88fULL, -369 }, { 0xf8a95fcf88747d94ULL, -343 },
+  { 0xb94470938fa89bcfULL, -316 }, { 0x8a08f0f8bf0f156bULL, -289 },
+  { 0xcdb02555653131b6ULL, -263 }, { 0x993fe2c6d07b7facULL, -236 },
+  { 0xe45c10c42a2b3b06ULL, -210 }, { 0xaa242499697392d3ULL, -183 },
+  { 0xfd87b5f28300ca0eULL, -157 }, { 0xbce5086492111aebULL, -130 },
+  { 0x8cbccc096f5088ccULL, -103 }, { 0xd1b71758e219652cULL, -77 },
+  { 0x9c40000000000000ULL, -50 }, { 0xe8d4a51000000000ULL, -24 },
+  { 0xad78ebc5ac620000ULL, 3 }, { 0x813f3978f8940984ULL, 30 },
+  { 0xc097ce7bc90715b3ULL, 56 }, { 0x8f7e32ce7bea5c70ULL, 83 },
+  { 0xd5d238a4abe98068ULL, 109 }, { 0x9f4f2726179a2245ULL, 136 },
+  { 0xed63a231d4c4fb27ULL, 162 }, { 0xb0de65388cc8ada8ULL, 189 },
+  { 0x83c7088e1aab65dbULL, 216 }, { 0xc45d1df942711d9aULL, 242 },
+  { 0x924d692ca61be758ULL, 269 }, { 0xda01ee641a708deaULL, 295 },
+  { 0xa26da3999aef774aULL, 322 }, { 0xf209787bb47d6b85ULL, 348 },
+  { 0xb454e4a179dd1877ULL, 375 }, { 0x865b86925b9bc5c2ULL, 402 },
+  { 0xc83553c5c8965d3dULL, 428 }, { 0x952ab45cfa97a0b3ULL, 455 },
+  { 0xde469fbd99a05fe3ULL, 481 }, { 0xa59bc234db398c25ULL, 508 },
+  { 0xf6c69a72a3989f5cULL, 534 }, { 0xb7dcbf5354e9beceULL, 561 },
+  { 0x88fcf317f22241e2ULL, 588 }, { 0xcc20ce9bd35c78a5ULL, 614 },
+  { 0x98165af37b2153dfULL, 641 }, { 0xe2a0b5dc971f303aULL, 667 },
+  { 0xa8d9d1535ce3b396ULL, 694 }, { 0xfb9b7cd9a4a7443cULL, 720 },
+  { 0xbb764c4ca7a44410ULL, 747 }, { 0x8bab8eefb6409c1aULL, 774 },
+  { 0xd01fef10a657842cULL, 800 }, { 0x9b10a4e5e9913129ULL, 827 },
+  { 0xe7109bfba19c0c9dULL, 853 }, { 0xac2820d9623bf429ULL, 880 },
+  { 0x80444b5e7aa7cf85ULL, 907 }, { 0xbf21e44003acdd2dULL, 933 },
+  { 0x8e679c2f5e44ff8fULL, 960 }, { 0xd433179d9c8cb841ULL, 986 },
+  { 0x9e19db92b4e31ba9ULL, 1013 }, { 0xeb96bf6ebadf77d9ULL, 1039 },
+  { 0xaf87023b9bf0ee6bULL, 1066 },
+};
+
+static const uint32_t pow10s[] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static DiyFp normalize(DiyFp x) {
+  const int shift = __builtin_clzll(x.f);
+
+  return (DiyFp){ x.f << shift, x.e - shift };
+}
+
+// the upper 64 bits of the 128-bit product, rounded.
+static DiyFp mul(DiyFp a, DiyFp b) {
+  const uint64_t mask = 0xFFFFFFFF;
+
+  const uint64_t ac = (a.f >> 32) * (b.f >> 32);
+  const uint64_t bc = (a.f & mask) * (b.f >> 32);
+  const uint64_t ad = (a.f >> 32) * (b.f & mask);
+  const uint64_t bd = (a.f & mask) * (b.f & mask);
+
+  const uint64_t mid = (bd >> 32) + (ad & mask) + (bc & mask) + (1ULL << 31);
+
+  return (DiyFp){
+    ac + (ad >> 32) + (bc >> 32) + (mid >> 32),
+    a.e + b.e + 64
+  };
+}
+
+// a power of ten that brings a product’s exponent into [-60, -32], so that
+// its integral part fits in 32 bits.  `k` is set to minus its exponent.
+static DiyFp cachedPower(int e, int *k) {
+  const double dk = (-61 - e) * 0.30102999566398114 + 347;
+
+  int i = (int)dk;
+  if (dk - i > 0.0) {
+    i++;
+  }
+
+  const int index = (i >> 3) + 1;
+  *k = -(CACHED_POWER_MIN + index * CACHED_POWER_STEP);
+
+  return cachedPowers[index];
+}
+
+static int countDigits(uint32_t n) {
+  int count = 1;
+
+  while (count < 10 && n >= pow10s[count]) {
+    count++;
+  }
+
+  return count;
+}
+
+// nudges the last digit down while that brings it closer to `num`, then
+// checks that it’s certain to be the closest and the shortest.  the 
+// products are only exact to within `unit`, so sometimes it can’t be.
+static bool roundWeed(
+  char *digits,
+  uint32_t length,
+  uint64_t distance,
+  uint64_t unsafeInterval,
+  uint64_t rest,
+  uint64_t tenKappa,
+  uint64_t unit
+) {
+  const uint64_t smallDistance = distance - unit;
+  const uint64_t bigDistance = distance + unit;
+
+  while (
+    rest < smallDistance &&
+    unsafeInterval - rest >= tenKappa &&
+    (
+      rest + tenKappa < smallDistance ||
+      smallDistance - rest >= rest + tenKappa - smallDistance
+    )
+  ) {
+    digits[length - 1]--;
+    rest += tenKappa;
+  }
+
+  if (
+    rest < bigDistance &&
+    unsafeInterval - rest >= tenKappa &&
+    (
+      rest + tenKappa < bigDistance ||
+      bigDistance - rest > rest + tenKappa - bigDistance
+    )
+  ) {
+    return false;
+  }
+
+  return 2 * unit <= rest && rest <= unsafeInterval - 4 * unit;
+}
+
+// cuts digits out of the upper boundary until what’s left is within the 
+// boundaries.  those are widened by a unit to cover the products’ error, 
+// and roundWeed() makes sure that didn’t matter.
+static bool digitGen(
+  DiyFp low,
+  DiyFp w,
+  DiyFp high,
+  char *digits,
+  uint32_t *length,
+  int *kappa
+) {
+  uint64_t unit = 1;
+
+  const uint64_t tooLow = low.f - unit;
+  const uint64_t tooHigh = high.f + unit;
+
+  uint64_t unsafeInterval = tooHigh - tooLow;
+
+  const int shift = -w.e;
+  const uint64_t one = 1ULL << shift;
+
+  uint32_t integral = (uint32_t)(tooHigh >> shift);
+  uint64_t fraction = tooHigh & (one - 1);
+
+  *length = 0;
+  *kappa = countDigits(integral);
+
+  while (*kappa > 0) {
+    const uint32_t pow10 = pow10s[*kappa - 1];
+
+    digits[(*length)++] = (char)('0' + integral / pow10);
+
+    integral %= pow10;
+    (*kappa)--;
+
+    const uint64_t rest = ((uint64_t)integral << shift) + fraction;
+
+    if (rest < unsafeInterval) {
+      return roundWeed(
+        digits,
+        *length,
+        tooHigh - w.f,
+        unsafeInterval,
+        rest,
+        (uint64_t)pow10 << shift,
+        unit
+      );
+    }
+  }
+
+  // past the decimal point, everything is scaled up by ten per digit.
+  while (true) {
+    fraction *= 10;
+    unit *= 10;
+    unsafeInterval *= 10;
+
+    digits[(*length)++] = (char)('0' + (fraction >> shift));
+
+    fraction &= one - 1;
+    (*kappa)--;
+
+    if (fraction < unsafeInterval) {
+      return roundWeed(
+        digits,
+        *length,
+        (tooHigh - w.f) * unit,
+        unsafeInterval,
+        fraction,
+        one,
+        unit
+      );
+    }
+  }
+}
+
+// writes the digits of `num`, which must be positive and finite, and sets
+// `k` so that `num` is those digits × 10^k.  fails for the few numbers 
+// where it can’t tell which digits are shortest.
+static bool grisu3(double num, char *digits, uint32_t *length, int *k) {
+  uint64_t bits;
+  memcpy(&bits, &num, sizeof (bits));
+
+  const uint64_t significand = bits & SIGNIFICAND_MASK;
+  const int biasedExp = (int)((bits >> SIGNIFICAND_BITS) & EXP_MASK);
+
+  const DiyFp v = biasedExp != 0
+    ? (DiyFp){ significand + HIDDEN_BIT, biasedExp - EXP_BIAS }
+    : (DiyFp){ significand, 1 - EXP_BIAS };
+
+  // anything strictly between these two reads back as `num`.  the gap
+  // below a power of two is half the one above it.
+  const DiyFp plus = normalize((DiyFp){ (v.f << 1) + 1, v.e - 1 });
+
+  DiyFp minus = v.f == HIDDEN_BIT && biasedExp > 1
+    ? (DiyFp){ (v.f << 2) - 1, v.e - 2 }
+    : (DiyFp){ (v.f << 1) - 1, v.e - 1 };
+
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+
+  const DiyFp w = normalize(v);
+
+  const DiyFp power = cachedPower(w.e, k);
+
+  int kappa;
+  const bool isExact = digitGen(
+    mul(minus, power),
+    mul(w, power),
+    mul(plus, power),
+    digits,
+    length,
+    &kappa
+  );
+
+  *k += kappa;
+
+  return isExact;
+}
+
+// the slow way, for whatever grisu3() gives up on: the fewest correctly 
+// rounded digits that strtod() reads back as `num`.
+static uint32_t slowDigits(double num, char *digits, int *k) {
+  const int maxDigits = 17;
+
+  char buffer[NUM_STR_MAX];
+
+  for (int precision = 1; precision <= maxDigits; precision++) {
+    snprintf(buffer, sizeof (buffer), "%.*e", precision - 1, num);
+
+    if (strtod(buffer, NULL) == num) {
+      break;
+    }
+  }
+
+  uint32_t length = 0;
+  const char *c = buffer;
+
+  for (; *c != 'e'; c++) {
+    if (*c != '.') {
+      digits[length++] = *c;
+    }
+  }
+
+  *k = atoi(c + 1) - (int)(length - 1);
+
+  return length;
+}
+
+static uint32_t shortestDigits(double num, char *digits, int *k) {
+  uint32_t length;
+
+  if (grisu3(num, digits, &length, k)) {
+    return length;
+  }
+
+  return slowDigits(num, digits, k);
+}
+
+static uint32_t layout(
+  char *buffer,
+  const char *digits,
+  uint32_t length,
+  int exp
+) {
+  if (exp < MIN_FIXED_EXP || exp >= MAX_FIXED_EXP) {
+    uint32_t pos = 0;
+
+    buffer[pos++] = digits[0];
+
+    if (length > 1) {
+      buffer[pos++] = '.';
+
+      memcpy(&buffer[pos], &digits[1], length - 1);
+      pos += length - 1;
+    }
+
+    buffer[pos++] = 'e';
+    buffer[pos++] = exp < 0 ? '-' : '+';
+
+    const int absExp = exp < 0 ? -exp : exp;
+
+    if (absExp >= 100) {
+      buffer[pos++] = (char)('0' + absExp / 100);
+    }
+
+    buffer[pos++] = (char)('0' + absExp / 10 % 10);
+    buffer[pos++] = (char)('0' + absExp % 10);
+
+    return pos;
+  }
+
+  const int point = exp + 1;
+
+  if (point <= 0) {
+    const uint32_t zeros = (uint32_t)-point;
+
+    buffer[0] = '0';
+    buffer[1] = '.';
+
+    memset(&buffer[2], '0', zeros);
+    memcpy(&buffer[2 + zeros], digits, length);
+
+    return 2 + zeros + length;
+  }
+
+  if ((uint32_t)point >= length) {
+    memcpy(buffer, digits, length);
+    memset(&buffer[length], '0', (uint32_t)point - length);
+
+    return (uint32_t)point;
+  }
+
+  memcpy(buffer, digits, (uint32_t)point);
+  buffer[point] = '.';
+  memcpy(&buffer[point + 1], &digits[point], length - (uint32_t)point);
+
+  return length + 1;
+}
+
+// integers below 10^MAX_FIXED_EXP are written out digit by digit, which 
+// is the same thing the digits and layout would come to, only quicker.
+static bool isSmallInt(double num) {
+  return num < 1e14 && num == (double)(uint64_t)num;
+}
+
+static uint32_t intLength(uint64_t n) {
+  uint32_t length = 1;
+
+  while (n >= 10) {
+    n /= 10;
+    length++;
+  }
+
+  return length;
+}
+
+static uint32_t intAsStr(char *buffer, uint64_t n) {
+  const uint32_t length = intLength(n);
+
+  for (uint32_t i = length; i > 0; i--) {
+    buffer[i - 1] = (char)('0' + n % 10);
+    n /= 10;
+  }
+
+  return length;
+}
+
+// NOLINTEND
+
+// what printf would write for zeros, infinities and NaNs, minus the sign.
+static const char *specialStr(double num) {
+  if (isnan(num)) {
+    return "nan";
+  }
+
+  if (isinf(num)) {
+    return "inf";
+  }
+
+  return num == 0 ? "0" : NULL;
+}
+
+uint32_t numAsStr(char *buffer, double num) {
+  uint32_t pos = 0;
+
+  if (signbit(num) != 0) {
+    buffer[pos++] = '-';
+  }
+
+  const double absNum = fabs(num);
+
+  const char *special = specialStr(absNum);
+  if (special != NULL) {
+    const uint32_t length = (uint32_t)strlen(special);
+    memcpy(&buffer[pos], special, length);
+
+    return pos + length;
+  }
+
+  if (isSmallInt(absNum)) {
+    return pos + intAsStr(&buffer[pos], (uint64_t)absNum);
+  }
+
+  char digits[NUM_STR_MAX];
+  int k;
+
+  const uint32_t length = shortestDigits(absNum, digits, &k);
+
+  return pos + layout(&buffer[pos], digits, length, (int)length + k - 1);
+}
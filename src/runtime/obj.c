@@ -1,20 +1,38 @@
-#include <stdio.h>
 #include <string.h>
 
+#include "hash.h"
+#include "intern.h"
 #include "mem.h"
 #include "obj.h"
 #include "str.h"
+#include "strindex.h"
 #include "table.h"
+#include "transcode.h"
+
+// printing transcodes strings that aren’t UTF-8 this many bytes at a time,
+// which keeps the output of each chunk within a Writer’s smallest buffer.
+#define PRINT_CHUNK_SIZE 2048
+
+// a slice stored in a table gets bytes of its own once its parent is more
+// than this many times its size.  see settleStr().
+#define MAX_SLICE_WASTE 8
+
+// strings at least this long get breadcrumbs the first time one of their
+// code points is looked up; shorter ones are just counted.
+#define MIN_INDEXED_STR_SIZE 1024
+
+// how many right children copyStr() keeps track of before it has to
+// allocate.
+#define ROPE_STACK_SIZE 64
 
 #define ALLOC_OBJ(vm, type, objType)                        \
   (type *)allocObj(vm, sizeof (type), objType)
 
-#define INITIAL_STR_HASH_VAL 2166136261U
-#define HASH_FACTOR 16777619
-
 static Obj *allocObj(NeveVM *vm, size_t size, ObjType type) {
   Obj *obj = (Obj *)reallocate(NULL, 0, size);
-  obj->type = type;
+  obj->type = (uint8_t)type;
+  obj->flags = 0;
+  obj->hash = 0;
 
   obj->next = vm->objs;
   vm->objs = obj;
@@ -26,92 +44,421 @@ ObjStr *allocStr(
   NeveVM *vm,
   bool ownsStr,
   bool isInterned,
+  Encoding encoding,
   const char *chars,
   uint32_t length,
+  uint32_t byteLength,
   uint32_t hash
 ) {
-  ObjStr *interned = tableFindStr(&vm->strs, chars, length, hash);
+  // strings that won’t be interned don’t go looking for an interned copy
+  // either; that way they don’t need a hash until they’re used as a key.
+  ObjStr *interned = !isInterned ? NULL : internSetFind(
+    &vm->strs,
+    chars,
+    encoding,
+    byteLength,
+    hash
+  );
+
   if (interned != NULL) {
     if (ownsStr) {
-      FREE_ARR(char, (char *)chars, length);
+      FREE_VAR_ARR((char *)chars, byteLength + 1);
     }
 
     return interned;
   }
 
   ObjStr *str = ALLOC_OBJ(vm, ObjStr, OBJ_STR);
-  str->ownsStr = ownsStr;
+  str->obj.flags = (uint8_t)(
+    ((uint8_t)encoding & STR_ENCODING_MASK) |
+    (ownsStr ? STR_OWNS_CHARS : 0) |
+    (isInterned ? STR_INTERNED : 0)
+  );
+
+  str->obj.hash = hash;
   str->length = length;
+  str->byteLength = byteLength;
   str->chars = chars;
-  str->hash = hash;
+  str->crumbs = NULL;
 
   if (isInterned) {
-    tableSet(&vm->strs, OBJ_VAL(str), NIL_VAL);
+    internSetAdd(&vm->strs, str);
   }
 
   return str;
 }
 
-ObjUStr *allocUStr(
-  NeveVM *vm,
-  bool ownsStr,
-  bool isInterned,
-  Encoding encoding,
-  const void *chars,
-  uint32_t length,
-  uint32_t byteLength,
-  uint32_t hash
-) {
-  ObjUStr *interned = tableFindUStr(
-    &vm->strs,
-    chars,
-    encoding,
-    length, 
-    byteLength,
-    hash
-  );
+ObjStr *allocRope(NeveVM *vm, ObjStr *left, ObjStr *right) {
+  ObjRope *rope = ALLOC_OBJ(vm, ObjRope, OBJ_STR);
 
-  if (interned != NULL) {
-    if (ownsStr) {
-      FREE_VAR_ARR((void *)chars, byteLength);
+  rope->str.obj.flags = (uint8_t)((uint8_t)STR_ENCODING(left) | STR_ROPE);
+
+  rope->str.length = left->length + right->length;
+  rope->str.byteLength = left->byteLength + right->byteLength;
+  rope->str.chars = NULL;
+  rope->str.crumbs = NULL;
+
+  rope->left = left;
+  rope->right = right;
+
+  return &rope->str;
+}
+
+// a rope’s sides still waiting to be copied, and where their bytes go.
+typedef struct {
+  ObjStr *str;
+  char *dest;
+} RopeSide;
+
+// repeated appends build ropes that lean left and repeated prepends build
+// ropes that lean right, either of which can be as deep as the number of
+// appends.  so the left spine is walked in place and right children wait
+// on an explicit stack, which only moves to the heap for ropes with more
+// than ROPE_STACK_SIZE of them pending at once.
+static void copyStr(ObjStr *str, char *dest) {
+  RopeSide local[ROPE_STACK_SIZE];
+  RopeSide *stack = local;
+
+  uint32_t cap = ROPE_STACK_SIZE;
+  uint32_t count = 0;
+
+  ObjStr *curr = str;
+
+  while (true) {
+    while (!IS_STR_FLAT(curr)) {
+      ObjRope *rope = (ObjRope *)curr;
+
+      if (count == cap) {
+        const uint32_t grownCap = GROW_CAP(cap);
+
+        if (stack == local) {
+          stack = ALLOC(RopeSide, grownCap);
+          memcpy(stack, local, sizeof (local));
+        } else {
+          stack = GROW_ARR(RopeSide, stack, cap, grownCap);
+        }
+
+        cap = grownCap;
+      }
+
+      stack[count++] = (RopeSide){
+        rope->right,
+        dest + rope->left->byteLength
+      };
+
+      curr = rope->left;
     }
 
-    return interned;
+    memcpy(dest, curr->chars, curr->byteLength);
+
+    if (count == 0) {
+      break;
+    }
+
+    count--;
+    curr = stack[count].str;
+    dest = stack[count].dest;
   }
 
-  ObjUStr *str = ALLOC_OBJ(vm, ObjUStr, OBJ_USTR);
-  str->ownsStr = ownsStr;
-  str->length = length;
-  str->byteLength = byteLength;
-  str->encoding = encoding;
+  if (stack != local) {
+    FREE_ARR(RopeSide, stack, cap);
+  }
+}
+
+uint32_t strOffset(ObjStr *str, uint32_t index) {
+  const Encoding encoding = STR_ENCODING(str);
+  const uint32_t unitSize = (
+    encoding == STR_UTF8 ? 1 : (encoding == STR_UTF16 ? 2 : 4)
+  );
+
+  if ((uint64_t)str->length * unitSize == str->byteLength) {
+    return index * unitSize;
+  }
+
+  if (index >= str->length) {
+    return str->byteLength;
+  }
+
+  flattenStr(str);
+
+  if (str->byteLength >= MIN_INDEXED_STR_SIZE) {
+    return strIndexOffset(str, index);
+  }
+
+  return codePointOffset(encoding, str->chars, str->byteLength, index);
+}
+
+ObjStr *sliceStr(NeveVM *vm, ObjStr *str, uint32_t start, uint32_t end) {
+  if (start == 0 && end == str->length) {
+    return str;
+  }
+
+  flattenStr(str);
+
+  const uint32_t from = strOffset(str, start);
+  const uint32_t to = strOffset(str, end);
+
+  // slicing a slice that still borrows borrows from the same parent, so
+  // that slices never chain.  one that owns its bytes is a parent like any
+  // other string.
+  ObjStr *parent = str;
+
+  if (IS_STR_SLICE(str) && !IS_STR_OWNING(str)) {
+    parent = ((ObjSlice *)str)->parent;
+  }
+
+  ObjSlice *slice = ALLOC_OBJ(vm, ObjSlice, OBJ_STR);
+
+  slice->str.obj.flags = (uint8_t)((uint8_t)STR_ENCODING(str) | STR_SLICE);
+
+  slice->str.length = end - start;
+  slice->str.byteLength = to - from;
+  slice->str.chars = str->chars + from;
+  slice->str.crumbs = NULL;
+
+  slice->parent = parent;
+
+  return &slice->str;
+}
+
+static void ownSliceChars(ObjSlice *slice) {
+  ObjStr *str = &slice->str;
+  char *chars = ALLOC(char, str->byteLength + 1);
+
+  memcpy(chars, str->chars, str->byteLength);
+  chars[str->byteLength] = '\0';
+
   str->chars = chars;
-  str->hash = hash;
+  str->obj.flags |= STR_OWNS_CHARS;
 
-  if (isInterned) {
-    tableSet(&vm->strs, OBJ_VAL(str), NIL_VAL);
+  slice->parent = NULL;
+}
+
+// slices are cheap to make because they leave their bytes where they are,
+// but one that’s stored in a table may outlive everything else that points
+// at its parent, and keep all of it around for the sake of a few bytes.
+// keys short enough to be interned are interned here, since that’s when
+// they start being compared, and their bytes are copied out on the way.
+// anything else only gets bytes of its own if it’s a small enough part of
+// its parent.
+ObjStr *settleStr(NeveVM *vm, ObjStr *str, bool isKey) {
+  if (!IS_STR_SLICE(str) || IS_STR_OWNING(str)) {
+    return str;
+  }
+
+  ObjSlice *slice = (ObjSlice *)str;
+
+  if (isKey && str->byteLength <= MAX_INTERNED_STR_SIZE) {
+    const uint32_t hash = hashObj(&str->obj);
+
+    ObjStr *interned = internSetFind(
+      &vm->strs,
+      str->chars,
+      STR_ENCODING(str),
+      str->byteLength,
+      hash
+    );
+
+    if (interned != NULL) {
+      return interned;
+    }
+
+    ownSliceChars(slice);
+
+    str->obj.flags |= STR_INTERNED;
+    internSetAdd(&vm->strs, str);
+
+    return str;
+  }
+
+  const uint64_t parentLength = slice->parent->byteLength;
+
+  if ((uint64_t)str->byteLength * MAX_SLICE_WASTE < parentLength) {
+    ownSliceChars(slice);
   }
 
   return str;
 }
 
-ObjTable *newTable(NeveVM *vm, uint32_t cap) {
+ObjStr *reencodeStr(NeveVM *vm, ObjStr *str, Encoding encoding) {
+  const Encoding from = STR_ENCODING(str);
+  if (from == encoding) {
+    return str;
+  }
+
+  flattenStr(str);
+
+  const size_t cap = transcodedCap(from, encoding, str->byteLength);
+  char *chars = ALLOC(char, cap + 1);
+
+  const uint32_t byteLength = transcode(
+    from,
+    encoding,
+    str->chars,
+    str->byteLength,
+    chars
+  );
+
+  chars = GROW_ARR(char, chars, cap + 1, byteLength + 1);
+  chars[byteLength] = '\0';
+
+  return allocStr(
+    vm,
+    true,
+    false,
+    encoding,
+    chars,
+    str->length,
+    byteLength,
+    STR_UNHASHED
+  );
+}
+
+void strAsUtf8(StrBuf *buf, ObjStr *str) {
+  flattenStr(str);
+
+  const Encoding encoding = STR_ENCODING(str);
+  const size_t cap = transcodedCap(encoding, STR_UTF8, str->byteLength);
+
+  buf->length += transcode(
+    encoding,
+    STR_UTF8,
+    str->chars,
+    str->byteLength,
+    strBufReserve(buf, (uint32_t)cap)
+  );
+}
+
+void flattenStr(ObjStr *str) {
+  if (IS_STR_FLAT(str)) {
+    return;
+  }
+
+  char *chars = ALLOC(char, str->byteLength + 1);
+
+  copyStr(str, chars);
+  chars[str->byteLength] = '\0';
+
+  str->chars = chars;
+  str->obj.flags |= STR_OWNS_CHARS;
+
+  ObjRope *rope = (ObjRope *)str;
+  rope->left = NULL;
+  rope->right = NULL;
+}
+
+static ObjTable *allocTable(NeveVM *vm, Table *table) {
   ObjTable *obj = ALLOC_OBJ(vm, ObjTable, OBJ_TABLE);  
 
-  obj->table = ALLOC(Table, 1);
-  initTable(obj->table, cap);
+  // tables compare by identity, so their address is as good a hash as any.
+  // a zero hash would read as an unhashed string in hashObj().
+  const uint32_t hash = hashBits((uint64_t)(uintptr_t)obj);
+  obj->obj.hash = hash == 0 ? 1 : hash;
+
+  obj->table = table;
+  obj->share = NULL;
+
+  return obj;
+}
+
+ObjTable *newTable(NeveVM *vm, uint32_t cap) {
+  Table *table = ALLOC(Table, 1);
+  initTable(table, cap);
+
+  return allocTable(vm, table);
+}
+
+// a new table with the same contents as `table`, which must be a constant.
+// it only gets storage of its own once it’s written to.  `parent` is the
+// shared table it was read out of, if any.
+ObjTable *shareTable(NeveVM *vm, ObjTable *table, ObjTable *parent) {
+  ObjTable *obj = allocTable(vm, table->table);
+  obj->obj.flags = TABLE_SHARED;
+
+  obj->share = ALLOC(TableShare, 1);
+  initTable(&obj->share->children, 0);
+
+  obj->share->parent = parent;
 
   return obj;
 }
 
+// a table with storage of its own can keep the shared table in place of 
+// the constant right away.
+Val shareField(NeveVM *vm, ObjTable *table, Val key, ObjTable *field) {
+  if (!IS_TABLE_SHARED(table)) {
+    const Val shared = OBJ_VAL(shareTable(vm, field, NULL));
+    tableSet(table->table, key, shared);
+
+    return shared;
+  }
+
+  Table *children = &table->share->children;
+  const Val child = tableGet(children, key);
+
+  if (!IS_VAL_NIL(child)) {
+    return child;
+  }
+
+  const Val shared = OBJ_VAL(shareTable(vm, field, table));
+  tableSet(children, key, shared);
+
+  return shared;
+}
+
+static void freeShare(TableShare *share) {
+  freeTable(&share->children);
+  FREE(TableShare, share);
+}
+
+void unshareTable(ObjTable *table) {
+  TableShare *share = table->share;
+
+  Table *copy = ALLOC(Table, 1);
+  copyTable(copy, table->table);
+
+  // the tables handed out for nested constants take their place.
+  uint32_t i = 0;
+  Val key;
+  Val val;
+
+  while (tableNext(&share->children, &i, &key, &val)) {
+    tableSet(copy, key, val);
+  }
+
+  table->table = copy;
+  table->share = NULL;
+  table->obj.flags &= (uint8_t)~TABLE_SHARED;
+
+  // `parent` has this table among its children, so giving it a copy of 
+  // its own stores this one in it.
+  ObjTable *parent = share->parent;
+
+  if (parent != NULL && IS_TABLE_SHARED(parent)) {
+    unshareTable(parent);
+  }
+
+  freeShare(share);
+}
+
 uint32_t hashStr(const char *key, uint32_t length) {
-  uint32_t hash = INITIAL_STR_HASH_VAL; 
+  const uint32_t hash = hashBytes(key, length);
 
-  for (uint32_t i = 0; i < length; i++) {
-    hash ^= (uint8_t)key[i];
-    hash *= HASH_FACTOR;
+  return hash == STR_UNHASHED ? 1 : hash;
+}
+
+uint32_t hashObj(Obj *obj) {
+  if (obj->hash != STR_UNHASHED) {
+    return obj->hash;
   }
 
-  return hash;
+  // only strings are ever left unhashed, tables get theirs in newTable().
+  ObjStr *str = (ObjStr *)obj;
+
+  flattenStr(str);
+  obj->hash = hashStr(str->chars, str->byteLength);
+
+  return obj->hash;
 }
 
 bool objsEq(Obj *a, Obj *b) {
@@ -126,28 +473,76 @@ bool objsEq(Obj *a, Obj *b) {
   ObjStr *aStr = (ObjStr *)a;
   ObjStr *bStr = (ObjStr *)b;
 
-  return (
-    aStr->length == bStr->length &&
-    memcmp(aStr->chars, bStr->chars, aStr->length) == 0
-  );
+  // there’s only ever one interned copy of any given string, so two
+  // different interned strings can’t be equal.
+  if (IS_STR_INTERNED(aStr) && IS_STR_INTERNED(bStr)) {
+    return false;
+  }
+
+  if (
+    aStr->byteLength != bStr->byteLength ||
+    STR_ENCODING(aStr) != STR_ENCODING(bStr)
+  ) {
+    return false;
+  }
+
+  // it isn’t worth hashing just to compare, but a known mismatch is enough.
+  const bool areHashed = a->hash != STR_UNHASHED && b->hash != STR_UNHASHED;
+
+  if (areHashed && a->hash != b->hash) {
+    return false;
+  }
+
+  flattenStr(aStr);
+  flattenStr(bStr);
+
+  return memcmp(aStr->chars, bStr->chars, aStr->byteLength) == 0;
 }
 
-void printObj(Val val) {
+// output is always UTF-8, so other encodings are transcoded on their way
+// into `out`, a chunk at a time.
+static void printTranscoded(Writer *out, ObjStr *str) {
+  const Encoding encoding = STR_ENCODING(str);
+
+  for (uint32_t i = 0; i < str->byteLength; ) {
+    const uint32_t chunk = wholeCodePoints(
+      encoding,
+      &str->chars[i],
+      str->byteLength - i,
+      PRINT_CHUNK_SIZE
+    );
+
+    const size_t cap = transcodedCap(encoding, STR_UTF8, chunk);
+
+    out->length += transcode(
+      encoding,
+      STR_UTF8,
+      &str->chars[i],
+      chunk,
+      writerReserve(out, (uint32_t)cap)
+    );
+
+    i += chunk;
+  }
+}
+
+void printObj(Writer *out, Val val) {
   switch (OBJ_TYPE(val)) {
-    case OBJ_STR:
-      printf("%.*s", (int)(VAL_AS_STR(val)->length), VAL_AS_CSTR(val));
-      break;
+    case OBJ_STR: {
+      ObjStr *str = VAL_AS_STR(val);
+      flattenStr(str);
+
+      if (STR_ENCODING(str) == STR_UTF8) {
+        writerAppend(out, str->chars, str->byteLength);
+      } else {
+        printTranscoded(out, str);
+      }
 
-    case OBJ_USTR:
-      printf(
-        "%.*s", 
-        (int)(VAL_AS_USTR(val)->byteLength), 
-        (char *)VAL_AS_CSTR(val)
-      );
       break;
+    }
 
     case OBJ_TABLE:
-      printTable(VAL_AS_TABLE(val)->table); 
+      printTable(out, VAL_AS_TABLE(val)->table); 
   }
 }
 
@@ -156,30 +551,35 @@ void freeObj(Obj *obj) {
     case OBJ_STR: {
       ObjStr *str = (ObjStr *)obj;
 
-      if (str->ownsStr) {
-        FREE_ARR(char, (char *)str->chars, str->length);
+      if (IS_STR_OWNING(str)) {
+        FREE_VAR_ARR((char *)str->chars, str->byteLength + 1);
       }
 
-      FREE(ObjStr, obj);
-      break;
-    }
-
-    case OBJ_USTR: {
-      ObjUStr *str = (ObjUStr *)obj;
+      if (str->crumbs != NULL) {
+        freeStrIndex(str);
+      }
 
-      if (str->ownsStr) {
-        FREE_VAR_ARR((void *)str->chars, str->byteLength);
+      if (IS_STR_ROPE(str)) {
+        FREE(ObjRope, obj);
+      } else if (IS_STR_SLICE(str)) {
+        FREE(ObjSlice, obj);
+      } else {
+        FREE(ObjStr, obj);
       }
 
-      FREE(ObjUStr, obj);
       break;
     }
 
     case OBJ_TABLE: {
       ObjTable *table = (ObjTable *)obj;
 
-      freeTable(table->table);
-      FREE(Table, table->table);
+      // the constant it’s shared with owns the storage.
+      if (IS_TABLE_SHARED(table)) {
+        freeShare(table->share);
+      } else {
+        freeTable(table->table);
+        FREE(Table, table->table);
+      }
       
       FREE(ObjTable, table);
       break;
@@ -187,44 +587,16 @@ void freeObj(Obj *obj) {
   }
 }
 
-uint32_t objStrLength(Obj *obj) {
+void objAsStr(StrBuf *buf, Obj *obj) {
   switch (obj->type) {
-    case OBJ_STR:
-      // +2: accommodate for the quotes around it
-      return ((ObjStr *)obj)->length + 2;
-
-    case OBJ_USTR:
-      // +2: same as above
-      return ((ObjUStr *)obj)->byteLength + 2;
-
     case OBJ_TABLE:
-      return tableStrLength(((ObjTable *)obj)->table);
-  }
-
-  return 0;
-}
-
-uint32_t objAsStr(const char *buffer, const uint32_t size, Obj *obj) {
-  switch (obj->type) {
-    case OBJ_TABLE:
-      return tableAsStr(buffer, size, ((ObjTable *)obj)->table); 
+      tableAsStr(buf, ((ObjTable *)obj)->table); 
+      break;
     
-    case OBJ_STR: {
-      ObjStr *str = (ObjStr *)obj;
-
-      sprintf((char *)buffer, "\"%.*s\"", str->length, str->chars);
-
-      return size;
-    }
-
-    case OBJ_USTR: {
-      ObjUStr *str = (ObjUStr *)obj;
-
-      sprintf((char *)buffer, "\"%.*s\"", str->byteLength, (char *)str->chars);
-
-      return size;
-    }
+    case OBJ_STR:
+      STR_BUF_APPEND_LIT(buf, "\"");
+      strAsUtf8(buf, (ObjStr *)obj);
+      STR_BUF_APPEND_LIT(buf, "\"");
+      break;
   }
-
-  return 0;
 }
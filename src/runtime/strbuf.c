@@ -0,0 +1,32 @@
+#include "mem.h"
+#include "strbuf.h"
+
+void initStrBuf(StrBuf *buf, uint32_t cap) {
+  buf->length = 0;
+  buf->cap = cap;
+  buf->chars = cap == 0 ? NULL : ALLOC(char, cap);
+}
+
+void strBufGrow(StrBuf *buf, uint32_t minCap) {
+  uint32_t cap = GROW_CAP(buf->cap);
+  if (cap < minCap) {
+    cap = minCap;
+  }
+
+  buf->chars = GROW_ARR(char, buf->chars, buf->cap, cap);
+  buf->cap = cap;
+}
+
+char *strBufTake(StrBuf *buf) {
+  char *chars = GROW_ARR(char, buf->chars, buf->cap, buf->length + 1);
+  chars[buf->length] = '\0';
+
+  initStrBuf(buf, 0);
+
+  return chars;
+}
+
+void freeStrBuf(StrBuf *buf) {
+  FREE_ARR(char, buf->chars, buf->cap);
+  initStrBuf(buf, 0);
+}
@@ -0,0 +1,46 @@
+#include "mem.h"
+#include "obj.h"
+#include "strindex.h"
+#include "transcode.h"
+
+// a single pass over the string, each breadcrumb counted on from the last.
+static void buildIndex(ObjStr *str) {
+  const Encoding encoding = STR_ENCODING(str);
+  const uint32_t count = STR_CRUMB_COUNT(str->length);
+
+  uint32_t *crumbs = ALLOC(uint32_t, count);
+  uint32_t offset = 0;
+
+  for (uint32_t k = 0; k < count; k++) {
+    crumbs[k] = offset;
+
+    offset += codePointOffset(
+      encoding,
+      str->chars + offset,
+      str->byteLength - offset,
+      STR_INDEX_STEP
+    );
+  }
+
+  str->crumbs = crumbs;
+}
+
+uint32_t strIndexOffset(ObjStr *str, uint32_t codePoint) {
+  if (str->crumbs == NULL) {
+    buildIndex(str);
+  }
+
+  const uint32_t offset = str->crumbs[codePoint / STR_INDEX_STEP];
+
+  return offset + codePointOffset(
+    STR_ENCODING(str),
+    str->chars + offset,
+    str->byteLength - offset,
+    codePoint % STR_INDEX_STEP
+  );
+}
+
+void freeStrIndex(ObjStr *str) {
+  FREE_ARR(uint32_t, str->crumbs, STR_CRUMB_COUNT(str->length));
+  str->crumbs = NULL;
+}
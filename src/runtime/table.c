@@ -1,4 +1,3 @@
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -7,342 +6,804 @@
 #include "table.h"
 #include "val.h"
 
-#define TABLE_MAX_LOAD 0.75
+#if defined(__SSE2__) && defined(TABLE_SWISS)
+#include <emmintrin.h>
+#endif
 
-static Entry *findEntry(Entry *entries, uint32_t cap, Val key) {
-  uint32_t index = hashVal(key) & (cap - 1);
-  Entry *tombstone = NULL;
+#define NO_SLOT UINT32_MAX
 
-  while (true) {
-    Entry *entry = &entries[index];
+// the Swiss table’s groups need at least this many slots.
+#define MIN_CAP 16
 
-    if (IS_VAL_EMPTY(entry->key)) {
-      if (IS_VAL_NIL(entry->val)) {
-        return tombstone != NULL ? tombstone : entry;
-      } 
+#define MAX_LOAD(cap) ((cap) - (cap) / 8)
 
-      if (tombstone == NULL) {
-        tombstone = entry;
-      }
-    } else if (valsEq(entry->key, key)) {
-      return entry;
-    }
+// the largest power of two a capacity can hold.
+#define MAX_CAP (1U << 31)
 
-    index = (index + 1) & (cap - 1);
+// the smallest capacity that fits `count` entries without going over the
+// maximum load of 7/8.  `count` is wide enough for the doubled counts
+// resize() asks for; anything that wouldn’t fit in MAX_CAP slots couldn’t
+// be allocated either, so it fails the same way reallocate() does.
+static uint32_t capFor(uint64_t count) {
+  if (count > MAX_LOAD(MAX_CAP)) {
+    exit(1);
   }
-}
 
-static Entry *allocEntries(uint32_t cap) {
-  Entry *entries = ALLOC(Entry, cap);
+  uint32_t cap = MIN_CAP;
 
-  for (uint32_t i = 0; i < cap; i++) {
-    entries[i].key = EMPTY_VAL;
-    entries[i].val = NIL_VAL;
+  while (count > MAX_LOAD(cap)) {
+    cap *= 2;
   }
 
-  return entries;
+  return cap;
 }
 
-static void adjustCap(Table *table, uint32_t cap) {
-  Entry *entries = allocEntries(cap);
+#if defined(TABLE_LINEAR_PROBE)
 
-  table->next = 0;
-  for (uint32_t i = 0; i < table->cap; i++) {
-    Entry *entry = &table->entries[i];
+// each slot holds an index into `entries`.  probing goes one slot at a 
+// time from the key’s home slot, and has to check every entry it passes.
+// deleted slots stay behind as tombstones until the next resize; they 
+// correspond one-to-one with holes in `entries`, so `next` counts them 
+// towards the load too.
+#define EMPTY_INDEX   UINT32_MAX
+#define DELETED_INDEX (UINT32_MAX - 1)
+
+static uint32_t findSlot(Table *table, Val key, uint32_t hash) {
+  const uint32_t mask = table->cap - 1;
+
+  for (uint32_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+    const uint32_t index = table->indices[slot];
 
-    if (IS_VAL_EMPTY(entry->key)) {
+    if (index == EMPTY_INDEX) {
+      return NO_SLOT;
+    }
+
+    if (index == DELETED_INDEX) {
       continue;
     }
 
-    Entry *dest = findEntry(entries, cap, entry->key);
-    dest->key = entry->key;
-    dest->val = entry->val;
+    const Entry *entry = &table->entries[index];
 
-    table->next++;
+    if (entry->hash == hash && valsEq(entry->key, key)) {
+      return slot;
+    }
   }
+}
 
-  FREE_ARR(Entry, table->entries, table->cap);
-
-  table->entries = entries;
+static void allocSlots(Table *table, uint32_t cap) {
   table->cap = cap;
-}
+  table->indices = ALLOC(uint32_t, cap);
 
-static void printEntryVal(Val val) {
-  const bool isStr = (
-    IS_VAL_OBJ(val) && 
-    VAL_AS_OBJ(val)->type == OBJ_STR
-  );
+  // EMPTY_INDEX is all ones.
+  memset(table->indices, 0xFF, sizeof (uint32_t) * cap);
+}
 
-  if (isStr) {
-    putchar('"');
+static void freeSlots(Table *table) {
+  if (table->cap == 0) {
+    return;
   }
 
-  printVal(val);
+  FREE_ARR(uint32_t, table->indices, table->cap);
+}
 
-  if (isStr) {
-    putchar('"');
+static void clearSlots(Table *table) {
+  table->cap = 0;
+  table->indices = NULL;
+}
+
+static void copySlots(Table *into, const Table *from) {
+  into->cap = from->cap;
+  into->indices = ALLOC(uint32_t, from->cap);
+
+  memcpy(into->indices, from->indices, sizeof (uint32_t) * from->cap);
+}
+
+#define SLOT_ENTRY(table, slot) (&(table)->entries[(table)->indices[slot]])
+
+static void insertSlot(Table *table, uint32_t hash, uint32_t index) {
+  const uint32_t mask = table->cap - 1;
+
+  uint32_t slot = hash & mask;
+
+  while (table->indices[slot] < DELETED_INDEX) {
+    slot = (slot + 1) & mask;
   }
+
+  table->indices[slot] = index;
 }
 
-void initTable(Table *table, const uint32_t cap) {
-  if (cap > 0) {
-    const uint32_t newCap = cap < 8 ? 8 : cap;
+static void removeSlot(Table *table, uint32_t slot) {
+  table->indices[slot] = DELETED_INDEX;
+}
 
-    table->cap = newCap;
-    table->next = 0;
-    table->entries = allocEntries(newCap);
+#else
 
-    return;
+// the control bytes: full slots hold the low 7 bits of their key’s hash, 
+// so the high bit alone tells free slots apart from full ones.
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xFE
+
+#define GROUP_SIZE 16
+
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((uint8_t)((hash) & 0x7F))
+
+// one bit per slot in a group, lowest bit first.
+typedef uint32_t GroupMask;
+
+#define NEXT_IN_MASK(mask) ((uint32_t)__builtin_ctz(mask))
+
+#ifdef __SSE2__
+
+static GroupMask matchByte(const uint8_t *group, uint8_t byte) {
+  const __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  const __m128i bytes = _mm_set1_epi8((char)byte);
+
+  return (GroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, bytes));
+}
+
+static GroupMask matchFree(const uint8_t *group) {
+  const __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+
+  return (GroupMask)_mm_movemask_epi8(ctrl);
+}
+
+#else
+
+static GroupMask matchByte(const uint8_t *group, uint8_t byte) {
+  GroupMask mask = 0;
+
+  for (uint32_t i = 0; i < GROUP_SIZE; i++) {
+    mask |= (GroupMask)(group[i] == byte) << i;
   }
 
-  table->cap = 0;
-  table->next = 0;
-  table->entries = NULL;
+  return mask;
 }
 
-bool tableSet(Table *table, Val key, Val val) {
-  if ((double)table->next >= (double)table->cap * TABLE_MAX_LOAD) {
-    uint32_t cap = GROW_CAP(table->cap);
-    adjustCap(table, cap);
+static GroupMask matchFree(const uint8_t *group) {
+  GroupMask mask = 0;
+
+  for (uint32_t i = 0; i < GROUP_SIZE; i++) {
+    mask |= (GroupMask)(group[i] >> 7) << i;
   }
 
-  Entry *entry = findEntry(table->entries, table->cap, key);
+  return mask;
+}
 
-  bool isNewKey = IS_VAL_EMPTY(entry->key);
+#endif
 
-  table->next += isNewKey && IS_VAL_NIL(entry->val);
+static GroupMask matchEmpty(const uint8_t *group) {
+  return matchByte(group, CTRL_EMPTY);
+}
 
-  entry->key = key;
-  entry->val = val;
-  
-  return isNewKey;
+static void setCtrl(uint8_t *ctrl, uint32_t cap, uint32_t index, uint8_t byte) {
+  ctrl[index] = byte;
+
+  // the first GROUP_SIZE - 1 bytes are mirrored past the end, so a group 
+  // that starts near the end can still be loaded in one go.
+  if (index < GROUP_SIZE - 1) {
+    ctrl[cap + index] = byte;
+  }
 }
 
-Val tableGet(Table *table, Val key) {
-  if (table->next == 0) {
-    return NIL_VAL;
+static uint32_t findSlot(Table *table, Val key, uint32_t hash) {
+  const uint32_t mask = table->cap - 1;
+  const uint8_t h2 = H2(hash);
+
+  uint32_t pos = H1(hash) & mask;
+
+  while (true) {
+    const uint8_t *group = &table->ctrl[pos];
+
+    for (GroupMask m = matchByte(group, h2); m != 0; m &= m - 1) {
+      const uint32_t slot = (pos + NEXT_IN_MASK(m)) & mask;
+      const Entry *entry = &table->entries[table->indices[slot]];
+
+      if (entry->hash == hash && valsEq(entry->key, key)) {
+        return slot;
+      }
+    }
+
+    if (matchEmpty(group) != 0) {
+      return NO_SLOT;
+    }
+
+    pos = (pos + GROUP_SIZE) & mask;
   }
+}
 
-  Entry *entry = findEntry(table->entries, table->cap, key);
-  if (IS_VAL_EMPTY(entry->key)) {
-    return NIL_VAL;
+static uint32_t findFree(const uint8_t *ctrl, uint32_t cap, uint32_t hash) {
+  const uint32_t mask = cap - 1;
+
+  uint32_t pos = H1(hash) & mask;
+
+  while (true) {
+    const GroupMask m = matchFree(&ctrl[pos]);
+
+    if (m != 0) {
+      return (pos + NEXT_IN_MASK(m)) & mask;
+    }
+
+    pos = (pos + GROUP_SIZE) & mask;
   }
+}
+
+static void allocSlots(Table *table, uint32_t cap) {
+  table->cap = cap;
 
-  return entry->val;
+  table->ctrl = ALLOC(uint8_t, cap + GROUP_SIZE - 1);
+  memset(table->ctrl, CTRL_EMPTY, cap + GROUP_SIZE - 1);
+
+  table->indices = ALLOC(uint32_t, cap);
 }
 
-bool tableDel(Table *table, Val key) {
-  if (table->next == 0) {
-    return false;
+static void freeSlots(Table *table) {
+  if (table->cap == 0) {
+    return;
   }
 
-  Entry *entry = findEntry(table->entries, table->cap, key);
-  if (IS_VAL_EMPTY(entry->key)) {
+  FREE_ARR(uint8_t, table->ctrl, table->cap + GROUP_SIZE - 1);
+  FREE_ARR(uint32_t, table->indices, table->cap);
+}
+
+static void clearSlots(Table *table) {
+  table->cap = 0;
+  table->ctrl = NULL;
+  table->indices = NULL;
+}
+
+static void copySlots(Table *into, const Table *from) {
+  into->cap = from->cap;
+
+  into->ctrl = ALLOC(uint8_t, from->cap + GROUP_SIZE - 1);
+  memcpy(into->ctrl, from->ctrl, from->cap + GROUP_SIZE - 1);
+
+  into->indices = ALLOC(uint32_t, from->cap);
+  memcpy(into->indices, from->indices, sizeof (uint32_t) * from->cap);
+}
+
+#define SLOT_ENTRY(table, slot) (&(table)->entries[(table)->indices[slot]])
+
+static void insertSlot(Table *table, uint32_t hash, uint32_t index) {
+  const uint32_t slot = findFree(table->ctrl, table->cap, hash);
+
+  setCtrl(table->ctrl, table->cap, slot, H2(hash));
+  table->indices[slot] = index;
+}
+
+// a deleted slot can go back to being empty if no group-sized window 
+// around it is completely full, since then no probe could have gone past
+// it.
+static bool wasNeverFull(Table *table, uint32_t index) {
+  const uint32_t mask = table->cap - 1;
+
+  const GroupMask emptyAfter = matchEmpty(&table->ctrl[index]);
+  const GroupMask emptyBefore = matchEmpty(
+    &table->ctrl[(index - GROUP_SIZE) & mask]
+  );
+
+  if (emptyAfter == 0 || emptyBefore == 0) {
     return false;
   }
 
-  entry->key = EMPTY_VAL;
-  entry->val = BOOL_VAL(true);
+  const uint32_t fullAfter = NEXT_IN_MASK(emptyAfter);
 
-  return true;
+  // the number of full slots right before `index`, i.e. the leading 
+  // zeros of the 16-bit mask.
+  const uint32_t fullBefore = (uint32_t)__builtin_clz(emptyBefore) - 16;
+
+  return fullAfter + fullBefore < GROUP_SIZE;
 }
 
-ObjStr *tableFindStr(
-  Table *table,
-  const char *chars,
-  uint32_t length,
-  uint32_t hash
-) {
-  if (table->next == 0) {
-    return NULL;
+static void removeSlot(Table *table, uint32_t slot) {
+  setCtrl(
+    table->ctrl,
+    table->cap,
+    slot,
+    wasNeverFull(table, slot) ? CTRL_EMPTY : CTRL_DELETED
+  );
+}
+
+#endif
+
+static void growEntries(Table *table, uint32_t minCap) {
+  const uint32_t grownCap = GROW_CAP(table->entryCap);
+  const uint32_t maxCap = MAX_LOAD(table->cap);
+
+  uint32_t entryCap = grownCap > maxCap ? maxCap : grownCap;
+  if (entryCap < minCap) {
+    entryCap = minCap;
   }
 
-  uint32_t index = hash & (table->cap - 1);
+  table->entries = GROW_ARR(
+    Entry,
+    table->entries,
+    table->entryCap,
+    entryCap
+  );
 
-  while (true) {
-    Entry *entry = &table->entries[index];
+  table->entryCap = entryCap;
+}
 
-    if (IS_VAL_EMPTY(entry->key)) {
-      return NULL;
+// squeezes the holes out of `entries`, keeping the insertion order, and 
+// rebuilds the index with `cap` slots.  the entries never move to a new
+// allocation here; growEntries() takes care of that.
+static void adjustCap(Table *table, uint32_t cap) {
+  uint32_t count = 0;
+
+  for (uint32_t i = 0; i < table->next; i++) {
+    if (!IS_VAL_EMPTY(table->entries[i].key)) {
+      table->entries[count++] = table->entries[i];
     }
+  }
 
-    ObjStr *str = VAL_AS_STR(entry->key);
+  freeSlots(table);
+  allocSlots(table, cap);
 
-    if (str->length == length && memcmp(str->chars, chars, length) == 0) {
-      return str;
-    }
+  for (uint32_t i = 0; i < count; i++) {
+    insertSlot(table, table->entries[i].hash, i);
+  }
 
-    index = (index + 1) & (table->cap - 1);
+  table->next = count;
+
+  // growEntries() never lets `entries` outgrow the maximum load, and a 
+  // shrinking table shouldn’t hold on to more than that either.
+  if (table->entryCap > MAX_LOAD(cap)) {
+    table->entries = GROW_ARR(
+      Entry,
+      table->entries,
+      table->entryCap,
+      MAX_LOAD(cap)
+    );
+
+    table->entryCap = MAX_LOAD(cap);
   }
 }
 
-ObjUStr *tableFindUStr(
-  Table *table,
-  const void *chars,
-  Encoding encoding,
-  uint32_t length,
-  uint32_t byteLength,
-  uint32_t hash
-) {
-  if (table->next == 0) {
-    return NULL;
+// the array part never grows past 2^MAX_ARR_BITS slots.
+#define MAX_ARR_BITS 26
+
+// the number of bits needed for `key` if it could go in an array part, 
+// or -1 if it couldn’t.
+static int arrKeyBits(Val key) {
+  if (!IS_VAL_NUM(key)) {
+    return -1;
   }
 
-  uint32_t index = hash & (table->cap - 1);
+  const double num = VAL_AS_NUM(key);
 
-  while (true) {
-    Entry *entry = &table->entries[index];
+  if (!(num >= 0 && num < (double)(1U << MAX_ARR_BITS))) {
+    return -1;
+  }
 
-    if (IS_VAL_EMPTY(entry->key)) {
-      return NULL;
-    }
+  const uint32_t index = (uint32_t)num;
 
-    ObjUStr *str = VAL_AS_USTR(entry->key);
+  if ((double)index != num) {
+    return -1;
+  }
+
+  return index == 0 ? 0 : 32 - __builtin_clz(index);
+}
 
-    if (
-      str->length == length && 
-      str->encoding == encoding &&
-      str->byteLength == byteLength &&
-      memcmp(str->chars, chars, byteLength) == 0
-    ) {
-      return str;
+// like Lua, the array part is the largest power of two that would be more 
+// than half full.  `nums[b]` counts the keys that need exactly `b` bits.
+static uint32_t optimalArrCap(const uint32_t *nums) {
+  uint32_t total = 0;
+  uint32_t cap = 0;
+
+  for (uint32_t bits = 0; bits <= MAX_ARR_BITS; bits++) {
+    total += nums[bits];
+
+    if (total > (1U << bits) / 2) {
+      cap = 1U << bits;
     }
+  }
+
+  return cap;
+}
 
-    index = (index + 1) & (table->cap - 1);
+static void appendEntry(Table *table, Val key, Val val, uint32_t hash) {
+  if (table->next == table->entryCap) {
+    growEntries(table, table->next + 1);
   }
+
+  Entry *entry = &table->entries[table->next++];
+  entry->key = key;
+  entry->val = val;
+  entry->hash = hash;
 }
 
-void printTable(Table *table) {
-  if (table->next == 0) {
-    printf("[:]");
-    return;
+// moves keys between the two parts so that the array part has `arrCap` 
+// slots.  this leaves the index stale; adjustCap() has to run right after.
+static void resizeArr(Table *table, uint32_t arrCap) {
+  for (uint32_t i = arrCap; i < table->arrCap; i++) {
+    if (IS_VAL_EMPTY(table->arr[i])) {
+      continue;
+    }
+
+    const Val key = NUM_VAL((double)i);
+
+    appendEntry(table, key, table->arr[i], hashVal(key));
+    table->arrCount--;
   }
 
-  printf("[");
+  table->arr = GROW_ARR(Val, table->arr, table->arrCap, arrCap);
 
-  bool isFirst = true;
+  for (uint32_t i = table->arrCap; i < arrCap; i++) {
+    table->arr[i] = EMPTY_VAL;
+  }
 
-  for (uint32_t i = 0; i < table->cap; i++) {
-    Entry *entry = &table->entries[i];
+  const uint32_t oldCap = table->arrCap;
+  table->arrCap = arrCap;
 
-    const bool isAtEnd = i == table->cap - 1;
+  if (arrCap <= oldCap) {
+    return;
+  }
 
-    if (IS_VAL_EMPTY(entry->key)) {
-      if (isAtEnd) {
-        printf("]");
-      }
+  for (uint32_t i = 0; i < table->next; i++) {
+    Entry *entry = &table->entries[i];
+    Val *slot = tableArrSlot(table, entry->key);
 
+    if (slot == NULL) {
       continue;
     }
 
-    if (!isFirst) {
-      printf(", ");
+    *slot = entry->val;
+    table->arrCount++;
+
+    entry->key = EMPTY_VAL;
+    entry->val = NIL_VAL;
+  }
+}
+
+// rebalances the two parts, counting `key` as if it were already in, and
+// then rebuilds the hash part with room for twice its live keys--which 
+// doubles a full hash part, since capFor() rounds 2 * 7/8 of it up to 
+// the next power of two.  a tight resize leaves no room at all.
+static void resize(Table *table, Val key, bool isTight) {
+  uint32_t nums[MAX_ARR_BITS + 1] = { 0 };
+
+  for (uint32_t i = 0; i < table->arrCap; i++) {
+    if (!IS_VAL_EMPTY(table->arr[i])) {
+      nums[arrKeyBits(NUM_VAL((double)i))]++;
     }
+  }
 
-    printEntryVal(entry->key);
-    printf(": ");
-    printEntryVal(entry->val);
+  for (uint32_t i = 0; i < table->next; i++) {
+    const int bits = arrKeyBits(table->entries[i].key);
 
-    if (isAtEnd) {
-      printf("]");
+    if (bits >= 0) {
+      nums[bits]++;
     }
+  }
+
+  const int keyBits = arrKeyBits(key);
+  if (keyBits >= 0) {
+    nums[keyBits]++;
+  }
+
+  const uint32_t arrCap = optimalArrCap(nums);
+  if (arrCap != table->arrCap) {
+    resizeArr(table, arrCap);
+  }
 
-    isFirst = false;
+  const uint32_t live = table->count - table->arrCount;
+
+  adjustCap(table, capFor(isTight ? live : 2 * (uint64_t)live));
+
+  if (isTight && table->entryCap > table->next) {
+    table->entries = GROW_ARR(
+      Entry,
+      table->entries,
+      table->entryCap,
+      table->next
+    );
+
+    table->entryCap = table->next;
   }
 }
 
-uint32_t tableStrLength(Table *table) {
-  if (table->next == 0) {
-    // [:]
-    return 3;
+// a resize leaves either part between 1/4 and 1/2 full, so waiting until 
+// one is under 1/8 full before shrinking keeps alternating inserts and
+// deletes from resizing it back and forth.  the same goes for holes: 
+// they’re only squeezed out early once they outnumber live entries 3 to 1.
+static void shrinkIfSparse(Table *table) {
+  const uint32_t live = table->count - table->arrCount;
+  const uint32_t holes = table->next - live;
+
+  const bool isHashSparse = table->cap > MIN_CAP && live < table->cap / 8;
+  const bool isArrSparse = (
+    table->arrCap > MIN_CAP && 
+    table->arrCount < table->arrCap / 8
+  );
+
+  const bool isMostlyHoles = holes > MIN_CAP && holes / 3 >= live;
+
+  if (isHashSparse || isArrSparse || isMostlyHoles) {
+    resize(table, EMPTY_VAL, false);
   }
+}
 
-  const uint32_t sepLength = 2;
+static void printEntryVal(Writer *out, Val val) {
+  const bool isStr = (
+    IS_VAL_OBJ(val) && 
+    VAL_AS_OBJ(val)->type == OBJ_STR
+  );
 
-  // 1 => initial '['
-  uint32_t length = 1;
+  if (isStr) {
+    WRITER_APPEND_LIT(out, "\"");
+  }
 
-  bool isFirst = true;
+  printVal(out, val);
 
-  for (uint32_t i = 0; i < table->cap; i++) {
-    Entry *entry = &table->entries[i];
+  if (isStr) {
+    WRITER_APPEND_LIT(out, "\"");
+  }
+}
 
-    const bool isAtEnd = i == table->cap - 1;
+bool tableNext(Table *table, uint32_t *i, Val *key, Val *val) {
+  for (; *i < table->arrCap; (*i)++) {
+    if (!IS_VAL_EMPTY(table->arr[*i])) {
+      *key = NUM_VAL((double)*i);
+      *val = table->arr[(*i)++];
 
-    if (IS_VAL_EMPTY(entry->key)) {
-      length += isAtEnd;
-      continue;
+      return true;
     }
+  }
 
-    if (!isFirst) {
-      length += sepLength;
+  for (; *i - table->arrCap < table->next; (*i)++) {
+    const Entry *entry = &table->entries[*i - table->arrCap];
+
+    if (!IS_VAL_EMPTY(entry->key)) {
+      *key = entry->key;
+      *val = entry->val;
+      (*i)++;
+
+      return true;
     }
+  }
+
+  return false;
+}
+
+void initTable(Table *table, const uint32_t cap) {
+  table->count = 0;
 
-    length += valStrLength(entry->key);
-    length += sepLength;
-    length += valStrLength(entry->val);
+  table->arrCap = 0;
+  table->arrCount = 0;
+  table->arr = NULL;
 
-    length += isAtEnd;
+  table->next = 0;
+
+  if (cap > 0) {
+    allocSlots(table, capFor(cap));
 
-    isFirst = false;
+    table->entryCap = cap;
+    table->entries = ALLOC(Entry, cap);
+
+    return;
   }
 
-  return length;
+  clearSlots(table);
+
+  table->entryCap = 0;
+  table->entries = NULL;
+}
+
+static bool setArr(Table *table, Val *arrSlot, Val val) {
+  const bool isNew = IS_VAL_EMPTY(*arrSlot);
+
+  *arrSlot = val;
+
+  table->arrCount += isNew;
+  table->count += isNew;
+
+  return isNew;
 }
 
-uint32_t tableAsStr(const char *buffer, const uint32_t size, Table *table) {
-  if (table->next == 0) {
-    const uint32_t length = 3;
+static bool setHashed(Table *table, Val key, Val val, uint32_t hash) {
+  if (table->count > table->arrCount) {
+    const uint32_t found = findSlot(table, key, hash);
 
-    strncpy((char *)buffer, "[:]", length);
-    return length;
+    if (found != NO_SLOT) {
+      SLOT_ENTRY(table, found)->val = val;
+      return false;
+    }
   }
 
-  const uint32_t newSize = size + 1;
+  if (table->next + 1 > MAX_LOAD(table->cap)) {
+    resize(table, key, false);
 
-  uint32_t pos = (uint32_t)snprintf((char *)buffer, newSize, "[");
+    // the array part might have grown to fit `key`.
+    Val *arrSlot = tableArrSlot(table, key);
 
-  bool isFirst = true;
+    if (arrSlot != NULL) {
+      return setArr(table, arrSlot, val);
+    }
+  }
 
-  for (uint32_t i = 0; i < table->cap; i++) {
-    Entry *entry = &table->entries[i];
+  if (table->next == table->entryCap) {
+    growEntries(table, table->next + 1);
+  }
 
-    const bool isAtEnd = i == table->cap - 1;
+  const uint32_t index = table->next++;
 
-    if (IS_VAL_EMPTY(entry->key)) {
-      if (isAtEnd) {
-        pos += (uint32_t)snprintf((char *)&buffer[pos], newSize - pos, "]");
-      }
-      
-      continue;
+  insertSlot(table, hash, index);
+  table->count++;
+
+  Entry *entry = &table->entries[index];
+  entry->key = key;
+  entry->val = val;
+  entry->hash = hash;
+
+  return true;
+}
+
+static Val getArr(const Val *arrSlot) {
+  return IS_VAL_EMPTY(*arrSlot) ? NIL_VAL : *arrSlot;
+}
+
+static Val getHashed(Table *table, Val key, uint32_t hash) {
+  if (table->count == table->arrCount) {
+    return NIL_VAL;
+  }
+
+  const uint32_t slot = findSlot(table, key, hash);
+  if (slot == NO_SLOT) {
+    return NIL_VAL;
+  }
+
+  return SLOT_ENTRY(table, slot)->val;
+}
+
+bool tableSet(Table *table, Val key, Val val) {
+  Val *arrSlot = tableArrSlot(table, key);
+
+  if (arrSlot != NULL) {
+    return setArr(table, arrSlot, val);
+  }
+
+  return setHashed(table, key, val, hashVal(key));
+}
+
+Val tableGet(Table *table, Val key) {
+  const Val *arrSlot = tableArrSlot(table, key);
+
+  if (arrSlot != NULL) {
+    return getArr(arrSlot);
+  }
+
+  return getHashed(table, key, hashVal(key));
+}
+
+bool tableDel(Table *table, Val key) {
+  Val *arrSlot = tableArrSlot(table, key);
+
+  if (arrSlot != NULL) {
+    if (IS_VAL_EMPTY(*arrSlot)) {
+      return false;
     }
 
+    *arrSlot = EMPTY_VAL;
+
+    table->arrCount--;
+    table->count--;
+
+    shrinkIfSparse(table);
+    return true;
+  }
+
+  if (table->count == table->arrCount) {
+    return false;
+  }
+
+  const uint32_t slot = findSlot(table, key, hashVal(key));
+  if (slot == NO_SLOT) {
+    return false;
+  }
+
+  // the entry itself stays behind as a hole until the next adjustCap().
+  Entry *entry = SLOT_ENTRY(table, slot);
+
+  removeSlot(table, slot);
+  table->count--;
+
+  entry->key = EMPTY_VAL;
+  entry->val = NIL_VAL;
+
+  shrinkIfSparse(table);
+  return true;
+}
+
+void tableCompact(Table *table) {
+  if (table->count == 0) {
+    freeTable(table);
+    return;
+  }
+
+  resize(table, EMPTY_VAL, true);
+}
+
+void copyTable(Table *into, const Table *from) {
+  initTable(into, 0);
+
+  into->count = from->count;
+  into->arrCount = from->arrCount;
+  into->next = from->next;
+
+  if (from->cap > 0) {
+    copySlots(into, from);
+  }
+
+  if (from->next > 0) {
+    into->entryCap = from->next;
+    into->entries = ALLOC(Entry, from->next);
+
+    memcpy(into->entries, from->entries, sizeof (Entry) * from->next);
+  }
+
+  if (from->arrCap > 0) {
+    into->arrCap = from->arrCap;
+    into->arr = ALLOC(Val, from->arrCap);
+
+    memcpy(into->arr, from->arr, sizeof (Val) * from->arrCap);
+  }
+}
+
+void printTable(Writer *out, Table *table) {
+  if (table->count == 0) {
+    WRITER_APPEND_LIT(out, "[:]");
+    return;
+  }
+
+  WRITER_APPEND_LIT(out, "[");
+
+  uint32_t i = 0;
+  Val key;
+  Val val;
+
+  for (bool isFirst = true; tableNext(table, &i, &key, &val); isFirst = false) {
     if (!isFirst) {
-      pos += (uint32_t)snprintf((char *)&buffer[pos], newSize - pos, ", ");
+      WRITER_APPEND_LIT(out, ", ");
     }
 
-    const uint32_t keySize = valStrLength(entry->key);
-    const uint32_t valSize = valStrLength(entry->val);
+    printEntryVal(out, key);
+    WRITER_APPEND_LIT(out, ": ");
+    printEntryVal(out, val);
+  }
+
+  WRITER_APPEND_LIT(out, "]");
+}
+
+void tableAsStr(StrBuf *buf, Table *table) {
+  if (table->count == 0) {
+    STR_BUF_APPEND_LIT(buf, "[:]");
+    return;
+  }
+
+  STR_BUF_APPEND_LIT(buf, "[");
 
-    pos += valAsStr((char *)&buffer[pos], keySize, entry->key);
-    pos += (uint32_t)snprintf((char *)&buffer[pos], newSize - pos, ": ");
-    pos += valAsStr((char *)&buffer[pos], valSize, entry->val);
+  uint32_t i = 0;
+  Val key;
+  Val val;
 
-    if (isAtEnd) {
-      strncpy((char *)&buffer[pos], "]", newSize - pos);
-      pos++;
+  for (bool isFirst = true; tableNext(table, &i, &key, &val); isFirst = false) {
+    if (!isFirst) {
+      STR_BUF_APPEND_LIT(buf, ", ");
     }
 
-    isFirst = false;
+    valAsStr(buf, key);
+    STR_BUF_APPEND_LIT(buf, ": ");
+    valAsStr(buf, val);
   }
 
-  return size;
+  STR_BUF_APPEND_LIT(buf, "]");
 }
 
 void freeTable(Table *table) {
-  FREE_ARR(Entry, table->entries, table->cap);  
+  freeSlots(table);
+  FREE_ARR(Entry, table->entries, table->entryCap);
+  FREE_ARR(Val, table->arr, table->arrCap);
 
-  table->cap = 0;
-  table->next = 0;
-  table->entries = NULL;
+  initTable(table, 0);
 }
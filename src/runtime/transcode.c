@@ -0,0 +1,951 @@
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// like utf8.c’s AVX2 kernel, the SSSE3 kernels are picked at run time.
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TRANSCODE_SSSE3
+#endif
+
+#include "transcode.h"
+#include "utf8.h"
+
+// NOLINTBEGIN
+
+// for UTF-16 units only.
+#define IS_SURROGATE(unit)      (((unit) & 0xF800) == 0xD800)
+#define IS_HIGH_SURROGATE(unit) (((unit) & 0xFC00) == 0xD800)
+#define IS_LOW_SURROGATE(unit)  (((unit) & 0xFC00) == 0xDC00)
+
+static uint16_t readUnit16(const char *chars) {
+  uint16_t unit;
+  memcpy(&unit, chars, sizeof (unit));
+
+  return unit;
+}
+
+static uint32_t readUnit32(const char *chars) {
+  uint32_t unit;
+  memcpy(&unit, chars, sizeof (unit));
+
+  return unit;
+}
+
+static void writeUnit16(char *into, uint32_t unit) {
+  const uint16_t half = (uint16_t)unit;
+  memcpy(into, &half, sizeof (half));
+}
+
+static void writeUnit32(char *into, uint32_t unit) {
+  memcpy(into, &unit, sizeof (unit));
+}
+
+// the decoders take valid input, advance `*i` past the code point they
+// read, and return it.
+
+static inline uint32_t decodeUtf8(const char *chars, size_t *i) {
+  const uint8_t *bytes = (const uint8_t *)&chars[*i];
+  const uint32_t lead = bytes[0];
+
+  if (lead < 0x80) {
+    *i += 1;
+    return lead;
+  }
+
+  if (lead < 0xE0) {
+    *i += 2;
+    return (lead & 0x1F) << 6 | (bytes[1] & 0x3Fu);
+  }
+
+  if (lead < 0xF0) {
+    *i += 3;
+    return (
+      (lead & 0x0F) << 12 |
+      (bytes[1] & 0x3Fu) << 6 |
+      (bytes[2] & 0x3Fu)
+    );
+  }
+
+  *i += 4;
+  return (
+    (lead & 0x07) << 18 |
+    (bytes[1] & 0x3Fu) << 12 |
+    (bytes[2] & 0x3Fu) << 6 |
+    (bytes[3] & 0x3Fu)
+  );
+}
+
+static inline uint32_t decodeUtf16(const char *chars, size_t *i) {
+  const uint32_t unit = readUnit16(&chars[*i]);
+
+  if (!IS_HIGH_SURROGATE(unit)) {
+    *i += 2;
+    return unit;
+  }
+
+  const uint32_t low = readUnit16(&chars[*i + 2]);
+
+  *i += 4;
+  return 0x10000 + ((unit - 0xD800) << 10 | (low - 0xDC00));
+}
+
+static uint32_t decodeUtf32(const char *chars, size_t *i) {
+  const uint32_t unit = readUnit32(&chars[*i]);
+
+  *i += 4;
+  return unit;
+}
+
+// the encoders return how many bytes they wrote.
+
+static inline uint32_t encodeUtf8(uint32_t codePoint, char *into) {
+  uint8_t *bytes = (uint8_t *)into;
+
+  if (codePoint < 0x80) {
+    bytes[0] = (uint8_t)codePoint;
+    return 1;
+  }
+
+  if (codePoint < 0x800) {
+    bytes[0] = (uint8_t)(0xC0 | codePoint >> 6);
+    bytes[1] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    return 2;
+  }
+
+  if (codePoint < 0x10000) {
+    bytes[0] = (uint8_t)(0xE0 | codePoint >> 12);
+    bytes[1] = (uint8_t)(0x80 | (codePoint >> 6 & 0x3F));
+    bytes[2] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    return 3;
+  }
+
+  bytes[0] = (uint8_t)(0xF0 | codePoint >> 18);
+  bytes[1] = (uint8_t)(0x80 | (codePoint >> 12 & 0x3F));
+  bytes[2] = (uint8_t)(0x80 | (codePoint >> 6 & 0x3F));
+  bytes[3] = (uint8_t)(0x80 | (codePoint & 0x3F));
+  return 4;
+}
+
+static inline uint32_t encodeUtf16(uint32_t codePoint, char *into) {
+  if (codePoint < 0x10000) {
+    writeUnit16(into, codePoint);
+    return 2;
+  }
+
+  const uint32_t offset = codePoint - 0x10000;
+
+  writeUnit16(into, 0xD800 | offset >> 10);
+  writeUnit16(&into[2], 0xDC00 | (offset & 0x3FF));
+  return 4;
+}
+
+static uint32_t encodeUtf32(uint32_t codePoint, char *into) {
+  writeUnit32(into, codePoint);
+  return 4;
+}
+
+// the kernels below go a 16-byte block at a time.  blocks that are all
+// ASCII (or, between UTF-16 and UTF-32, free of surrogate pairs) are
+// converted with a few shuffles; any other block is decoded a code point
+// at a time up to where it ends, and picks up again from there.
+
+#ifdef __SSE2__
+static __m128i load(const char *chars) {
+  return _mm_loadu_si128((const __m128i *)chars);
+}
+
+static void store(char *into, __m128i block) {
+  _mm_storeu_si128((__m128i *)into, block);
+}
+
+// whether no lane has any of the bits in `mask` set.
+static bool noneSet16(__m128i block, uint16_t mask) {
+  const __m128i masked = _mm_and_si128(block, _mm_set1_epi16((short)mask));
+
+  return _mm_movemask_epi8(
+    _mm_cmpeq_epi16(masked, _mm_setzero_si128())
+  ) == 0xFFFF;
+}
+
+static bool noneSet32(__m128i block, uint32_t mask) {
+  const __m128i masked = _mm_and_si128(block, _mm_set1_epi32((int)mask));
+
+  return _mm_movemask_epi8(
+    _mm_cmpeq_epi32(masked, _mm_setzero_si128())
+  ) == 0xFFFF;
+}
+#endif
+
+static uint32_t utf8ToUtf16(const char *chars, size_t byteLength, char *into) {
+  size_t i = 0;
+  uint32_t written = 0;
+
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+
+  while (i + 16 <= byteLength) {
+    const __m128i block = load(&chars[i]);
+
+    if (_mm_movemask_epi8(block) == 0) {
+      store(&into[written], _mm_unpacklo_epi8(block, zero));
+      store(&into[written + 16], _mm_unpackhi_epi8(block, zero));
+
+      i += 16;
+      written += 32;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 16; i < blockEnd; ) {
+      written += encodeUtf16(decodeUtf8(chars, &i), &into[written]);
+    }
+  }
+#endif
+
+  while (i < byteLength) {
+    written += encodeUtf16(decodeUtf8(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+
+static uint32_t utf8ToUtf32(const char *chars, size_t byteLength, char *into) {
+  size_t i = 0;
+  uint32_t written = 0;
+
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+
+  while (i + 16 <= byteLength) {
+    const __m128i block = load(&chars[i]);
+
+    if (_mm_movemask_epi8(block) == 0) {
+      const __m128i low = _mm_unpacklo_epi8(block, zero);
+      const __m128i high = _mm_unpackhi_epi8(block, zero);
+
+      store(&into[written], _mm_unpacklo_epi16(low, zero));
+      store(&into[written + 16], _mm_unpackhi_epi16(low, zero));
+      store(&into[written + 32], _mm_unpacklo_epi16(high, zero));
+      store(&into[written + 48], _mm_unpackhi_epi16(high, zero));
+
+      i += 16;
+      written += 64;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 16; i < blockEnd; ) {
+      written += encodeUtf32(decodeUtf8(chars, &i), &into[written]);
+    }
+  }
+#endif
+
+  while (i < byteLength) {
+    written += encodeUtf32(decodeUtf8(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+
+static uint32_t utf16ToUtf8(const char *chars, size_t byteLength, char *into) {
+  size_t i = 0;
+  uint32_t written = 0;
+
+#ifdef __SSE2__
+  while (i + 32 <= byteLength) {
+    const __m128i low = load(&chars[i]);
+    const __m128i high = load(&chars[i + 16]);
+
+    if (noneSet16(_mm_or_si128(low, high), 0xFF80)) {
+      store(&into[written], _mm_packus_epi16(low, high));
+
+      i += 32;
+      written += 16;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 32; i < blockEnd; ) {
+      written += encodeUtf8(decodeUtf16(chars, &i), &into[written]);
+    }
+  }
+#endif
+
+  while (i < byteLength) {
+    written += encodeUtf8(decodeUtf16(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+
+static uint32_t utf16ToUtf32(const char *chars, size_t byteLength, char *into) {
+  size_t i = 0;
+  uint32_t written = 0;
+
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i surrogateMask = _mm_set1_epi16((short)0xF800);
+  const __m128i surrogates = _mm_set1_epi16((short)0xD800);
+
+  while (i + 16 <= byteLength) {
+    const __m128i block = load(&chars[i]);
+
+    const __m128i isSurrogate = _mm_cmpeq_epi16(
+      _mm_and_si128(block, surrogateMask),
+      surrogates
+    );
+
+    if (_mm_movemask_epi8(isSurrogate) == 0) {
+      store(&into[written], _mm_unpacklo_epi16(block, zero));
+      store(&into[written + 16], _mm_unpackhi_epi16(block, zero));
+
+      i += 16;
+      written += 32;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 16; i < blockEnd; ) {
+      written += encodeUtf32(decodeUtf16(chars, &i), &into[written]);
+    }
+  }
+#endif
+
+  while (i < byteLength) {
+    written += encodeUtf32(decodeUtf16(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+
+static uint32_t utf32ToUtf8(const char *chars, size_t byteLength, char *into) {
+  size_t i = 0;
+  uint32_t written = 0;
+
+#ifdef __SSE2__
+  while (i + 64 <= byteLength) {
+    const __m128i a = load(&chars[i]);
+    const __m128i b = load(&chars[i + 16]);
+    const __m128i c = load(&chars[i + 32]);
+    const __m128i d = load(&chars[i + 48]);
+
+    const __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+
+    if (noneSet32(all, 0xFFFFFF80)) {
+      const __m128i ab = _mm_packs_epi32(a, b);
+      const __m128i cd = _mm_packs_epi32(c, d);
+
+      store(&into[written], _mm_packus_epi16(ab, cd));
+
+      i += 64;
+      written += 16;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 64; i < blockEnd; ) {
+      written += encodeUtf8(decodeUtf32(chars, &i), &into[written]);
+    }
+  }
+#endif
+
+  while (i < byteLength) {
+    written += encodeUtf8(decodeUtf32(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+
+#ifdef __SSE2__
+// SSE2 can only pack with signed saturation, so the low halves are sign
+// extended first, which packing then undoes.
+static __m128i signExtend16(__m128i block) {
+  return _mm_srai_epi32(_mm_slli_epi32(block, 16), 16);
+}
+#endif
+
+static uint32_t utf32ToUtf16(const char *chars, size_t byteLength, char *into) {
+  size_t i = 0;
+  uint32_t written = 0;
+
+#ifdef __SSE2__
+  while (i + 32 <= byteLength) {
+    const __m128i low = load(&chars[i]);
+    const __m128i high = load(&chars[i + 16]);
+
+    if (noneSet32(_mm_or_si128(low, high), 0xFFFF0000)) {
+      store(
+        &into[written],
+        _mm_packs_epi32(signExtend16(low), signExtend16(high))
+      );
+
+      i += 32;
+      written += 16;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 32; i < blockEnd; ) {
+      written += encodeUtf16(decodeUtf32(chars, &i), &into[written]);
+    }
+  }
+#endif
+
+  while (i < byteLength) {
+    written += encodeUtf16(decodeUtf32(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+
+#ifdef TRANSCODE_SSSE3
+// with a byte shuffle, text outside ASCII can be converted to UTF-8 a
+// block at a time too, as long as it stays within the BMP.  each code
+// point is spread over a 32-bit lane holding its one to three UTF-8
+// bytes, and a shuffle picked by the lanes’ lengths packs them together.
+//
+// the tables are indexed by two nibbles: the low one has a bit set for
+// each lane that isn’t ASCII, the high one for each lane that takes up
+// three bytes.
+static uint8_t utf8Shuffles[256][16];
+static uint8_t utf8Lengths[256];
+static bool hasUtf8Shuffles = false;
+
+static void initUtf8Shuffles(void) {
+  for (uint32_t index = 0; index < 256; index++) {
+    uint8_t *shuffle = utf8Shuffles[index];
+    memset(shuffle, 0x80, sizeof (utf8Shuffles[index]));
+
+    uint8_t length = 0;
+
+    for (uint8_t lane = 0; lane < 4; lane++) {
+      const uint32_t isMultiByte = index >> lane & 1;
+      const uint32_t isThreeBytes = index >> (lane + 4) & 1;
+
+      // a lane’s bytes are right-aligned, so shorter ones skip its first.
+      const uint8_t skip = (uint8_t)(2 - isMultiByte - isThreeBytes);
+
+      for (uint8_t byte = skip; byte < 3; byte++) {
+        shuffle[length++] = (uint8_t)(4 * lane + byte);
+      }
+    }
+
+    utf8Lengths[index] = length;
+  }
+
+  hasUtf8Shuffles = true;
+}
+
+// writes four code points below U+10000 as UTF-8.  it always stores 16 
+// bytes, and returns how many of them count.
+__attribute__((target("ssse3")))
+static inline uint32_t bmpToUtf8(
+  __m128i codePoints,
+  uint32_t index,
+  char *into
+) {
+  const __m128i sixBits = _mm_set1_epi32(0x3F);
+
+  const __m128i low = _mm_and_si128(codePoints, sixBits);
+  const __m128i middle = _mm_and_si128(
+    _mm_srli_epi32(codePoints, 6),
+    sixBits
+  );
+
+  // three bytes, 1110xxxx 10xxxxxx 10xxxxxx.  for two-byte code points
+  // the top four bits are all zero, so the last two bytes are almost
+  // right, but for the lead byte’s 0x40 bit.
+  const __m128i threeBytes = _mm_or_si128(
+    _mm_or_si128(
+      _mm_srli_epi32(codePoints, 12),
+      _mm_slli_epi32(middle, 8)
+    ),
+    _mm_or_si128(_mm_slli_epi32(low, 16), _mm_set1_epi32(0x8080E0))
+  );
+
+  const __m128i isTwoBytes = _mm_cmpeq_epi32(
+    _mm_and_si128(codePoints, _mm_set1_epi32(~0x7FF)),
+    _mm_setzero_si128()
+  );
+
+  const __m128i isAscii = _mm_cmpeq_epi32(
+    _mm_and_si128(codePoints, _mm_set1_epi32(~0x7F)),
+    _mm_setzero_si128()
+  );
+
+  const __m128i multiByte = _mm_or_si128(
+    threeBytes,
+    _mm_and_si128(isTwoBytes, _mm_set1_epi32(0x4000))
+  );
+
+  const __m128i lanes = _mm_or_si128(
+    _mm_and_si128(isAscii, _mm_slli_epi32(codePoints, 16)),
+    _mm_andnot_si128(isAscii, multiByte)
+  );
+
+  const __m128i shuffle = load((const char *)utf8Shuffles[index]);
+
+  store(into, _mm_shuffle_epi8(lanes, shuffle));
+  return utf8Lengths[index];
+}
+
+__attribute__((target("ssse3")))
+static uint32_t utf16ToUtf8Ssse3(
+  const char *chars,
+  size_t byteLength,
+  char *into
+) {
+  if (!hasUtf8Shuffles) {
+    initUtf8Shuffles();
+  }
+
+  size_t i = 0;
+  uint32_t written = 0;
+
+  const __m128i zero = _mm_setzero_si128();
+
+  while (i + 16 <= byteLength) {
+    const __m128i block = load(&chars[i]);
+
+    const __m128i isAscii = _mm_cmpeq_epi16(
+      _mm_and_si128(block, _mm_set1_epi16((short)0xFF80)),
+      zero
+    );
+
+    const uint32_t ascii = (uint32_t)_mm_movemask_epi8(
+      _mm_packs_epi16(isAscii, zero)
+    );
+
+    if (ascii == 0xFF) {
+      _mm_storel_epi64(
+        (__m128i *)&into[written],
+        _mm_packus_epi16(block, block)
+      );
+
+      i += 16;
+      written += 8;
+      continue;
+    }
+
+    const __m128i isSurrogate = _mm_cmpeq_epi16(
+      _mm_and_si128(block, _mm_set1_epi16((short)0xF800)),
+      _mm_set1_epi16((short)0xD800)
+    );
+
+    if (_mm_movemask_epi8(isSurrogate) == 0) {
+      const __m128i isTwoBytes = _mm_cmpeq_epi16(
+        _mm_and_si128(block, _mm_set1_epi16((short)0xF800)),
+        zero
+      );
+
+      const uint32_t multiByte = ~ascii & 0xFF;
+      const uint32_t threeBytes = ~(uint32_t)_mm_movemask_epi8(
+        _mm_packs_epi16(isTwoBytes, zero)
+      ) & 0xFF;
+
+      written += bmpToUtf8(
+        _mm_unpacklo_epi16(block, zero),
+        (multiByte & 0x0F) | (threeBytes & 0x0F) << 4,
+        &into[written]
+      );
+
+      written += bmpToUtf8(
+        _mm_unpackhi_epi16(block, zero),
+        multiByte >> 4 | (threeBytes & 0xF0),
+        &into[written]
+      );
+
+      i += 16;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 16; i < blockEnd; ) {
+      written += encodeUtf8(decodeUtf16(chars, &i), &into[written]);
+    }
+  }
+
+  while (i < byteLength) {
+    written += encodeUtf8(decodeUtf16(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+
+__attribute__((target("ssse3")))
+static uint32_t utf32ToUtf8Ssse3(
+  const char *chars,
+  size_t byteLength,
+  char *into
+) {
+  if (!hasUtf8Shuffles) {
+    initUtf8Shuffles();
+  }
+
+  size_t i = 0;
+  uint32_t written = 0;
+
+  const __m128i zero = _mm_setzero_si128();
+
+  while (i + 16 <= byteLength) {
+    const __m128i block = load(&chars[i]);
+
+    const uint32_t ascii = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(
+      _mm_cmpeq_epi32(_mm_and_si128(block, _mm_set1_epi32(~0x7F)), zero)
+    ));
+
+    const uint32_t twoBytes = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(
+      _mm_cmpeq_epi32(_mm_and_si128(block, _mm_set1_epi32(~0x7FF)), zero)
+    ));
+
+    const bool isBmp = noneSet32(block, 0xFFFF0000);
+
+    if (ascii == 0xF) {
+      const __m128i packed = _mm_packs_epi32(block, zero);
+      const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(packed, zero));
+
+      memcpy(&into[written], &bytes, sizeof (bytes));
+
+      i += 16;
+      written += 4;
+      continue;
+    }
+
+    if (isBmp) {
+      written += bmpToUtf8(
+        block,
+        (~ascii & 0xF) | (~twoBytes & 0xF) << 4,
+        &into[written]
+      );
+
+      i += 16;
+      continue;
+    }
+
+    for (const size_t blockEnd = i + 16; i < blockEnd; ) {
+      written += encodeUtf8(decodeUtf32(chars, &i), &into[written]);
+    }
+  }
+
+  while (i < byteLength) {
+    written += encodeUtf8(decodeUtf32(chars, &i), &into[written]);
+  }
+
+  return written;
+}
+#endif
+
+static bool validateUtf16(
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t *length
+) {
+  if (byteLength % 2 != 0) {
+    return false;
+  }
+
+  size_t i = 0;
+  uint32_t codePoints = 0;
+
+#ifdef __SSE2__
+  const __m128i surrogateMask = _mm_set1_epi16((short)0xF800);
+  const __m128i surrogates = _mm_set1_epi16((short)0xD800);
+
+  while (i + 16 <= byteLength) {
+    const __m128i isSurrogate = _mm_cmpeq_epi16(
+      _mm_and_si128(load(&chars[i]), surrogateMask),
+      surrogates
+    );
+
+    if (_mm_movemask_epi8(isSurrogate) != 0) {
+      break;
+    }
+
+    i += 16;
+    codePoints += 8;
+  }
+#endif
+
+  while (i < byteLength) {
+    const uint32_t unit = readUnit16(&chars[i]);
+
+    if (!IS_SURROGATE(unit)) {
+      i += 2;
+      codePoints++;
+      continue;
+    }
+
+    const bool isPaired = (
+      IS_HIGH_SURROGATE(unit) &&
+      i + 4 <= byteLength &&
+      IS_LOW_SURROGATE(readUnit16(&chars[i + 2]))
+    );
+
+    if (!isPaired) {
+      return false;
+    }
+
+    i += 4;
+    codePoints++;
+  }
+
+  *length = codePoints;
+  return true;
+}
+
+static bool validateUtf32(
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t *length
+) {
+  if (byteLength % 4 != 0) {
+    return false;
+  }
+
+  size_t i = 0;
+
+#ifdef __SSE2__
+  const __m128i surrogateMask = _mm_set1_epi32((int)0xFFFFF800);
+  const __m128i surrogates = _mm_set1_epi32(0xD800);
+  const __m128i maxPlane = _mm_set1_epi32(0x10);
+
+  __m128i errors = _mm_setzero_si128();
+
+  for (; i + 16 <= byteLength; i += 16) {
+    const __m128i block = load(&chars[i]);
+
+    const __m128i isSurrogate = _mm_cmpeq_epi32(
+      _mm_and_si128(block, surrogateMask),
+      surrogates
+    );
+
+    // the plane fits in 16 bits once shifted down, so a signed compare
+    // is good enough.
+    const __m128i isTooLarge = _mm_cmpgt_epi32(
+      _mm_srli_epi32(block, 16),
+      maxPlane
+    );
+
+    errors = _mm_or_si128(errors, _mm_or_si128(isSurrogate, isTooLarge));
+  }
+
+  if (_mm_movemask_epi8(errors) != 0) {
+    return false;
+  }
+#endif
+
+  for (; i < byteLength; i += 4) {
+    const uint32_t unit = readUnit32(&chars[i]);
+
+    if (unit > 0x10FFFF || (unit >= 0xD800 && unit <= 0xDFFF)) {
+      return false;
+    }
+  }
+
+  *length = byteLength / 4;
+  return true;
+}
+
+bool validateStr(
+  Encoding encoding,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t *length
+) {
+  switch (encoding) {
+    case STR_UTF8:
+      return validateUtf8(chars, byteLength, length);
+
+    case STR_UTF16:
+      return validateUtf16(chars, byteLength, length);
+
+    case STR_UTF32:
+      return validateUtf32(chars, byteLength, length);
+  }
+
+  return false;
+}
+
+size_t transcodedCap(Encoding from, Encoding to, uint32_t byteLength) {
+  const size_t length = byteLength;
+
+  if (from == to) {
+    return length;
+  }
+
+  switch (from) {
+    // every byte is at most one UTF-16 or UTF-32 unit.
+    case STR_UTF8:
+      return to == STR_UTF16 ? 2 * length : 4 * length;
+
+    // a unit is at most three bytes of UTF-8, or one UTF-32 unit.  the
+    // SSSE3 kernel’s last store may go up to 4 bytes past the end.
+    case STR_UTF16:
+      return to == STR_UTF8 ? length / 2 * 3 + 4 : 2 * length;
+
+    // a code point never takes more than four bytes.
+    case STR_UTF32:
+      return length;
+  }
+
+  return 0;
+}
+
+uint32_t transcode(
+  Encoding from,
+  Encoding to,
+  const char *chars,
+  uint32_t byteLength,
+  char *into
+) {
+  switch (from * 3 + to) {
+    case STR_UTF8 * 3 + STR_UTF16:
+      return utf8ToUtf16(chars, byteLength, into);
+
+    case STR_UTF8 * 3 + STR_UTF32:
+      return utf8ToUtf32(chars, byteLength, into);
+
+    case STR_UTF16 * 3 + STR_UTF8:
+#ifdef TRANSCODE_SSSE3
+      if (__builtin_cpu_supports("ssse3")) {
+        return utf16ToUtf8Ssse3(chars, byteLength, into);
+      }
+#endif
+      return utf16ToUtf8(chars, byteLength, into);
+
+    case STR_UTF16 * 3 + STR_UTF32:
+      return utf16ToUtf32(chars, byteLength, into);
+
+    case STR_UTF32 * 3 + STR_UTF8:
+#ifdef TRANSCODE_SSSE3
+      if (__builtin_cpu_supports("ssse3")) {
+        return utf32ToUtf8Ssse3(chars, byteLength, into);
+      }
+#endif
+      return utf32ToUtf8(chars, byteLength, into);
+
+    case STR_UTF32 * 3 + STR_UTF16:
+      return utf32ToUtf16(chars, byteLength, into);
+
+    default:
+      memcpy(into, chars, byteLength);
+      return byteLength;
+  }
+}
+
+uint32_t wholeCodePoints(
+  Encoding encoding,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t maxLength
+) {
+  if (maxLength >= byteLength) {
+    return byteLength;
+  }
+
+  uint32_t length = maxLength;
+
+  switch (encoding) {
+    case STR_UTF8:
+      while (length > 0 && ((uint8_t)chars[length] & 0xC0) == 0x80) {
+        length--;
+      }
+      break;
+
+    case STR_UTF16:
+      length &= ~1u;
+
+      if (length > 0 && IS_HIGH_SURROGATE(readUnit16(&chars[length - 2]))) {
+        length -= 2;
+      }
+      break;
+
+    case STR_UTF32:
+      length &= ~3u;
+      break;
+  }
+
+  return length;
+}
+
+// finds where code point `index` starts by counting lead bytes.  whole
+// words that end before it are counted eight bytes at a time: a byte is a 
+// continuation byte if its top bit is set and the one below it isn’t.
+static uint32_t utf8Offset(
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t index
+) {
+  uint32_t i = 0;
+  uint32_t count = 0;
+
+  while (i + 8 <= byteLength) {
+    uint64_t word;
+    memcpy(&word, &chars[i], 8);
+
+    const uint64_t continuations = word & ~(word << 1) & 0x8080808080808080;
+    const uint32_t leads = 8 - (uint32_t)__builtin_popcountll(continuations);
+
+    if (count + leads > index) {
+      break;
+    }
+
+    count += leads;
+    i += 8;
+  }
+
+  for (; i < byteLength; i++) {
+    if (((uint8_t)chars[i] & 0xC0) == 0x80) {
+      continue;
+    }
+
+    if (count == index) {
+      return i;
+    }
+
+    count++;
+  }
+
+  return byteLength;
+}
+
+static uint32_t utf16Offset(
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t index
+) {
+  uint32_t count = 0;
+
+  for (uint32_t i = 0; i < byteLength; i += 2) {
+    if (IS_LOW_SURROGATE(readUnit16(&chars[i]))) {
+      continue;
+    }
+
+    if (count == index) {
+      return i;
+    }
+
+    count++;
+  }
+
+  return byteLength;
+}
+
+uint32_t codePointOffset(
+  Encoding encoding,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t index
+) {
+  switch (encoding) {
+    case STR_UTF8:
+      return utf8Offset(chars, byteLength, index);
+
+    case STR_UTF16:
+      return utf16Offset(chars, byteLength, index);
+
+    case STR_UTF32:
+      break;
+  }
+
+  const uint64_t offset = (uint64_t)index * 4;
+  return offset < byteLength ? (uint32_t)offset : byteLength;
+}
+
+// NOLINTEND
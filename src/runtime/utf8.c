@@ -0,0 +1,589 @@
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the SSSE3 and AVX2 kernels are compiled in whenever the compiler can
+// target them, and picked at run time if the CPU has them.
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define UTF8_LOOKUP
+#endif
+
+#include "utf8.h"
+
+// NOLINTBEGIN
+
+#define ASCII_WORD_MASK 0x8080808080808080ULL
+
+#define IS_CONT(byte) (((byte) & 0xC0) == 0x80)
+
+static uint64_t readWord(const uint8_t *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof (word));
+
+  return word;
+}
+
+// how many bytes the sequence at `bytes` takes up, or 0 if it’s malformed.
+// the ranges are those of the well-formed byte sequences table in the
+// Unicode standard (table 3-7).
+static uint32_t sequenceLength(const uint8_t *bytes, size_t left) {
+  const uint8_t lead = bytes[0];
+
+  if (lead < 0x80) {
+    return 1;
+  }
+
+  // stray continuation bytes, and leads that could only start overlong
+  // two-byte sequences.
+  if (lead < 0xC2 || lead > 0xF4) {
+    return 0;
+  }
+
+  if (lead < 0xE0) {
+    return left >= 2 && IS_CONT(bytes[1]) ? 2 : 0;
+  }
+
+  if (lead < 0xF0) {
+    const uint8_t min = lead == 0xE0 ? 0xA0 : 0x80;
+    const uint8_t max = lead == 0xED ? 0x9F : 0xBF;
+
+    const bool isValid = (
+      left >= 3 &&
+      bytes[1] >= min && bytes[1] <= max &&
+      IS_CONT(bytes[2])
+    );
+
+    return isValid ? 3 : 0;
+  }
+
+  const uint8_t min = lead == 0xF0 ? 0x90 : 0x80;
+  const uint8_t max = lead == 0xF4 ? 0x8F : 0xBF;
+
+  const bool isValid = (
+    left >= 4 &&
+    bytes[1] >= min && bytes[1] <= max &&
+    IS_CONT(bytes[2]) &&
+    IS_CONT(bytes[3])
+  );
+
+  return isValid ? 4 : 0;
+}
+
+// picks up at `from`, which must be the start of a sequence, and adds the
+// code points it finds to `count`.
+static bool validateScalar(
+  const uint8_t *bytes,
+  size_t from,
+  size_t byteLength,
+  uint32_t *count
+) {
+  size_t i = from;
+  uint32_t codePoints = *count;
+
+  while (i < byteLength) {
+    if (
+      i + 8 <= byteLength &&
+      (readWord(&bytes[i]) & ASCII_WORD_MASK) == 0
+    ) {
+      i += 8;
+      codePoints += 8;
+      continue;
+    }
+
+    const uint32_t length = sequenceLength(&bytes[i], byteLength - i);
+    if (length == 0) {
+      return false;
+    }
+
+    i += length;
+    codePoints++;
+  }
+
+  *count = codePoints;
+  return true;
+}
+
+#ifdef __SSE2__
+// SSE2 has no byte shuffle to classify bytes with, so this kernel only
+// skips ASCII 16 bytes at a time, and decodes anything else one sequence
+// at a time until it’s past the chunk that held it.  it’s what runs on
+// CPUs without SSSE3, which validate text outside ASCII at about the
+// speed of the scalar kernel.
+static bool validateSse2(
+  const uint8_t *bytes,
+  size_t byteLength,
+  uint32_t *count
+) {
+  size_t i = 0;
+  uint32_t codePoints = 0;
+
+  while (i + 16 <= byteLength) {
+    const __m128i chunk = _mm_loadu_si128((const __m128i *)&bytes[i]);
+    const uint32_t nonAscii = (uint32_t)_mm_movemask_epi8(chunk);
+
+    if (nonAscii == 0) {
+      i += 16;
+      codePoints += 16;
+      continue;
+    }
+
+    const size_t chunkEnd = i + 16;
+    const uint32_t asciiPrefix = (uint32_t)__builtin_ctz(nonAscii);
+
+    i += asciiPrefix;
+    codePoints += asciiPrefix;
+
+    while (i < chunkEnd) {
+      const uint32_t length = sequenceLength(&bytes[i], byteLength - i);
+      if (length == 0) {
+        return false;
+      }
+
+      i += length;
+      codePoints++;
+    }
+  }
+
+  *count = codePoints;
+  return validateScalar(bytes, i, byteLength, count);
+}
+#endif
+
+#ifdef UTF8_LOOKUP
+// John Keiser and Daniel Lemire’s lookup algorithm (“Validating UTF-8 In
+// Less Than One Instruction Per Byte”, 2021).  each byte is classified by
+// three 16-entry tables: the high and low nibbles of the byte before it,
+// and its own high nibble.  AND-ing the three leaves a bit set for every
+// error a pair of bytes can show; the only thing pairs can’t tell is
+// whether a continuation byte is the 3rd or 4th of its sequence, which
+// is checked against the bytes two and three places back.  the SSSE3 and
+// AVX2 kernels run the same steps on 16 and 32 bytes at a time.
+#define TOO_SHORT (1 << 0)
+#define TOO_LONG (1 << 1)
+#define OVERLONG_3 (1 << 2)
+#define TOO_LARGE (1 << 3)
+#define SURROGATE (1 << 4)
+#define OVERLONG_2 (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4 (1 << 6)
+#define TWO_CONTS (1 << 7)
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const uint8_t byte1HighTable[16] = {
+  TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+  TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+  TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+  TOO_SHORT | OVERLONG_2,
+  TOO_SHORT,
+  TOO_SHORT | OVERLONG_3 | SURROGATE,
+  TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+};
+
+static const uint8_t byte1LowTable[16] = {
+  CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+  CARRY | OVERLONG_2,
+  CARRY,
+  CARRY,
+  CARRY | TOO_LARGE,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000
+};
+
+static const uint8_t byte2HighTable[16] = {
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 |
+    TOO_LARGE_1000 | OVERLONG_4,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+// what a block that ends partway through a sequence has in its last three
+// bytes: subtracting these leaves something only where it does.
+static const uint8_t maxLeads[16] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+};
+
+#define TABLE128(table) _mm_loadu_si128((const __m128i *)(table))
+
+#define TABLE256(table)                                           \
+  _mm256_broadcastsi128_si256(TABLE128(table))
+
+// the 16 bytes ending `n` bytes into `input`, the rest coming from `prev`.
+#define PREV_BYTES128(input, prev, n)                             \
+  _mm_alignr_epi8((input), (prev), 16 - (n))
+
+// the 32 bytes ending `n` bytes into `input`, the rest coming from `prev`.
+#define PREV_BYTES256(input, prev, n)                             \
+  _mm256_alignr_epi8(                                             \
+    (input),                                                      \
+    _mm256_permute2x128_si256((prev), (input), 0x21),             \
+    16 - (n)                                                      \
+  )
+
+__attribute__((target("ssse3")))
+static inline __m128i blockErrors128(__m128i input, __m128i prev) {
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+
+  const __m128i prev1 = PREV_BYTES128(input, prev, 1);
+
+  const __m128i byte1High = _mm_shuffle_epi8(
+    TABLE128(byte1HighTable),
+    _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)
+  );
+
+  const __m128i byte1Low = _mm_shuffle_epi8(
+    TABLE128(byte1LowTable),
+    _mm_and_si128(prev1, nibble)
+  );
+
+  const __m128i byte2High = _mm_shuffle_epi8(
+    TABLE128(byte2HighTable),
+    _mm_and_si128(_mm_srli_epi16(input, 4), nibble)
+  );
+
+  const __m128i special = _mm_and_si128(
+    _mm_and_si128(byte1High, byte1Low),
+    byte2High
+  );
+
+  // only bytes 0b111_____ two back, or 0b1111____ three back, end up with
+  // their high bit set.
+  const __m128i isThird = _mm_subs_epu8(
+    PREV_BYTES128(input, prev, 2),
+    _mm_set1_epi8(0xE0 - 0x80)
+  );
+
+  const __m128i isFourth = _mm_subs_epu8(
+    PREV_BYTES128(input, prev, 3),
+    _mm_set1_epi8(0xF0 - 0x80)
+  );
+
+  const __m128i mustBeCont = _mm_and_si128(
+    _mm_or_si128(isThird, isFourth),
+    _mm_set1_epi8((char)0x80)
+  );
+
+  return _mm_xor_si128(mustBeCont, special);
+}
+
+// every byte but a continuation byte starts a code point.  the leads are
+// summed into two 64-bit lanes, since SSSE3 doesn’t come with popcnt.
+__attribute__((target("ssse3")))
+static inline __m128i blockLeads128(__m128i input) {
+  const __m128i leads = _mm_cmpgt_epi8(input, _mm_set1_epi8(-65));
+
+  return _mm_sad_epu8(
+    _mm_and_si128(leads, _mm_set1_epi8(1)),
+    _mm_setzero_si128()
+  );
+}
+
+__attribute__((target("ssse3")))
+static bool validateSsse3(
+  const uint8_t *bytes,
+  size_t byteLength,
+  uint32_t *count
+) {
+  __m128i errors = _mm_setzero_si128();
+  __m128i prev = _mm_setzero_si128();
+  __m128i prevIncomplete = _mm_setzero_si128();
+  __m128i leads = _mm_setzero_si128();
+
+  size_t i = 0;
+  uint32_t codePoints = 0;
+
+  for (; i + 16 <= byteLength; i += 16) {
+    const __m128i input = _mm_loadu_si128((const __m128i *)&bytes[i]);
+
+    if (_mm_movemask_epi8(input) == 0) {
+      errors = _mm_or_si128(errors, prevIncomplete);
+      codePoints += 16;
+    } else {
+      errors = _mm_or_si128(errors, blockErrors128(input, prev));
+      prevIncomplete = _mm_subs_epu8(input, TABLE128(maxLeads));
+      leads = _mm_add_epi64(leads, blockLeads128(input));
+    }
+
+    prev = input;
+  }
+
+  // the tail is padded out with ASCII zeros, which anything cut short will
+  // trip over, and which count as leads of their own.
+  if (i < byteLength) {
+    const size_t left = byteLength - i;
+
+    uint8_t block[16] = {0};
+    memcpy(block, &bytes[i], left);
+
+    const __m128i input = _mm_loadu_si128((const __m128i *)block);
+
+    errors = _mm_or_si128(errors, blockErrors128(input, prev));
+    prevIncomplete = _mm_subs_epu8(input, TABLE128(maxLeads));
+    leads = _mm_add_epi64(leads, blockLeads128(input));
+    codePoints -= (uint32_t)(16 - left);
+  }
+
+  errors = _mm_or_si128(errors, prevIncomplete);
+
+  codePoints += (uint32_t)(
+    _mm_cvtsi128_si64(leads) +
+    _mm_cvtsi128_si64(_mm_unpackhi_epi64(leads, leads))
+  );
+
+  *count = codePoints;
+  return _mm_movemask_epi8(
+    _mm_cmpeq_epi8(errors, _mm_setzero_si128())
+  ) == 0xFFFF;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blockErrors256(__m256i input, __m256i prev) {
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+  const __m256i prev1 = PREV_BYTES256(input, prev, 1);
+
+  const __m256i byte1High = _mm256_shuffle_epi8(
+    TABLE256(byte1HighTable),
+    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)
+  );
+
+  const __m256i byte1Low = _mm256_shuffle_epi8(
+    TABLE256(byte1LowTable),
+    _mm256_and_si256(prev1, nibble)
+  );
+
+  const __m256i byte2High = _mm256_shuffle_epi8(
+    TABLE256(byte2HighTable),
+    _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)
+  );
+
+  const __m256i special = _mm256_and_si256(
+    _mm256_and_si256(byte1High, byte1Low),
+    byte2High
+  );
+
+  const __m256i isThird = _mm256_subs_epu8(
+    PREV_BYTES256(input, prev, 2),
+    _mm256_set1_epi8(0xE0 - 0x80)
+  );
+
+  const __m256i isFourth = _mm256_subs_epu8(
+    PREV_BYTES256(input, prev, 3),
+    _mm256_set1_epi8(0xF0 - 0x80)
+  );
+
+  const __m256i mustBeCont = _mm256_and_si256(
+    _mm256_or_si256(isThird, isFourth),
+    _mm256_set1_epi8((char)0x80)
+  );
+
+  return _mm256_xor_si256(mustBeCont, special);
+}
+
+// non-zero if the block ends partway through a sequence; only the upper
+// half’s last three bytes can be.
+__attribute__((target("avx2")))
+static inline __m256i blockIncomplete256(__m256i input) {
+  const __m256i maxLeads256 = _mm256_inserti128_si256(
+    _mm256_set1_epi8(-1),
+    TABLE128(maxLeads),
+    1
+  );
+
+  return _mm256_subs_epu8(input, maxLeads256);
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline uint32_t blockLeads256(__m256i input, uint32_t mask) {
+  const __m256i leads = _mm256_cmpgt_epi8(input, _mm256_set1_epi8(-65));
+
+  return (uint32_t)__builtin_popcount(
+    (uint32_t)_mm256_movemask_epi8(leads) & mask
+  );
+}
+
+__attribute__((target("avx2,popcnt")))
+static bool validateAvx2(
+  const uint8_t *bytes,
+  size_t byteLength,
+  uint32_t *count
+) {
+  __m256i errors = _mm256_setzero_si256();
+  __m256i prev = _mm256_setzero_si256();
+  __m256i prevIncomplete = _mm256_setzero_si256();
+
+  size_t i = 0;
+  uint32_t codePoints = 0;
+
+  for (; i + 32 <= byteLength; i += 32) {
+    const __m256i input = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+
+    if (_mm256_movemask_epi8(input) == 0) {
+      errors = _mm256_or_si256(errors, prevIncomplete);
+      codePoints += 32;
+    } else {
+      errors = _mm256_or_si256(errors, blockErrors256(input, prev));
+      prevIncomplete = blockIncomplete256(input);
+      codePoints += blockLeads256(input, 0xFFFFFFFF);
+    }
+
+    prev = input;
+  }
+
+  // the tail is padded out with ASCII zeros, which anything cut short will
+  // trip over.
+  if (i < byteLength) {
+    const size_t left = byteLength - i;
+
+    uint8_t block[32] = {0};
+    memcpy(block, &bytes[i], left);
+
+    const __m256i input = _mm256_loadu_si256((const __m256i *)block);
+
+    errors = _mm256_or_si256(errors, blockErrors256(input, prev));
+    prevIncomplete = blockIncomplete256(input);
+    codePoints += blockLeads256(input, (1u << left) - 1);
+  }
+
+  errors = _mm256_or_si256(errors, prevIncomplete);
+
+  *count = codePoints;
+  return _mm256_testz_si256(errors, errors);
+}
+#endif
+
+// NOLINTEND
+
+bool hasUtf8Kernel(Utf8Kernel kernel) {
+  switch (kernel) {
+    case UTF8_KERNEL_SCALAR:
+      return true;
+
+    case UTF8_KERNEL_SSE2:
+#ifdef __SSE2__
+      return true;
+#else
+      return false;
+#endif
+
+    case UTF8_KERNEL_SSSE3:
+#ifdef UTF8_LOOKUP
+      return __builtin_cpu_supports("ssse3");
+#else
+      return false;
+#endif
+
+    case UTF8_KERNEL_AVX2:
+#ifdef UTF8_LOOKUP
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+  }
+
+  return false;
+}
+
+bool validateUtf8With(
+  Utf8Kernel kernel,
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t *length
+) {
+  const uint8_t *bytes = (const uint8_t *)chars;
+  uint32_t count = 0;
+  bool isValid = false;
+
+  switch (kernel) {
+    case UTF8_KERNEL_SCALAR:
+      isValid = validateScalar(bytes, 0, byteLength, &count);
+      break;
+
+    case UTF8_KERNEL_SSE2:
+#ifdef __SSE2__
+      isValid = validateSse2(bytes, byteLength, &count);
+#endif
+      break;
+
+    case UTF8_KERNEL_SSSE3:
+#ifdef UTF8_LOOKUP
+      isValid = validateSsse3(bytes, byteLength, &count);
+#endif
+      break;
+
+    case UTF8_KERNEL_AVX2:
+#ifdef UTF8_LOOKUP
+      isValid = validateAvx2(bytes, byteLength, &count);
+#endif
+      break;
+  }
+
+  if (isValid) {
+    *length = count;
+  }
+
+  return isValid;
+}
+
+bool validateUtf8(const char *chars, uint32_t byteLength, uint32_t *length) {
+#ifdef UTF8_LOOKUP
+  if (__builtin_cpu_supports("avx2")) {
+    return validateUtf8With(UTF8_KERNEL_AVX2, chars, byteLength, length);
+  }
+
+  if (__builtin_cpu_supports("ssse3")) {
+    return validateUtf8With(UTF8_KERNEL_SSSE3, chars, byteLength, length);
+  }
+#endif
+
+#ifdef __SSE2__
+  return validateUtf8With(UTF8_KERNEL_SSE2, chars, byteLength, length);
+#else
+  return validateUtf8With(UTF8_KERNEL_SCALAR, chars, byteLength, length);
+#endif
+}
+
+// NOLINTBEGIN
+
+// a byte is a continuation byte if its top bit is set and the one below it
+// isn’t, so a word’s code points are its bytes minus those.
+uint32_t countUtf8(const char *chars, uint32_t byteLength) {
+  const uint8_t *bytes = (const uint8_t *)chars;
+
+  uint32_t count = 0;
+  uint32_t i = 0;
+
+  for (; i + 8 <= byteLength; i += 8) {
+    const uint64_t word = readWord(&bytes[i]);
+    const uint64_t conts = word & ~(word << 1) & ASCII_WORD_MASK;
+
+    count += 8 - (uint32_t)__builtin_popcountll(conts);
+  }
+
+  for (; i < byteLength; i++) {
+    if (!IS_CONT(bytes[i])) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+// NOLINTEND
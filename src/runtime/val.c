@@ -1,8 +1,9 @@
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "hash.h"
 #include "mem.h"
+#include "num.h"
 #include "val.h"
 #include "obj.h"
 
@@ -40,37 +41,47 @@ void freeValArr(ValArr *arr) {
   arr->consts = NULL;
 }
 
-void printVal(Val val) {
+void printVal(Writer *out, Val val) {
   switch (val.type) {
     case VAL_BOOL:
-      printf(VAL_AS_BOOL(val) ? "true" : "false");
+      if (VAL_AS_BOOL(val)) {
+        WRITER_APPEND_LIT(out, "true");
+      } else {
+        WRITER_APPEND_LIT(out, "false");
+      }
       break;
 
     case VAL_NIL:
-      printf("nil");
+      WRITER_APPEND_LIT(out, "nil");
       break;
     
-    case VAL_NUM:
-      printf("%.14g", VAL_AS_NUM(val));
+    case VAL_NUM: {
+      char *into = writerReserve(out, NUM_STR_MAX);
+      out->length += numAsStr(into, VAL_AS_NUM(val));
       break;
+    }
 
     case VAL_OBJ:
-      printObj(val);
+      printObj(out, val);
       break;
 
     case VAL_EMPTY:
-      printf("()");
+      WRITER_APPEND_LIT(out, "()");
       break;
   }
 }
 
 bool valsEq(Val a, Val b) {
+  if (a.type != b.type) {
+    return false;
+  }
+
   switch (a.type) {
     case VAL_NIL:
       return true;
 
     case VAL_BOOL:
-      return VAL_AS_BOOL(a) && VAL_AS_BOOL(b);
+      return VAL_AS_BOOL(a) == VAL_AS_BOOL(b);
 
     case VAL_NUM:
       return VAL_AS_NUM(a) == VAL_AS_NUM(b);
@@ -86,15 +97,13 @@ bool valsEq(Val a, Val b) {
 }
 
 static uint32_t hashDouble(double val) {
-  union BitCast {
-    double val;
-    uint32_t ints[2];
-  };
+  // -0 and 0 are equal, so they need the same hash.
+  const double num = val == 0 ? 0 : val;
 
-  union BitCast cast;
-  cast.val = val + 1;
+  uint64_t bits;
+  memcpy(&bits, &num, sizeof (bits));
 
-  return cast.ints[0] + cast.ints[1];
+  return hashBits(bits);
 }
 
 // NOLINTBEGIN
@@ -110,7 +119,7 @@ uint32_t hashVal(Val val) {
       return hashDouble(VAL_AS_NUM(val));
 
     case VAL_OBJ:
-      return VAL_AS_STR(val)->hash;
+      return hashObj(VAL_AS_OBJ(val));
 
     case VAL_EMPTY:
       return 0;
@@ -120,77 +129,34 @@ uint32_t hashVal(Val val) {
 }
 // NOLINTEND
 
-uint32_t valStrLength(Val val) {
+void valAsStr(StrBuf *buf, Val val) {
   switch (val.type) {
     case VAL_OBJ:
-      return objStrLength(VAL_AS_OBJ(val));
+      objAsStr(buf, VAL_AS_OBJ(val));
+      break;
 
     case VAL_NIL:
-      return 3;
+      STR_BUF_APPEND_LIT(buf, "nil");
+      break;
 
     case VAL_BOOL:
-      return 4 + !VAL_AS_BOOL(val);
-
-    case VAL_NUM:
-      return (uint32_t)snprintf(NULL, 0, "%.14g", VAL_AS_NUM(val));
-
-    case VAL_EMPTY:
-      return 2;
-  }
-
-  return 0;
-}
-
-uint32_t valAsStr(char *buffer, const uint32_t size, Val val) {
-  switch (val.type) {
-    case VAL_OBJ:
-      return objAsStr(buffer, size, VAL_AS_OBJ(val));
-
-    case VAL_NIL: {
-      const uint32_t length = 3;
-
-      strncpy(buffer, "nil", length);
-      return length;
-    }
-
-    case VAL_BOOL: {
-      const bool isTrue = VAL_AS_BOOL(val);
+      if (VAL_AS_BOOL(val)) {
+        STR_BUF_APPEND_LIT(buf, "true");
+      } else {
+        STR_BUF_APPEND_LIT(buf, "false");
+      }
 
-      // we’re doing all this redundant stuff because clang-tidy doesn’t want
-      // us to use magic values.
-      // this is silly, but i also don’t want to disable the no-magic-values 
-      // check.
-      const uint32_t trueLength = 4;
-      const uint32_t falseLength = 5;
-
-      const uint32_t length = isTrue ? trueLength : falseLength;
-      
-      strncpy(buffer, isTrue ? "true" : "false", length);
-
-      return length;
-    }
+      break;
 
     case VAL_NUM: {
-      const uint32_t bufferSize = 32;
+      char *dest = strBufReserve(buf, NUM_STR_MAX);
+      buf->length += numAsStr(dest, VAL_AS_NUM(val));
 
-      const uint32_t length = (uint32_t)snprintf(
-        buffer, 
-        bufferSize, 
-        "%.14g", 
-        VAL_AS_NUM(val)
-      ); 
-
-      return length;
+      break;
     }
 
-    case VAL_EMPTY: {
-      const uint32_t length = 2;
-
-      strncpy(buffer, "()", length); 
-
-      return length;
-    }
+    case VAL_EMPTY:
+      STR_BUF_APPEND_LIT(buf, "()");
+      break;
   }
-
-  return 0;
 }
@@ -0,0 +1,90 @@
+#include <errno.h>
+#include <stdio.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "mem.h"
+#include "writer.h"
+
+void initWriter(Writer *out, int fd) {
+  out->fd = fd;
+  out->length = 0;
+  out->cap = isatty(fd) ? WRITER_TTY_CAP : WRITER_CAP;
+  out->chars = ALLOC(char, out->cap);
+}
+
+// keeps calling writev() until every byte is out, since pipes and
+// signals may cut a write short.  output that can’t be written is
+// dropped, the same way stdio would drop it.
+static void writeAll(int fd, struct iovec *iov, int count) {
+  while (count > 0) {
+    const ssize_t written = writev(fd, iov, count);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return;
+    }
+
+    size_t left = (size_t)written;
+
+    while (count > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+
+      iov++;
+      count--;
+    }
+
+    if (count > 0) {
+      iov->iov_base = (char *)iov->iov_base + left;
+      iov->iov_len -= left;
+    }
+  }
+}
+
+void writerSpill(Writer *out, const char *chars, uint32_t length) {
+  if (length < WRITER_DIRECT_MIN && length <= out->cap) {
+    writerFlush(out);
+
+    memcpy(out->chars, chars, length);
+    out->length = length;
+    return;
+  }
+
+  // stdio may still hold output of its own, such as debug traces; it
+  // was written first, so it goes first.
+  fflush(stdout);
+
+  struct iovec iov[2] = {
+    {.iov_base = out->chars, .iov_len = out->length},
+    {.iov_base = (void *)chars, .iov_len = length}
+  };
+
+  writeAll(out->fd, iov, 2);
+  out->length = 0;
+}
+
+void writerFlush(Writer *out) {
+  fflush(stdout);
+
+  if (out->length == 0) {
+    return;
+  }
+
+  struct iovec iov = {.iov_base = out->chars, .iov_len = out->length};
+
+  writeAll(out->fd, &iov, 1);
+  out->length = 0;
+}
+
+void freeWriter(Writer *out) {
+  writerFlush(out);
+
+  FREE_ARR(char, out->chars, out->cap);
+
+  out->length = 0;
+  out->cap = 0;
+  out->chars = NULL;
+}
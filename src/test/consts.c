@@ -0,0 +1,80 @@
+#include "obj.h"
+#include "test.h"
+
+// the assembler writes a string as plain only when it’s ASCII, so the
+// tests below swap the placeholder `@@@@` for the bytes they need.
+#define PLAIN_STR                                                     \
+  ".const s \"caf@@@@\"\n"                                            \
+  "push r0 s\n"                                                       \
+  "ret r0\n"
+
+static bool plainUtf8IsCounted(NeveVM *vm) {
+  // "café!", with the é written out as two bytes.
+  const Aftermath aftermath = runPatchedAsm(
+    vm,
+    PLAIN_STR,
+    "@@@@",
+    "\xC3\xA9!!"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  const ObjStr *str = VAL_AS_STR(vm->regs[0]);
+  CHECK(str->byteLength == 7);
+  CHECK(str->length == 6);
+
+  return true;
+}
+
+static bool plainStrayByteIsRejected(NeveVM *vm) {
+  // a lead byte followed by something that doesn’t continue it.
+  const Aftermath aftermath = runPatchedAsm(
+    vm,
+    PLAIN_STR,
+    "@@@@",
+    "\xC3(!!"
+  );
+
+  CHECK(aftermath == AFTERMATH_FILE_FORMAT_ERR);
+
+  return true;
+}
+
+static bool plainOverlongIsRejected(NeveVM *vm) {
+  // '/' spelled with two bytes instead of one.
+  const Aftermath aftermath = runPatchedAsm(
+    vm,
+    PLAIN_STR,
+    "@@@@",
+    "\xC0\xAF!!"
+  );
+
+  CHECK(aftermath == AFTERMATH_FILE_FORMAT_ERR);
+
+  return true;
+}
+
+static bool plainTruncatedIsRejected(NeveVM *vm) {
+  // the first two bytes of a three-byte sequence, at the very end.
+  const Aftermath aftermath = runPatchedAsm(
+    vm,
+    PLAIN_STR,
+    "@@@@",
+    "!!\xE2\x82"
+  );
+
+  CHECK(aftermath == AFTERMATH_FILE_FORMAT_ERR);
+
+  return true;
+}
+
+void constTests(void) {
+  const Test tests[] = {
+    {"consts/plain-utf8-is-counted", plainUtf8IsCounted},
+    {"consts/plain-stray-byte-is-rejected", plainStrayByteIsRejected},
+    {"consts/plain-overlong-is-rejected", plainOverlongIsRejected},
+    {"consts/plain-truncated-is-rejected", plainTruncatedIsRejected}
+  };
+
+  runTests(tests, sizeof (tests) / sizeof (tests[0]));
+}
@@ -0,0 +1,96 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "asm.h"
+#include "hash.h"
+#include "test.h"
+
+static uint32_t failures = 0;
+static int devNull = -1;
+
+// the program that ran last.  strings loaded from it may still point into
+// it, so it has to outlive the VM.
+static uint8_t *program = NULL;
+
+void testFailed(const char *file, int line, const char *cond) {
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+}
+
+void runTests(const Test *tests, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    NeveVM vm = newVM();
+    vm.out.fd = devNull;
+    resetStack(&vm);
+
+    const bool passed = tests[i].run(&vm);
+
+    freeVM(&vm);
+
+    free(program);
+    program = NULL;
+
+    printf("%-4s %s\n", passed ? "ok" : "FAIL", tests[i].name);
+    failures += !passed;
+  }
+}
+
+Aftermath runAsm(NeveVM *vm, const char *src) {
+  size_t length;
+  program = assemble("test.nvs", src, &length);
+
+  if (program == NULL) {
+    return AFTERMATH_FILE_FORMAT_ERR;
+  }
+
+  Bytecode bytecode = newBytecode(program, length);
+  return interpret("test.nvs", vm, &bytecode);
+}
+
+Aftermath runPatchedAsm(
+  NeveVM *vm,
+  const char *src,
+  const char *from,
+  const char *to
+) {
+  size_t length;
+  program = assemble("test.nvs", src, &length);
+
+  if (program == NULL) {
+    return AFTERMATH_FILE_FORMAT_ERR;
+  }
+
+  const size_t patchLength = strlen(from);
+
+  for (size_t i = 0; i + patchLength <= length; i++) {
+    if (memcmp(program + i, from, patchLength) == 0) {
+      memcpy(program + i, to, patchLength);
+      break;
+    }
+  }
+
+  Bytecode bytecode = newBytecode(program, length);
+  return interpret("test.nvs", vm, &bytecode);
+}
+
+int main(void) {
+  initHashSeed();
+  devNull = open("/dev/null", O_WRONLY);
+
+  tableTests();
+  constTests();
+  strTests();
+  utf8Tests();
+  transcodeTests();
+  numTests();
+
+  close(devNull);
+
+  if (failures != 0) {
+    printf("\n%u failed\n", failures);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "num.h"
+#include "test.h"
+
+// NOLINTBEGIN
+#define RANDOM_NUM_COUNT 20000
+#define MAX_DIGITS 17
+// NOLINTEND
+
+// whether numAsStr() writes `num` as `expected`.
+static bool writesAs(double num, const char *expected) {
+  char buffer[NUM_STR_MAX];
+  const uint32_t length = numAsStr(buffer, num);
+
+  return length == strlen(expected) && memcmp(buffer, expected, length) == 0;
+}
+
+static bool layoutMatchesPrintf(NeveVM *vm) {
+  IGNORE(vm);
+
+  // NOLINTBEGIN
+  CHECK(writesAs(0, "0"));
+  CHECK(writesAs(-0.0, "-0"));
+  CHECK(writesAs(INFINITY, "inf"));
+  CHECK(writesAs(-INFINITY, "-inf"));
+  CHECK(writesAs(NAN, "nan"));
+
+  CHECK(writesAs(1.5, "1.5"));
+  CHECK(writesAs(-100.25, "-100.25"));
+  CHECK(writesAs(123456.789, "123456.789"));
+  CHECK(writesAs(0.0001, "0.0001"));
+  CHECK(writesAs(99999999999999.0, "99999999999999"));
+
+  // the first digit too far from the point for fixed notation.
+  CHECK(writesAs(1e14, "1e+14"));
+  CHECK(writesAs(1e-5, "1e-05"));
+  CHECK(writesAs(2.5e-5, "2.5e-05"));
+  CHECK(writesAs(1e21, "1e+21"));
+  CHECK(writesAs(9007199254740992.0, "9.007199254740992e+15"));
+  // NOLINTEND
+
+  return true;
+}
+
+static bool digitsAreShortest(NeveVM *vm) {
+  IGNORE(vm);
+
+  // NOLINTBEGIN
+  CHECK(writesAs(0.1, "0.1"));
+  CHECK(writesAs(1.0 / 3, "0.3333333333333333"));
+  CHECK(writesAs(1e23, "1e+23"));
+  CHECK(writesAs(1e-7, "1e-07"));
+
+  // the smallest subnormal, the smallest normal and the largest double.
+  CHECK(writesAs(5e-324, "5e-324"));
+  CHECK(writesAs(2.2250738585072014e-308, "2.2250738585072014e-308"));
+  CHECK(writesAs(1.7976931348623157e308, "1.7976931348623157e+308"));
+  // NOLINTEND
+
+  return true;
+}
+
+// numbers Grisu3 can’t settle on its own, which go the slow way.
+static bool fallbackIsShortest(NeveVM *vm) {
+  IGNORE(vm);
+
+  // NOLINTBEGIN
+  CHECK(writesAs(48.198470861948636, "48.198470861948636"));
+  CHECK(writesAs(5.4353592560800026e22, "5.4353592560800026e+22"));
+  CHECK(writesAs(3.9942240746007113e-228, "3.994224074600711e-228"));
+  CHECK(writesAs(8.6637301720192055e51, "8.663730172019206e+51"));
+  CHECK(writesAs(2.7183163742986588e276, "2.718316374298659e+276"));
+  // NOLINTEND
+
+  return true;
+}
+
+// the significant digits in what numAsStr() wrote, without the sign,
+// point, exponent or any zeros around them.
+static uint32_t sigDigits(const char *buffer, uint32_t length, char *digits) {
+  uint32_t count = 0;
+
+  for (uint32_t i = 0; i < length && buffer[i] != 'e'; i++) {
+    const bool isLeadingZero = count == 0 && buffer[i] == '0';
+
+    if (buffer[i] >= '0' && buffer[i] <= '9' && !isLeadingZero) {
+      digits[count++] = buffer[i];
+    }
+  }
+
+  while (count > 1 && digits[count - 1] == '0') {
+    count--;
+  }
+
+  return count;
+}
+
+// what printf writes with the fewest digits that still read back, which
+// is correctly rounded and so also the closest.
+static uint32_t printfDigits(double num, char *digits) {
+  char buffer[NUM_STR_MAX];
+
+  for (int precision = 1; precision <= MAX_DIGITS; precision++) {
+    snprintf(buffer, sizeof (buffer), "%.*e", precision - 1, num);
+
+    if (strtod(buffer, NULL) == num) {
+      break;
+    }
+  }
+
+  return sigDigits(buffer, (uint32_t)strlen(buffer), digits);
+}
+
+static bool randomNumsAreShortest(NeveVM *vm) {
+  IGNORE(vm);
+
+  uint64_t bits = 1;
+
+  for (uint32_t i = 0; i < RANDOM_NUM_COUNT; i++) {
+    // xorshift64, over every bit pattern.
+    // NOLINTBEGIN
+    bits ^= bits << 13;
+    bits ^= bits >> 7;
+    bits ^= bits << 17;
+    // NOLINTEND
+
+    double num;
+    memcpy(&num, &bits, sizeof (num));
+
+    if (!isfinite(num)) {
+      continue;
+    }
+
+    char buffer[NUM_STR_MAX + 1];
+    const uint32_t length = numAsStr(buffer, num);
+
+    CHECK(length < NUM_STR_MAX);
+    buffer[length] = '\0';
+
+    // it reads back as the same double, sign and all.
+    const double readBack = strtod(buffer, NULL);
+    CHECK(memcmp(&readBack, &num, sizeof (num)) == 0);
+
+    char digits[NUM_STR_MAX];
+    char expected[NUM_STR_MAX];
+
+    const uint32_t digitCount = sigDigits(buffer, length, digits);
+    const uint32_t expectedCount = printfDigits(num, expected);
+
+    CHECK(digitCount == expectedCount);
+    CHECK(memcmp(digits, expected, digitCount) == 0);
+  }
+
+  return true;
+}
+
+void numTests(void) {
+  const Test tests[] = {
+    {"nums/layout-matches-printf", layoutMatchesPrintf},
+    {"nums/digits-are-shortest", digitsAreShortest},
+    {"nums/fallback-is-shortest", fallbackIsShortest},
+    {"nums/random-nums-are-shortest", randomNumsAreShortest}
+  };
+
+  runTests(tests, sizeof (tests) / sizeof (tests[0]));
+}
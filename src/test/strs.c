@@ -0,0 +1,781 @@
+#include <stdio.h>
+
+#include "mem.h"
+#include "obj.h"
+#include "strbuf.h"
+#include "strindex.h"
+#include "test.h"
+
+#define REG_STR(vm, reg) VAL_AS_STR((vm)->regs[reg])
+
+// NOLINTBEGIN
+// long enough for breadcrumbs, and not a multiple of STR_INDEX_STEP.
+#define LONG_LENGTH  1000
+#define SHORT_LENGTH 100
+
+// enough one-at-a-time appends for a rope deeper than copyStr() keeps
+// track of without allocating.
+#define APPEND_COUNT 300
+#define PIECE_COUNT  3
+// NOLINTEND
+
+// short enough that it takes a few of them to make a rope, and of
+// different lengths, so that misplaced bytes show.
+static const char *const pieces[PIECE_COUNT] = {"abc", "defg", "hi"};
+
+// code points one to four bytes wide, in an order that puts a different
+// mix of widths between each pair of breadcrumbs.
+// NOLINTBEGIN
+static uint32_t codePointAt(uint32_t i) {
+  static const uint32_t widths[] = {'a', 0xE9, 0x4E2D, 0x1F600};
+  return widths[(i * 7 + i / 5) % 4];
+}
+
+static uint32_t encodeUtf8(uint32_t codePoint, char *out) {
+  if (codePoint < 0x80) {
+    out[0] = (char)codePoint;
+    return 1;
+  }
+
+  if (codePoint < 0x800) {
+    out[0] = (char)(0xC0 | (codePoint >> 6));
+    out[1] = (char)(0x80 | (codePoint & 0x3F));
+    return 2;
+  }
+
+  if (codePoint < 0x10000) {
+    out[0] = (char)(0xE0 | (codePoint >> 12));
+    out[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (codePoint & 0x3F));
+    return 3;
+  }
+
+  out[0] = (char)(0xF0 | (codePoint >> 18));
+  out[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (codePoint & 0x3F));
+  return 4;
+}
+// NOLINTEND
+
+// a UTF-8 string of `length` code points, mixed widths unless `isAscii`.
+// `offsets`, if given, gets where each one starts, and one more entry for
+// the byte length.
+static ObjStr *makeStr(
+  NeveVM *vm,
+  uint32_t length,
+  bool isAscii,
+  uint32_t *offsets
+) {
+  char *chars = ALLOC(char, (size_t)length * 4 + 1);
+  uint32_t byteLength = 0;
+
+  for (uint32_t i = 0; i < length; i++) {
+    if (offsets != NULL) {
+      offsets[i] = byteLength;
+    }
+
+    byteLength += encodeUtf8(
+      isAscii ? 'a' + i % 26 : codePointAt(i),
+      &chars[byteLength]
+    );
+  }
+
+  if (offsets != NULL) {
+    offsets[length] = byteLength;
+  }
+
+  // allocStr() frees exactly byteLength + 1 bytes, so give back the rest.
+  chars = GROW_ARR(char, chars, (size_t)length * 4 + 1, byteLength + 1);
+  chars[byteLength] = '\0';
+
+  return allocStr(
+    vm,
+    true,
+    false,
+    STR_UTF8,
+    chars,
+    length,
+    byteLength,
+    STR_UNHASHED
+  );
+}
+
+static bool indexMatchesCounting(NeveVM *vm) {
+  uint32_t offsets[LONG_LENGTH + 1];
+  ObjStr *str = makeStr(vm, LONG_LENGTH, false, offsets);
+
+  for (uint32_t i = 0; i <= LONG_LENGTH; i++) {
+    CHECK(strOffset(str, i) == offsets[i]);
+  }
+
+  // past the end is the byte length, whatever the index.
+  CHECK(strOffset(str, LONG_LENGTH + STR_INDEX_STEP) == str->byteLength);
+
+  return true;
+}
+
+static bool crumbsAreBuiltOnFirstLookup(NeveVM *vm) {
+  uint32_t offsets[LONG_LENGTH + 1];
+  ObjStr *str = makeStr(vm, LONG_LENGTH, false, offsets);
+
+  CHECK(str->crumbs == NULL);
+
+  // the first lookup is the last code point, so every breadcrumb before it
+  // has to be right for this to be.
+  CHECK(strOffset(str, LONG_LENGTH - 1) == offsets[LONG_LENGTH - 1]);
+  CHECK(str->crumbs != NULL);
+
+  const uint32_t *crumbs = str->crumbs;
+
+  for (uint32_t k = 0; k < STR_CRUMB_COUNT(LONG_LENGTH); k++) {
+    const uint32_t at = k * STR_INDEX_STEP;
+
+    CHECK(crumbs[k] == offsets[at]);
+    CHECK(at == 0 || strOffset(str, at - 1) == offsets[at - 1]);
+    CHECK(strOffset(str, at) == offsets[at]);
+    CHECK(strOffset(str, at + 1) == offsets[at + 1]);
+  }
+
+  // later lookups use the breadcrumbs that are already there.
+  CHECK(str->crumbs == crumbs);
+
+  return true;
+}
+
+static bool shortStrIsCounted(NeveVM *vm) {
+  uint32_t offsets[SHORT_LENGTH + 1];
+  ObjStr *str = makeStr(vm, SHORT_LENGTH, false, offsets);
+
+  for (uint32_t i = 0; i <= SHORT_LENGTH; i++) {
+    CHECK(strOffset(str, i) == offsets[i]);
+  }
+
+  CHECK(str->crumbs == NULL);
+
+  return true;
+}
+
+static bool asciiStrIsNotIndexed(NeveVM *vm) {
+  ObjStr *str = makeStr(vm, LONG_LENGTH * 4, true, NULL);
+
+  CHECK(strOffset(str, LONG_LENGTH * 3 + 1) == LONG_LENGTH * 3 + 1);
+  CHECK(str->crumbs == NULL);
+
+  return true;
+}
+
+static bool ropeIsIndexedOnceFlat(NeveVM *vm) {
+  uint32_t offsets[LONG_LENGTH + 1];
+  ObjStr *left = makeStr(vm, LONG_LENGTH, false, offsets);
+  ObjStr *right = makeStr(vm, LONG_LENGTH, false, NULL);
+  ObjStr *rope = allocRope(vm, left, right);
+
+  // both halves are the same string, so the second starts where the first
+  // one’s byte length leaves off.
+  for (uint32_t i = 0; i < LONG_LENGTH; i += STR_INDEX_STEP - 1) {
+    CHECK(strOffset(rope, i) == offsets[i]);
+    CHECK(strOffset(rope, LONG_LENGTH + i) == left->byteLength + offsets[i]);
+  }
+
+  CHECK(rope->crumbs != NULL);
+  CHECK(left->crumbs == NULL);
+
+  return true;
+}
+
+static bool sliceGetsItsOwnCrumbs(NeveVM *vm) {
+  uint32_t offsets[LONG_LENGTH + 1];
+  ObjStr *str = makeStr(vm, LONG_LENGTH, false, offsets);
+
+  // starting mid-way between two breadcrumbs of the parent.
+  const uint32_t start = STR_INDEX_STEP / 2 + 1;
+  ObjStr *slice = sliceStr(vm, str, start, LONG_LENGTH);
+
+  for (uint32_t i = 0; i < slice->length; i++) {
+    CHECK(strOffset(slice, i) == offsets[start + i] - offsets[start]);
+  }
+
+  CHECK(slice->crumbs != NULL);
+  CHECK(slice->crumbs[1] == offsets[start + STR_INDEX_STEP] - offsets[start]);
+
+  return true;
+}
+
+// `count` copies of `piece`.
+static void appendRepeated(StrBuf *buf, const char *piece, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    strBufAppend(buf, piece, (uint32_t)strlen(piece));
+  }
+}
+
+// runs the assembly in `src`, which is freed afterwards.
+static Aftermath runSrc(NeveVM *vm, StrBuf *src) {
+  strBufAppend(src, "", 1);
+
+  const Aftermath aftermath = runAsm(vm, src->chars);
+  freeStrBuf(src);
+
+  return aftermath;
+}
+
+static bool ropeStartsAtMinSize(NeveVM *vm) {
+  StrBuf src;
+  initStrBuf(&src, 0);
+
+  STR_BUF_APPEND_LIT(&src, ".const a \"");
+  appendRepeated(&src, "x", MIN_ROPE_SIZE / 2);
+  STR_BUF_APPEND_LIT(&src, "\"\n.const b \"");
+  appendRepeated(&src, "x", MIN_ROPE_SIZE / 2 - 1);
+  STR_BUF_APPEND_LIT(
+    &src,
+    "\"\n"
+    "push r0 a\n"
+    "push r1 b\n"
+    "concat r2 r0 r1\n"
+    "concat r3 r0 r0\n"
+    "ret r0\n"
+  );
+
+  CHECK(runSrc(vm, &src) == AFTERMATH_OK);
+
+  // one byte short is copied right away.
+  ObjStr *flat = REG_STR(vm, 2);
+  CHECK(flat->byteLength == MIN_ROPE_SIZE - 1);
+  CHECK(!IS_STR_ROPE(flat));
+
+  ObjStr *rope = REG_STR(vm, 3);
+  CHECK(rope->byteLength == MIN_ROPE_SIZE);
+  CHECK(rope->length == MIN_ROPE_SIZE);
+  CHECK(IS_STR_ROPE(rope) && !IS_STR_FLAT(rope));
+
+  flattenStr(rope);
+
+  CHECK(IS_STR_FLAT(rope) && IS_STR_OWNING(rope));
+  CHECK(((ObjRope *)rope)->left == NULL);
+  CHECK(rope->chars[MIN_ROPE_SIZE] == '\0');
+
+  for (uint32_t i = 0; i < MIN_ROPE_SIZE; i++) {
+    CHECK(rope->chars[i] == 'x');
+  }
+
+  return true;
+}
+
+// appends (or prepends) the pieces to r0 in turn, APPEND_COUNT times, and
+// checks that flattening it gives what `expected` was built up to.
+static bool checkRopeOrder(NeveVM *vm, bool isPrepend) {
+  StrBuf src;
+  initStrBuf(&src, 0);
+
+  StrBuf expected;
+  initStrBuf(&expected, 0);
+
+  for (uint32_t i = 0; i < PIECE_COUNT; i++) {
+    char line[32];
+    snprintf(line, sizeof (line), ".const \"%s\"\n", pieces[i]);
+    strBufAppend(&src, line, (uint32_t)strlen(line));
+  }
+
+  STR_BUF_APPEND_LIT(
+    &src,
+    "push r1 #0\n"
+    "push r2 #1\n"
+    "push r3 #2\n"
+    "push r0 #0\n"
+  );
+
+  STR_BUF_APPEND_LIT(&expected, "abc");
+
+  for (uint32_t i = 0; i < APPEND_COUNT; i++) {
+    const uint32_t piece = i % PIECE_COUNT;
+    const uint32_t pieceLength = (uint32_t)strlen(pieces[piece]);
+
+    char line[32];
+    snprintf(
+      line,
+      sizeof (line),
+      isPrepend ? "concat r0 r%u r0\n" : "concat r0 r0 r%u\n",
+      piece + 1
+    );
+
+    strBufAppend(&src, line, (uint32_t)strlen(line));
+
+    if (isPrepend) {
+      strBufReserve(&expected, pieceLength);
+      memmove(expected.chars + pieceLength, expected.chars, expected.length);
+      memcpy(expected.chars, pieces[piece], pieceLength);
+      expected.length += pieceLength;
+    } else {
+      strBufAppend(&expected, pieces[piece], pieceLength);
+    }
+  }
+
+  STR_BUF_APPEND_LIT(&src, "ret r1\n");
+
+  const Aftermath aftermath = runSrc(vm, &src);
+  ObjStr *rope = REG_STR(vm, 0);
+
+  const bool isRope = IS_STR_ROPE(rope) && !IS_STR_FLAT(rope);
+
+  if (aftermath == AFTERMATH_OK) {
+    flattenStr(rope);
+  }
+
+  const bool isSame = (
+    aftermath == AFTERMATH_OK &&
+    rope->byteLength == expected.length &&
+    memcmp(rope->chars, expected.chars, expected.length) == 0
+  );
+
+  freeStrBuf(&expected);
+
+  CHECK(aftermath == AFTERMATH_OK);
+  CHECK(isRope);
+  CHECK(isSame);
+
+  return true;
+}
+
+static bool appendedRopeFlattensInOrder(NeveVM *vm) {
+  return checkRopeOrder(vm, false);
+}
+
+static bool prependedRopeFlattensInOrder(NeveVM *vm) {
+  return checkRopeOrder(vm, true);
+}
+
+// a rope can be both sides of another, and be flattened before or after
+// it.
+static bool sharedSidesFlatten(NeveVM *vm) {
+  StrBuf src;
+  initStrBuf(&src, 0);
+
+  STR_BUF_APPEND_LIT(&src, ".const a \"");
+  appendRepeated(&src, "ab", MIN_ROPE_SIZE / 2);
+  STR_BUF_APPEND_LIT(
+    &src,
+    "\"\n"
+    ".const c \"c\"\n"
+    "push r0 a\n"
+    "push r1 c\n"
+    "concat r2 r0 r1\n"
+    "concat r3 r2 r2\n"
+    "concat r4 r3 r2\n"
+    "ret r1\n"
+  );
+
+  CHECK(runSrc(vm, &src) == AFTERMATH_OK);
+
+  ObjStr *twice = REG_STR(vm, 3);
+  ObjStr *thrice = REG_STR(vm, 4);
+
+  flattenStr(thrice);
+
+  const uint32_t partLength = MIN_ROPE_SIZE + 1;
+  CHECK(thrice->byteLength == 3 * partLength);
+
+  for (uint32_t i = 0; i < thrice->byteLength; i++) {
+    const uint32_t at = i % partLength;
+    CHECK(thrice->chars[i] == (at == MIN_ROPE_SIZE ? 'c' : "ab"[at % 2]));
+  }
+
+  // flattening the outer rope left the inner one alone.
+  CHECK(!IS_STR_FLAT(twice));
+
+  flattenStr(twice);
+  CHECK(memcmp(twice->chars, thrice->chars, twice->byteLength) == 0);
+
+  return true;
+}
+
+// the right side is transcoded to the left side’s encoding before the
+// rope is made.
+static bool ropeKeepsLeftEncoding(NeveVM *vm) {
+  StrBuf src;
+  initStrBuf(&src, 0);
+
+  STR_BUF_APPEND_LIT(&src, ".const a u16\"");
+  appendRepeated(&src, "x", MIN_ROPE_SIZE);
+  STR_BUF_APPEND_LIT(&src, "\"\n.const b \"");
+  appendRepeated(&src, "\\u{E9}", MIN_ROPE_SIZE / 2);
+  STR_BUF_APPEND_LIT(&src, "\"\n.const ab u16\"");
+  appendRepeated(&src, "x", MIN_ROPE_SIZE);
+  appendRepeated(&src, "\\u{E9}", MIN_ROPE_SIZE / 2);
+  STR_BUF_APPEND_LIT(
+    &src,
+    "\"\n"
+    "push r0 a\n"
+    "push r1 b\n"
+    "push r2 ab\n"
+    "uconcat r3 r0 r1\n"
+    "eq r4 r3 r2\n"
+    "ret r4\n"
+  );
+
+  CHECK(runSrc(vm, &src) == AFTERMATH_OK);
+
+  ObjStr *rope = REG_STR(vm, 3);
+  CHECK(IS_STR_ROPE(rope));
+  CHECK(STR_ENCODING(rope) == STR_UTF16);
+  CHECK(rope->length == MIN_ROPE_SIZE + MIN_ROPE_SIZE / 2);
+  CHECK(rope->byteLength == 2 * rope->length);
+
+  CHECK(IS_VAL_BOOL(vm->regs[4]) && VAL_AS_BOOL(vm->regs[4]));
+
+  return true;
+}
+
+// checks that `val` is a UTF-8 string holding exactly `chars`, which is
+// `length` code points long.
+static bool isUtf8Str(Val val, const char *chars, uint32_t length) {
+  if (!IS_VAL_STR(val)) {
+    return false;
+  }
+
+  const ObjStr *str = VAL_AS_STR(val);
+  const uint32_t byteLength = (uint32_t)strlen(chars);
+
+  return (
+    STR_ENCODING(str) == STR_UTF8 &&
+    str->length == length &&
+    str->byteLength == byteLength &&
+    memcmp(str->chars, chars, byteLength) == 0
+  );
+}
+
+static bool concatnShowsNonStrs(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const e \"\\u{E9}\"\n"
+    ".const n 1.5\n"
+    ".const u u16\"\\u{FC}\"\n"
+    "push r1 e\n"
+    "push r2 n\n"
+    "push r3 u\n"
+    "true r4\n"
+    "nil r5\n"
+    "concatn r0 r1 5\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+  CHECK(isUtf8Str(vm->regs[0], "\xC3\xA9" "1.5" "\xC3\xBC" "truenil", 12));
+
+  return true;
+}
+
+static bool concatnReachesLastReg(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const s \"ab\"\n"
+    "push r250 s\n"
+    "push r251 s\n"
+    "push r252 s\n"
+    "push r253 s\n"
+    "push r254 s\n"
+    "push r255 s\n"
+    "concatn r0 r250 6\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+  CHECK(isUtf8Str(vm->regs[0], "abababababab", 12));
+
+  return true;
+}
+
+static bool concatnPastLastRegFails(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    "concatn r0 r250 7\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_RUNTIME_ERR);
+
+  return true;
+}
+
+static bool interpFillsPlaceholders(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const t \"x={} y={}{ }\\u{E9}{}\"\n"
+    ".const e \"\\u{E9}\"\n"
+    ".const two 2\n"
+    "push r1 two\n"
+    "push r2 e\n"
+    "false r3\n"
+    "interp r0 t r1\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  // "{ }" isn’t a placeholder.
+  CHECK(isUtf8Str(vm->regs[0], "x=2 y=\xC3\xA9{ }\xC3\xA9" "false", 16));
+
+  return true;
+}
+
+// a template that isn’t UTF-8 is transcoded before it’s filled in.
+static bool interpTranscodesTemplate(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const t u16\"\\u{FC}{}\"\n"
+    ".const one 1\n"
+    "push r1 one\n"
+    "interp r0 t r1\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+  CHECK(isUtf8Str(vm->regs[0], "\xC3\xBC" "1", 2));
+
+  return true;
+}
+
+static bool interpReachesLastReg(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const t \"<{}>\"\n"
+    "one r255\n"
+    "interp r0 t r255\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+  CHECK(isUtf8Str(vm->regs[0], "<1>", 3));
+
+  return true;
+}
+
+static bool interpPastLastRegFails(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const t \"{}{}\"\n"
+    "interp r0 t r255\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_RUNTIME_ERR);
+
+  return true;
+}
+
+// "héllo wörld", eleven code points, and the indices the slice and charat
+// tests need.  r6 is NaN.
+#define INDEX_CONSTS                                                  \
+  ".const s \"h\\u{E9}llo w\\u{F6}rld\"\n"                            \
+  ".const neg -3\n"                                                   \
+  ".const big 100\n"                                                  \
+  ".const two 2\n"                                                    \
+  ".const five 5\n"                                                   \
+  ".const half 1.5\n"                                                 \
+  ".const eleven 11\n"                                                \
+  "push r1 s\n"                                                       \
+  "push r2 neg\n"                                                     \
+  "push r3 big\n"                                                     \
+  "push r4 two\n"                                                     \
+  "push r5 five\n"                                                    \
+  "zero r6\n"                                                         \
+  "div r6 r6 r6\n"                                                    \
+  "push r7 half\n"                                                    \
+  "push r8 eleven\n"
+
+static bool sliceClampsIndices(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    INDEX_CONSTS
+    "slice r10 r1 r4 r5\n"
+    "slice r11 r1 r2 r4\n"
+    "slice r12 r1 r5 r3\n"
+    "slice r13 r1 r5 r4\n"
+    "slice r14 r1 r6 r4\n"
+    "slice r15 r1 r3 r3\n"
+    "slice r16 r1 r7 r4\n"
+    "slice r17 r1 r2 r3\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  CHECK(isUtf8Str(vm->regs[10], "llo", 3));
+
+  // a negative or NaN start is 0, and an end past the string is its end.
+  CHECK(isUtf8Str(vm->regs[11], "h\xC3\xA9", 2));
+  CHECK(isUtf8Str(vm->regs[12], " w\xC3\xB6rld", 6));
+  CHECK(isUtf8Str(vm->regs[14], "h\xC3\xA9", 2));
+
+  // an end before the start, or a start past the end, is empty.
+  CHECK(isUtf8Str(vm->regs[13], "", 0));
+  CHECK(isUtf8Str(vm->regs[15], "", 0));
+
+  // fractions are dropped.
+  CHECK(isUtf8Str(vm->regs[16], "\xC3\xA9", 1));
+
+  // all of it is the string itself.
+  CHECK(REG_STR(vm, 17) == REG_STR(vm, 1));
+
+  return true;
+}
+
+static bool sliceOfSliceSharesParent(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    INDEX_CONSTS
+    "one r9\n"
+    "slice r10 r1 r9 r3\n"
+    "slice r11 r10 r4 r5\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  ObjStr *str = REG_STR(vm, 1);
+  ObjStr *outer = REG_STR(vm, 10);
+  ObjStr *inner = REG_STR(vm, 11);
+
+  CHECK(isUtf8Str(vm->regs[11], "lo ", 3));
+  CHECK(IS_STR_SLICE(outer) && IS_STR_SLICE(inner));
+
+  // both borrow from the same string, which isn’t a slice.
+  CHECK(((ObjSlice *)outer)->parent == str);
+  CHECK(((ObjSlice *)inner)->parent == str);
+  CHECK(inner->chars == str->chars + strlen("h\xC3\xA9l"));
+
+  return true;
+}
+
+// a slice that has bytes of its own is a parent like any other string.
+static bool owningSliceIsParent(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const s \"abcdefghijklmnopqrstuvwxyz0123456789\"\n"
+    ".const two 2\n"
+    ".const five 5\n"
+    "push r1 s\n"
+    "push r2 two\n"
+    "push r3 five\n"
+    "slice r10 r1 r2 r3\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  // "cde" is more than MAX_SLICE_WASTE times smaller than its parent.
+  ObjStr *owning = settleStr(vm, REG_STR(vm, 10), false);
+
+  CHECK(IS_STR_SLICE(owning) && IS_STR_OWNING(owning));
+  CHECK(owning->chars != REG_STR(vm, 1)->chars + 2);
+
+  ObjStr *slice = sliceStr(vm, owning, 1, 3);
+
+  CHECK(((ObjSlice *)slice)->parent == owning);
+  CHECK(slice->chars == owning->chars + 1);
+  CHECK(isUtf8Str(OBJ_VAL(slice), "de", 2));
+
+  return true;
+}
+
+static bool charatOutOfRangeIsNil(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    INDEX_CONSTS
+    "minusone r9\n"
+    "charat r10 r1 r9\n"
+    "charat r11 r1 r8\n"
+    "charat r12 r1 r3\n"
+    "charat r13 r1 r6\n"
+    "charat r14 r1 r2\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  for (uint8_t reg = 10; reg <= 14; reg++) {
+    CHECK(IS_VAL_NIL(vm->regs[reg]));
+  }
+
+  return true;
+}
+
+static bool charatInRange(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    INDEX_CONSTS
+    ".const last 10\n"
+    "push r9 last\n"
+    "zero r0\n"
+    "charat r10 r1 r0\n"
+    "charat r11 r1 r7\n"
+    "charat r12 r1 r9\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  CHECK(isUtf8Str(vm->regs[10], "h", 1));
+  CHECK(isUtf8Str(vm->regs[11], "\xC3\xA9", 1));
+  CHECK(isUtf8Str(vm->regs[12], "d", 1));
+
+  return true;
+}
+
+// a code point outside the BMP is one code point, but two UTF-16 units.
+static bool charatKeepsEncoding(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    ".const s u16\"a\\u{1F600}b\"\n"
+    ".const two 2\n"
+    "push r1 s\n"
+    "one r2\n"
+    "push r3 two\n"
+    "charat r10 r1 r2\n"
+    "charat r11 r1 r3\n"
+    "ret r0\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  const ObjStr *emoji = REG_STR(vm, 10);
+  CHECK(STR_ENCODING(emoji) == STR_UTF16);
+  CHECK(emoji->length == 1 && emoji->byteLength == 4);
+
+  const ObjStr *b = REG_STR(vm, 11);
+  CHECK(b->length == 1 && b->byteLength == 2);
+  CHECK(b->chars[0] == 'b' && b->chars[1] == 0);
+
+  return true;
+}
+
+void strTests(void) {
+  const Test tests[] = {
+    {"strs/index-matches-counting", indexMatchesCounting},
+    {"strs/crumbs-are-built-on-first-lookup", crumbsAreBuiltOnFirstLookup},
+    {"strs/short-str-is-counted", shortStrIsCounted},
+    {"strs/ascii-str-is-not-indexed", asciiStrIsNotIndexed},
+    {"strs/rope-is-indexed-once-flat", ropeIsIndexedOnceFlat},
+    {"strs/slice-gets-its-own-crumbs", sliceGetsItsOwnCrumbs},
+    {"strs/rope-starts-at-min-size", ropeStartsAtMinSize},
+    {"strs/appended-rope-flattens-in-order", appendedRopeFlattensInOrder},
+    {"strs/prepended-rope-flattens-in-order", prependedRopeFlattensInOrder},
+    {"strs/shared-sides-flatten", sharedSidesFlatten},
+    {"strs/rope-keeps-left-encoding", ropeKeepsLeftEncoding},
+    {"strs/concatn-shows-non-strs", concatnShowsNonStrs},
+    {"strs/concatn-reaches-last-reg", concatnReachesLastReg},
+    {"strs/concatn-past-last-reg-fails", concatnPastLastRegFails},
+    {"strs/interp-fills-placeholders", interpFillsPlaceholders},
+    {"strs/interp-transcodes-template", interpTranscodesTemplate},
+    {"strs/interp-reaches-last-reg", interpReachesLastReg},
+    {"strs/interp-past-last-reg-fails", interpPastLastRegFails},
+    {"strs/slice-clamps-indices", sliceClampsIndices},
+    {"strs/slice-of-slice-shares-parent", sliceOfSliceSharesParent},
+    {"strs/owning-slice-is-parent", owningSliceIsParent},
+    {"strs/charat-out-of-range-is-nil", charatOutOfRangeIsNil},
+    {"strs/charat-in-range", charatInRange},
+    {"strs/charat-keeps-encoding", charatKeepsEncoding}
+  };
+
+  runTests(tests, sizeof (tests) / sizeof (tests[0]));
+}
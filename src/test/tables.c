@@ -0,0 +1,402 @@
+#include "obj.h"
+#include "table.h"
+#include "test.h"
+
+#define REG_TABLE(vm, reg) VAL_AS_TABLE((vm)->regs[reg])
+
+// a constant table with another one inside it.
+#define NESTED_CONSTS                                                 \
+  ".const t {\"sub\": {\"x\": 1}}\n"                                  \
+  ".const sub \"sub\"\n"                                              \
+  ".const x \"x\"\n"                                                  \
+  ".const two 2\n"
+
+static bool readLeavesConstShared(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    NESTED_CONSTS
+    "push r0 t\n"
+    "push r1 sub\n"
+    "tableget r2 r0 r1\n"
+    "tableget r3 r0 r1\n"
+    "ret r2\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  // neither the outer table nor the inner one got copied.
+  CHECK(IS_TABLE_SHARED(REG_TABLE(vm, 0)));
+  CHECK(IS_TABLE_SHARED(REG_TABLE(vm, 2)));
+
+  // and both reads got the same table.
+  CHECK(REG_TABLE(vm, 2) == REG_TABLE(vm, 3));
+  CHECK(REG_TABLE(vm, 2)->share->parent == REG_TABLE(vm, 0));
+
+  return true;
+}
+
+static bool nestedWriteCopiesOnce(NeveVM *vm) {
+  const Aftermath aftermath = runAsm(
+    vm,
+    NESTED_CONSTS
+    "push r0 t\n"
+    "push r1 sub\n"
+    "push r7 x\n"
+    "push r8 two\n"
+    "tableget r2 r0 r1\n"
+    "tableset r2 r7 r8\n"
+    "tableget r3 r0 r1\n"
+    "push r4 t\n"
+    "tableget r5 r4 r1\n"
+    "tableget r6 r5 r7\n"
+    "ret r6\n"
+  );
+
+  CHECK(aftermath == AFTERMATH_OK);
+
+  // writing to the inner table gave both it and the outer one a copy, 
+  // with the inner one stored in the outer one.
+  CHECK(!IS_TABLE_SHARED(REG_TABLE(vm, 0)));
+  CHECK(!IS_TABLE_SHARED(REG_TABLE(vm, 2)));
+  CHECK(REG_TABLE(vm, 3) == REG_TABLE(vm, 2));
+
+  // the constant itself never changed.
+  CHECK(IS_TABLE_SHARED(REG_TABLE(vm, 4)));
+  CHECK(VAL_AS_NUM(vm->regs[6]) == 1);
+
+  return true;
+}
+
+// NOLINTBEGIN
+#define INT_KEY_COUNT 100
+#define SHRINK_KEY_COUNT 256
+#define HASHED_KEY_COUNT 1000
+// NOLINTEND
+
+// sets keys `from`, `from + step` and so on, `count` of them, each to
+// its own key.
+static void setKeys(Table *table, double from, double step, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    const Val key = NUM_VAL(from + step * i);
+    tableSet(table, key, key);
+  }
+}
+
+// whether every key set by setKeys() is still there.
+static bool hasKeys(Table *table, double from, double step, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    const Val key = NUM_VAL(from + step * i);
+    const Val val = tableGet(table, key);
+
+    if (!IS_VAL_NUM(val) || VAL_AS_NUM(val) != VAL_AS_NUM(key)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool intKeysMoveToArr(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  setKeys(&table, 0, 1, INT_KEY_COUNT);
+
+  // keys past the end of the array part wait in the hash part until it
+  // next resizes.
+  CHECK(table.count == INT_KEY_COUNT);
+  CHECK(table.arrCount > INT_KEY_COUNT / 2);
+  CHECK(hasKeys(&table, 0, 1, INT_KEY_COUNT));
+
+  tableCompact(&table);
+
+  // the smallest power of two they fill more than half of.
+  // NOLINTNEXTLINE
+  CHECK(table.arrCap == 128 && table.arrCount == INT_KEY_COUNT);
+  CHECK(table.next == 0);
+  CHECK(hasKeys(&table, 0, 1, INT_KEY_COUNT));
+
+  freeTable(&table);
+  return true;
+}
+
+static bool sparseIntKeysStayHashed(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  // NOLINTNEXTLINE
+  setKeys(&table, 0, 1000, INT_KEY_COUNT);
+  tableCompact(&table);
+
+  // only 0 is dense enough for an array part.
+  CHECK(table.arrCap == 1 && table.arrCount == 1);
+  CHECK(table.next == INT_KEY_COUNT - 1);
+
+  // NOLINTNEXTLINE
+  CHECK(hasKeys(&table, 0, 1000, INT_KEY_COUNT));
+
+  freeTable(&table);
+  return true;
+}
+
+static bool nonIndexKeysStayHashed(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  setKeys(&table, 0, 1, INT_KEY_COUNT);
+
+  const Val keys[] = {NUM_VAL(-1), NUM_VAL(1.5), NUM_VAL(-0.5)};
+  const size_t keyCount = sizeof (keys) / sizeof (keys[0]);
+
+  for (size_t i = 0; i < keyCount; i++) {
+    tableSet(&table, keys[i], keys[i]);
+  }
+
+  tableCompact(&table);
+
+  CHECK(table.arrCount == INT_KEY_COUNT);
+  CHECK(table.count - table.arrCount == keyCount);
+
+  for (size_t i = 0; i < keyCount; i++) {
+    CHECK(tableArrSlot(&table, keys[i]) == NULL);
+    CHECK(VAL_AS_NUM(tableGet(&table, keys[i])) == VAL_AS_NUM(keys[i]));
+  }
+
+  freeTable(&table);
+  return true;
+}
+
+static bool arrIteratesFirstInOrder(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  const double keys[] = {0.5, 3, 2, 1, 0};
+  const double inOrder[] = {0, 1, 2, 3, 0.5};
+  const uint32_t keyCount = sizeof (keys) / sizeof (keys[0]);
+
+  for (uint32_t i = 0; i < keyCount; i++) {
+    tableSet(&table, NUM_VAL(keys[i]), NIL_VAL);
+  }
+
+  tableCompact(&table);
+  CHECK(table.arrCount == keyCount - 1);
+
+  uint32_t i = 0;
+  Val key;
+  Val val;
+
+  for (uint32_t n = 0; n < keyCount; n++) {
+    CHECK(tableNext(&table, &i, &key, &val));
+    CHECK(VAL_AS_NUM(key) == inOrder[n]);
+  }
+
+  CHECK(!tableNext(&table, &i, &key, &val));
+
+  freeTable(&table);
+  return true;
+}
+
+static bool arrShrinksUnderEighth(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  setKeys(&table, 0, 1, SHRINK_KEY_COUNT);
+  tableCompact(&table);
+  CHECK(table.arrCap == SHRINK_KEY_COUNT);
+
+  // from the top down, so that what’s left stays dense.
+  uint32_t count = SHRINK_KEY_COUNT;
+
+  while (count > SHRINK_KEY_COUNT / 8) {
+    tableDel(&table, NUM_VAL(--count));
+  }
+
+  CHECK(table.arrCap == SHRINK_KEY_COUNT);
+
+  tableDel(&table, NUM_VAL(--count));
+
+  CHECK(table.arrCap == SHRINK_KEY_COUNT / 8);
+  CHECK(table.arrCount == count && table.next == 0);
+  CHECK(hasKeys(&table, 0, 1, count));
+
+  freeTable(&table);
+  return true;
+}
+
+// what’s left of a sparse array part goes back to the hash part.
+static bool sparseArrMovesToHash(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  setKeys(&table, 0, 1, SHRINK_KEY_COUNT);
+  tableCompact(&table);
+
+  // from the bottom up, leaving the top eighth and one key less.
+  const uint32_t left = SHRINK_KEY_COUNT / 8 - 1;
+
+  for (uint32_t i = 0; i < SHRINK_KEY_COUNT - left; i++) {
+    tableDel(&table, NUM_VAL(i));
+  }
+
+  CHECK(table.arrCap == 0 && table.arrCount == 0);
+  CHECK(table.count == left && table.next == left);
+  CHECK(hasKeys(&table, SHRINK_KEY_COUNT - left, 1, left));
+
+  freeTable(&table);
+  return true;
+}
+
+static bool hashShrinksUnderEighth(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  // NOLINTNEXTLINE
+  setKeys(&table, 0.5, 1, HASHED_KEY_COUNT);
+  tableCompact(&table);
+
+  const uint32_t cap = table.cap;
+  uint32_t count = HASHED_KEY_COUNT;
+
+  while (count > cap / 8) {
+    // NOLINTNEXTLINE
+    tableDel(&table, NUM_VAL(--count + 0.5));
+  }
+
+  // the holes are still fewer than three times the live entries.
+  CHECK(table.cap == cap && table.next == HASHED_KEY_COUNT);
+
+  // NOLINTNEXTLINE
+  tableDel(&table, NUM_VAL(--count + 0.5));
+
+  CHECK(table.cap < cap);
+  CHECK(table.next == count && table.count == count);
+
+  // NOLINTNEXTLINE
+  CHECK(hasKeys(&table, 0.5, 1, count));
+
+  freeTable(&table);
+  return true;
+}
+
+// holes go once they outnumber live entries 3 to 1, even if the hash
+// part isn’t sparse yet.
+static bool holesGoAtThreeToOne(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  // fill the hash part right up to its maximum load.
+  uint32_t next = 0;
+
+  while (true) {
+    // NOLINTNEXTLINE
+    tableSet(&table, NUM_VAL(next + 0.5), NIL_VAL);
+    next++;
+
+    const uint32_t cap = table.cap;
+
+    // NOLINTNEXTLINE
+    if (next >= HASHED_KEY_COUNT && next == cap - cap / 8) {
+      break;
+    }
+  }
+
+  const uint32_t cap = table.cap;
+
+  // the most live entries that 3 to 1 holes still allows.
+  uint32_t last = next / 4;
+  while ((next - last) / 3 < last) {
+    last--;
+  }
+
+  CHECK(last >= cap / 8);
+
+  uint32_t count = next;
+
+  while (count > last + 1) {
+    // NOLINTNEXTLINE
+    tableDel(&table, NUM_VAL(--count + 0.5));
+  }
+
+  CHECK(table.cap == cap && table.next == next);
+
+  // NOLINTNEXTLINE
+  tableDel(&table, NUM_VAL(--count + 0.5));
+
+  CHECK(table.next == count && table.count == count);
+
+  freeTable(&table);
+  return true;
+}
+
+static bool compactLeavesNoSpare(NeveVM *vm) {
+  IGNORE(vm);
+
+  Table table;
+  initTable(&table, 0);
+
+  // NOLINTNEXTLINE
+  setKeys(&table, 0.5, 1, HASHED_KEY_COUNT);
+
+  for (uint32_t i = 0; i < HASHED_KEY_COUNT; i += 2) {
+    // NOLINTNEXTLINE
+    tableDel(&table, NUM_VAL(i + 0.5));
+  }
+
+  const uint32_t live = table.count;
+  tableCompact(&table);
+
+  // no holes, no spare entries, and the fewest slots that can hold them.
+  CHECK(table.next == live && table.entryCap == live);
+  CHECK(live <= table.cap - table.cap / 8);
+  CHECK(live > table.cap / 2 - table.cap / 16);
+
+  // NOLINTNEXTLINE
+  CHECK(hasKeys(&table, 1.5, 2, live));
+
+  // an empty table lets go of everything.
+  for (uint32_t i = 1; i < HASHED_KEY_COUNT; i += 2) {
+    // NOLINTNEXTLINE
+    tableDel(&table, NUM_VAL(i + 0.5));
+  }
+
+  tableCompact(&table);
+
+  CHECK(table.cap == 0 && table.entryCap == 0 && table.arrCap == 0);
+
+  freeTable(&table);
+  return true;
+}
+
+void tableTests(void) {
+  const Test tests[] = {
+    {"tables/read-leaves-const-shared", readLeavesConstShared},
+    {"tables/nested-write-copies-once", nestedWriteCopiesOnce},
+    {"tables/int-keys-move-to-arr", intKeysMoveToArr},
+    {"tables/sparse-int-keys-stay-hashed", sparseIntKeysStayHashed},
+    {"tables/non-index-keys-stay-hashed", nonIndexKeysStayHashed},
+    {"tables/arr-iterates-first-in-order", arrIteratesFirstInOrder},
+    {"tables/arr-shrinks-under-eighth", arrShrinksUnderEighth},
+    {"tables/sparse-arr-moves-to-hash", sparseArrMovesToHash},
+    {"tables/hash-shrinks-under-eighth", hashShrinksUnderEighth},
+    {"tables/holes-go-at-three-to-one", holesGoAtThreeToOne},
+    {"tables/compact-leaves-no-spare", compactLeavesNoSpare}
+  };
+
+  runTests(tests, sizeof (tests) / sizeof (tests[0]));
+}
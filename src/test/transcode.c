@@ -0,0 +1,346 @@
+#include <string.h>
+
+#include "mem.h"
+#include "test.h"
+#include "transcode.h"
+
+// NOLINTBEGIN
+// long enough for the kernels to see several 16-byte blocks of each
+// encoding, and then a tail.
+#define MAX_CODE_POINTS 64
+
+// how far the start of a text is moved along, so that blocks begin at
+// every point of a run.
+#define MAX_SKIP 8
+
+#define ENCODING_COUNT 3
+// NOLINTEND
+
+// a text in all three encodings, written out one code point at a time.
+typedef struct {
+  char chars[ENCODING_COUNT][4 * MAX_CODE_POINTS];
+  uint32_t byteLength[ENCODING_COUNT];
+
+  // where each code point starts.
+  uint32_t offsets[ENCODING_COUNT][MAX_CODE_POINTS];
+  uint32_t length;
+} Text;
+
+// NOLINTBEGIN
+static void appendUtf8(Text *text, uint32_t codePoint) {
+  char *into = &text->chars[STR_UTF8][text->byteLength[STR_UTF8]];
+  uint32_t size;
+
+  if (codePoint < 0x80) {
+    into[0] = (char)codePoint;
+    size = 1;
+  } else if (codePoint < 0x800) {
+    into[0] = (char)(0xC0 | codePoint >> 6);
+    into[1] = (char)(0x80 | (codePoint & 0x3F));
+    size = 2;
+  } else if (codePoint < 0x10000) {
+    into[0] = (char)(0xE0 | codePoint >> 12);
+    into[1] = (char)(0x80 | (codePoint >> 6 & 0x3F));
+    into[2] = (char)(0x80 | (codePoint & 0x3F));
+    size = 3;
+  } else {
+    into[0] = (char)(0xF0 | codePoint >> 18);
+    into[1] = (char)(0x80 | (codePoint >> 12 & 0x3F));
+    into[2] = (char)(0x80 | (codePoint >> 6 & 0x3F));
+    into[3] = (char)(0x80 | (codePoint & 0x3F));
+    size = 4;
+  }
+
+  text->byteLength[STR_UTF8] += size;
+}
+
+static void appendUnit16(Text *text, uint32_t unit) {
+  char *into = &text->chars[STR_UTF16][text->byteLength[STR_UTF16]];
+
+  into[0] = (char)(unit & 0xFF);
+  into[1] = (char)(unit >> 8);
+
+  text->byteLength[STR_UTF16] += 2;
+}
+
+static void appendUtf16(Text *text, uint32_t codePoint) {
+  if (codePoint < 0x10000) {
+    appendUnit16(text, codePoint);
+    return;
+  }
+
+  appendUnit16(text, 0xD800 | (codePoint - 0x10000) >> 10);
+  appendUnit16(text, 0xDC00 | (codePoint & 0x3FF));
+}
+
+static void appendUtf32(Text *text, uint32_t codePoint) {
+  char *into = &text->chars[STR_UTF32][text->byteLength[STR_UTF32]];
+
+  for (uint32_t i = 0; i < 4; i++) {
+    into[i] = (char)(codePoint >> 8 * i & 0xFF);
+  }
+
+  text->byteLength[STR_UTF32] += 4;
+}
+// NOLINTEND
+
+static void initText(Text *text, const uint32_t *codePoints, uint32_t length) {
+  memset(text->byteLength, 0, sizeof (text->byteLength));
+  text->length = length;
+
+  for (uint32_t i = 0; i < length; i++) {
+    for (uint32_t encoding = 0; encoding < ENCODING_COUNT; encoding++) {
+      text->offsets[encoding][i] = text->byteLength[encoding];
+    }
+
+    appendUtf8(text, codePoints[i]);
+    appendUtf16(text, codePoints[i]);
+    appendUtf32(text, codePoints[i]);
+  }
+}
+
+// whether transcoding `text` from each encoding to each other one writes
+// exactly what it should, into a buffer no larger than transcodedCap().
+static bool transcodesExactly(const Text *text) {
+  for (uint32_t from = 0; from < ENCODING_COUNT; from++) {
+    for (uint32_t to = 0; to < ENCODING_COUNT; to++) {
+      if (from == to || text->length == 0) {
+        continue;
+      }
+
+      const size_t cap = transcodedCap(
+        (Encoding)from,
+        (Encoding)to,
+        text->byteLength[from]
+      );
+
+      char *into = ALLOC(char, cap);
+
+      const uint32_t written = transcode(
+        (Encoding)from,
+        (Encoding)to,
+        text->chars[from],
+        text->byteLength[from],
+        into
+      );
+
+      const bool isExact = (
+        written == text->byteLength[to] &&
+        memcmp(into, text->chars[to], written) == 0
+      );
+
+      FREE_ARR(char, into, cap);
+
+      if (!isExact) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// one text for each path through the kernels: all ASCII, all in the BMP
+// at each UTF-8 width, and with surrogate pairs.
+// NOLINTBEGIN
+static const uint32_t runs[][4] = {
+  {'a', 'b', 'c', 'd'},
+  {0xE9, 'x', 0xF6, 0x3A9},
+  {0x4E2D, 0xE9, 'x', 0xFFFD},
+  {0x1F600, 'a', 0x4E2D, 0x10FFFF},
+  {0xD7FF, 0xE000, 0x7FF, 0x800}
+};
+// NOLINTEND
+
+#define RUN_COUNT (sizeof (runs) / sizeof (runs[0]))
+
+// each run repeated, after `skip` ASCII code points, to `length`.
+static void initRunText(
+  Text *text,
+  size_t run,
+  uint32_t skip,
+  uint32_t length
+) {
+  uint32_t codePoints[MAX_CODE_POINTS];
+
+  for (uint32_t i = 0; i < length; i++) {
+    codePoints[i] = i < skip ? '.' : runs[run][(i - skip) % 4];
+  }
+
+  initText(text, codePoints, length);
+}
+
+static bool everyPairIsExact(NeveVM *vm) {
+  IGNORE(vm);
+
+  Text text;
+
+  for (size_t run = 0; run < RUN_COUNT; run++) {
+    for (uint32_t skip = 0; skip < MAX_SKIP; skip++) {
+      for (uint32_t length = skip; length <= MAX_CODE_POINTS; length++) {
+        initRunText(&text, run, skip, length);
+        CHECK(transcodesExactly(&text));
+      }
+    }
+  }
+
+  return true;
+}
+
+static bool validTextIsCounted(NeveVM *vm) {
+  IGNORE(vm);
+
+  Text text;
+
+  for (size_t run = 0; run < RUN_COUNT; run++) {
+    for (uint32_t length = 0; length <= MAX_CODE_POINTS; length++) {
+      initRunText(&text, run, 0, length);
+
+      for (uint32_t encoding = 0; encoding < ENCODING_COUNT; encoding++) {
+        uint32_t found = UINT32_MAX;
+
+        CHECK(validateStr(
+          (Encoding)encoding,
+          text.chars[encoding],
+          text.byteLength[encoding],
+          &found
+        ));
+
+        CHECK(found == length);
+      }
+    }
+  }
+
+  return true;
+}
+
+// whether `encoding` rejects `units`, put at every unit of some padding
+// in turn, with the padding both running on after them and not.
+static bool isRejectedAnywhere(
+  Encoding encoding,
+  const uint32_t *units,
+  uint32_t unitCount
+) {
+  const uint32_t unitSize = encoding == STR_UTF16 ? 2 : 4;
+
+  for (uint32_t at = 0; at < MAX_CODE_POINTS - unitCount; at++) {
+    char chars[4 * MAX_CODE_POINTS];
+
+    for (uint32_t i = 0; i < MAX_CODE_POINTS; i++) {
+      const uint32_t unit = (
+        i >= at && i < at + unitCount ? units[i - at] : 'a'
+      );
+
+      for (uint32_t byte = 0; byte < unitSize; byte++) {
+        // NOLINTNEXTLINE
+        chars[i * unitSize + byte] = (char)(unit >> 8 * byte & 0xFF);
+      }
+    }
+
+    uint32_t length;
+    const uint32_t end = (at + unitCount) * unitSize;
+
+    if (validateStr(encoding, chars, MAX_CODE_POINTS * unitSize, &length)) {
+      return false;
+    }
+
+    if (validateStr(encoding, chars, end, &length)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool malformedIsRejected(NeveVM *vm) {
+  IGNORE(vm);
+
+  // NOLINTBEGIN
+  const uint32_t loneHigh[] = {0xD800, 'a'};
+  const uint32_t loneLow[] = {0xDC00};
+  const uint32_t swapped[] = {0xDC00, 0xD800};
+  const uint32_t highAtEnd[] = {0xDBFF};
+
+  CHECK(isRejectedAnywhere(STR_UTF16, loneHigh, 2));
+  CHECK(isRejectedAnywhere(STR_UTF16, loneLow, 1));
+  CHECK(isRejectedAnywhere(STR_UTF16, swapped, 2));
+  CHECK(isRejectedAnywhere(STR_UTF16, highAtEnd, 1));
+
+  const uint32_t surrogate[] = {0xDFFF};
+  const uint32_t tooLarge[] = {0x110000};
+  const uint32_t allSet[] = {0xFFFFFFFF};
+
+  CHECK(isRejectedAnywhere(STR_UTF32, surrogate, 1));
+  CHECK(isRejectedAnywhere(STR_UTF32, tooLarge, 1));
+  CHECK(isRejectedAnywhere(STR_UTF32, allSet, 1));
+
+  // units cut short.
+  uint32_t length;
+  CHECK(!validateStr(STR_UTF16, "a\0b", 3, &length));
+  CHECK(!validateStr(STR_UTF32, "a\0\0\0b\0", 6, &length));
+  // NOLINTEND
+
+  return true;
+}
+
+static bool offsetsFindCodePoints(NeveVM *vm) {
+  IGNORE(vm);
+
+  Text text;
+
+  for (size_t run = 0; run < RUN_COUNT; run++) {
+    initRunText(&text, run, 0, MAX_CODE_POINTS);
+
+    for (uint32_t encoding = 0; encoding < ENCODING_COUNT; encoding++) {
+      const char *chars = text.chars[encoding];
+      const uint32_t byteLength = text.byteLength[encoding];
+      const uint32_t *offsets = text.offsets[encoding];
+
+      for (uint32_t i = 0; i < MAX_CODE_POINTS; i++) {
+        CHECK(codePointOffset(
+          (Encoding)encoding,
+          chars,
+          byteLength,
+          i
+        ) == offsets[i]);
+      }
+
+      CHECK(codePointOffset(
+        (Encoding)encoding,
+        chars,
+        byteLength,
+        MAX_CODE_POINTS
+      ) == byteLength);
+
+      // cutting anywhere backs up to the start of the code point it
+      // falls in.
+      uint32_t start = 0;
+
+      for (uint32_t cut = 0; cut < byteLength; cut++) {
+        if (start + 1 < MAX_CODE_POINTS && offsets[start + 1] <= cut) {
+          start++;
+        }
+
+        CHECK(wholeCodePoints(
+          (Encoding)encoding,
+          chars,
+          byteLength,
+          cut
+        ) == offsets[start]);
+      }
+    }
+  }
+
+  return true;
+}
+
+void transcodeTests(void) {
+  const Test tests[] = {
+    {"transcode/every-pair-is-exact", everyPairIsExact},
+    {"transcode/valid-text-is-counted", validTextIsCounted},
+    {"transcode/malformed-is-rejected", malformedIsRejected},
+    {"transcode/offsets-find-code-points", offsetsFindCodePoints}
+  };
+
+  runTests(tests, sizeof (tests) / sizeof (tests[0]));
+}
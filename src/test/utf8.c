@@ -0,0 +1,126 @@
+#include <string.h>
+
+#include "test.h"
+#include "utf8.h"
+
+// NOLINTBEGIN
+// long enough for every kernel to see a few full blocks and then a tail.
+#define TEXT_SIZE 100
+
+// wider than the widest kernel’s block, so that a sequence can be put
+// across each block boundary.
+#define PAD_SIZE 70
+// NOLINTEND
+
+static const Utf8Kernel kernels[] = {
+  UTF8_KERNEL_SCALAR,
+  UTF8_KERNEL_SSE2,
+  UTF8_KERNEL_SSSE3,
+  UTF8_KERNEL_AVX2
+};
+
+#define KERNEL_COUNT (sizeof (kernels) / sizeof (kernels[0]))
+
+// whether every kernel this CPU has agrees that `chars` is valid and has
+// `length` code points, or that it isn’t, if `length` is UINT32_MAX.
+static bool kernelsAgree(
+  const char *chars,
+  uint32_t byteLength,
+  uint32_t length
+) {
+  for (size_t i = 0; i < KERNEL_COUNT; i++) {
+    if (!hasUtf8Kernel(kernels[i])) {
+      continue;
+    }
+
+    uint32_t found = UINT32_MAX;
+    const bool isValid = validateUtf8With(
+      kernels[i],
+      chars,
+      byteLength,
+      &found
+    );
+
+    if (isValid != (length != UINT32_MAX) || (isValid && found != length)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool validTextIsCounted(NeveVM *vm) {
+  IGNORE(vm);
+
+  // one code point of each width, over and over.
+  const char *const pieces[] = {
+    "a", "\xC3\xA9", "\xE4\xB8\xAD", "\xF0\x9F\x98\x80"
+  };
+
+  char text[TEXT_SIZE + 4];
+  uint32_t starts[TEXT_SIZE + 4];
+  uint32_t byteLength = 0;
+  uint32_t length = 0;
+
+  while (byteLength < TEXT_SIZE) {
+    const char *piece = pieces[length % 4];
+
+    starts[length++] = byteLength;
+    memcpy(&text[byteLength], piece, strlen(piece));
+    byteLength += (uint32_t)strlen(piece);
+  }
+
+  // every prefix that ends between two code points, so that each kernel’s
+  // tail sees every length.
+  for (uint32_t i = 0; i < length; i++) {
+    CHECK(kernelsAgree(text, starts[i], i));
+  }
+
+  return true;
+}
+
+static bool malformedIsRejected(NeveVM *vm) {
+  IGNORE(vm);
+
+  const char *const malformed[] = {
+    "\x80",                 // a stray continuation byte
+    "\xC3",                 // cut short
+    "\xE4\xB8",             // cut short
+    "\xF0\x9F\x98",         // cut short
+    "\xC3\xA9\xA9",         // one continuation byte too many
+    "\xC0\xAF",             // overlong '/'
+    "\xE0\x80\xAF",         // overlong '/'
+    "\xF0\x80\x80\xAF",     // overlong '/'
+    "\xED\xA0\x80",         // a surrogate
+    "\xF4\x90\x80\x80",     // past U+10FFFF
+    "\xF8\x88\x80\x80\x80"  // a five-byte sequence
+  };
+
+  char text[2 * PAD_SIZE];
+
+  for (size_t i = 0; i < sizeof (malformed) / sizeof (malformed[0]); i++) {
+    const uint32_t size = (uint32_t)strlen(malformed[i]);
+
+    // ASCII around it, with the bad sequence at every offset.
+    for (uint32_t at = 0; at < PAD_SIZE; at++) {
+      memset(text, 'a', sizeof (text));
+      memcpy(&text[at], malformed[i], size);
+
+      CHECK(kernelsAgree(text, sizeof (text), UINT32_MAX));
+
+      // and right at the end.
+      CHECK(kernelsAgree(text, at + size, UINT32_MAX));
+    }
+  }
+
+  return true;
+}
+
+void utf8Tests(void) {
+  const Test tests[] = {
+    {"utf8/valid-text-is-counted", validTextIsCounted},
+    {"utf8/malformed-is-rejected", malformedIsRejected}
+  };
+
+  runTests(tests, sizeof (tests) / sizeof (tests[0]));
+}
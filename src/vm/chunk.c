@@ -133,3 +133,56 @@ int getLine(Chunk *ch, uint32_t offset) {
     }
   }
 }
+
+const char *opName(OpCode op) {
+  static const char *names[] = {
+    [OP_PUSH] = "push",
+    [OP_PUSHLONG] = "pushlong",
+    [OP_TRUE] = "true",
+    [OP_FALSE] = "false",
+    [OP_NIL] = "nil",
+    [OP_ZERO] = "zero",
+    [OP_ONE] = "one",
+    [OP_MINUSONE] = "minusone",
+    [OP_NEG] = "neg",
+    [OP_NOT] = "not",
+    [OP_ISNIL] = "isnil",
+    [OP_ISNOTNIL] = "isnotnil",
+    [OP_ISZ] = "isz",
+    [OP_SHOW] = "show",
+    [OP_ADD] = "add",
+    [OP_SUB] = "sub",
+    [OP_MUL] = "mul",
+    [OP_DIV] = "div",
+    [OP_SHL] = "shl",
+    [OP_SHR] = "shr",
+    [OP_BAND] = "band",
+    [OP_XOR] = "xor",
+    [OP_BOR] = "bor",
+    [OP_NEQ] = "neq",
+    [OP_EQ] = "eq",
+    [OP_GT] = "gt",
+    [OP_LT] = "lt",
+    [OP_GTE] = "gte",
+    [OP_LTE] = "lte",
+    [OP_CONCAT] = "concat",
+    [OP_UCONCAT] = "uconcat",
+    [OP_TABLENEW] = "tablenew",
+    [OP_TABLESET] = "tableset",
+    [OP_TABLEGET] = "tableget",
+    [OP_RET] = "ret",
+    [OP_CONCATN] = "concatn",
+    [OP_INTERP] = "interp",
+    [OP_SLICE] = "slice",
+    [OP_CHARAT] = "charat",
+    [OP_STRLEN] = "strlen"
+  };
+
+  const size_t count = sizeof (names) / sizeof (names[0]);
+
+  if ((size_t)op >= count || names[op] == NULL) {
+    return "?";
+  }
+
+  return names[op];
+}
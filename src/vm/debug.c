@@ -1,8 +1,21 @@
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #include "debug.h"
 #include "val.h"
+#include "vm.h"
+#include "writer.h"
+
+// the rest of the trace goes through stdio, so values are written out on
+// the spot rather than left sitting in a buffer.
+static void printDebugVal(Val val) {
+  Writer out;
+  initWriter(&out, STDOUT_FILENO);
+
+  printVal(&out, val);
+  freeWriter(&out);
+}
 
 static void printOffset(size_t offset) {
   printf("\n%4zu  ", offset);
@@ -13,7 +26,7 @@ static size_t printReg(Chunk *ch, Val *regs, size_t offset) {
   const Val val = regs[reg];
 
   printf("     r%u: ", reg);
-  printVal(val);
+  printDebugVal(val);
 
   return offset + 1;
 }
@@ -38,7 +51,7 @@ static size_t constInstr(
 
   printOffset(offset);
   printf("%-8s r%u  ", name, dest);
-  printVal(ch->consts.consts[constOffset]);
+  printDebugVal(ch->consts.consts[constOffset]);
   printf(" (%u)\n", constOffset);
 
   return offset + 1;
@@ -63,7 +76,7 @@ static size_t longConstInstr(
 
   printOffset(offset);
   printf("%-8s r%u", name, dest);
-  printVal(ch->consts.consts[constOffset]);
+  printDebugVal(ch->consts.consts[constOffset]);
   printf(" (%u)\n", constOffset);
 
   return offset + 1;
@@ -143,6 +156,53 @@ static size_t regByteInstr(
   return offset + 2;
 }
 
+static size_t regRangeInstr(
+  const char *name,
+  Chunk *ch,
+  Val *regs,
+  size_t offset
+) {
+  const uint8_t dest = ch->code[offset + 1];
+  const uint8_t first = ch->code[offset + 2];
+  const uint8_t count = ch->code[offset + 3];
+
+  printf("     r%u: ", dest);
+  printDebugVal(regs[dest]);
+
+  // the VM refuses ranges that run past the last register, but they’re
+  // traced before it gets the chance.
+  for (uint32_t i = 0; i < count && first + i < STACK_MAX; i++) {
+    printf("     r%u: ", first + i);
+    printDebugVal(regs[first + i]);
+  }
+
+  printOffset(offset);
+  printf("%-8s r%u r%u..r%u\n", name, dest, first, first + count - 1);
+
+  return offset + 4;
+}
+
+static size_t templateInstr(
+  const char *name,
+  Chunk *ch,
+  Val *regs,
+  size_t offset
+) {
+  const uint8_t dest = ch->code[offset + 1];
+  const uint8_t constOffset = ch->code[offset + 2];
+  const uint8_t first = ch->code[offset + 3];
+
+  printf("     r%u: ", dest);
+  printDebugVal(regs[dest]);
+
+  printOffset(offset);
+  printf("%-8s r%u ", name, dest);
+  printDebugVal(ch->consts.consts[constOffset]);
+  printf(" (%u) r%u\n", constOffset, first);
+
+  return offset + 4;
+}
+
 void disasmChunk(Chunk *ch, Val *regs, const char *name) {
   printf("%s:\n", name);
   size_t offset = 0;
@@ -219,6 +279,21 @@ size_t disasmInstr(Chunk *ch, Val *regs, size_t offset) {
     case OP_UCONCAT:
       return manyRegInstr("uconcat", ch, regs, offset, 3);
 
+    case OP_CONCATN:
+      return regRangeInstr("concatn", ch, regs, offset);
+
+    case OP_INTERP:
+      return templateInstr("interp", ch, regs, offset);
+
+    case OP_SLICE:
+      return manyRegInstr("slice", ch, regs, offset, 4);
+
+    case OP_CHARAT:
+      return manyRegInstr("charat", ch, regs, offset, 3);
+
+    case OP_STRLEN:
+      return manyRegInstr("strlen", ch, regs, offset, 2);
+
     case OP_SHL:
       return manyRegInstr("shl", ch, regs, offset, 3);
 
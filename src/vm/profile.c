@@ -0,0 +1,417 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chunk.h"
+#include "image.h"
+#include "mem.h"
+#include "profile.h"
+
+// NOLINTBEGIN
+#define HOT_COUNT   10
+
+// how many times the clock is read back to back to find what that costs.
+#define CALIBRATION_RUNS 1000
+
+// a line label and its "+".
+#define LINE_LABEL_SIZE 16
+
+// the offset that ends the debug header’s pairs.
+#define LAST_LINE_OFFSET 0xFFFFFFFF
+// NOLINTEND
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TICK_UNIT "cycles"
+#else
+#define TICK_UNIT "ns"
+#endif
+
+typedef struct {
+  uint32_t offset;
+  uint32_t line;
+} LinePair;
+
+// an opcode, a line or an instruction, with the time it’s estimated to
+// have taken.
+typedef struct {
+  uint32_t key;
+  uint32_t line;
+
+  uint64_t count;
+  double time;
+} Hot;
+
+typedef struct {
+  const char *srcPath;
+  uint16_t pathLength;
+
+  LinePair *pairs;
+  uint32_t pairCount;
+
+  // whether the assembler ran out of room for pairs, in which case the
+  // last one stands for every line after it as well.
+  bool isFull;
+} DebugLines;
+
+// the least it takes to read the clock twice in a row.
+static uint64_t measureTickOverhead(void) {
+  uint64_t least = UINT64_MAX;
+
+  for (uint32_t i = 0; i < CALIBRATION_RUNS; i++) {
+    const uint64_t start = profileTicks();
+    const uint64_t ticks = profileTicks() - start;
+
+    if (ticks < least) {
+      least = ticks;
+    }
+  }
+
+  return least;
+}
+
+void initProfile(Profile *profile) {
+  memset(profile, 0, sizeof (Profile));
+
+  profile->sampledOffset = NO_SAMPLE;
+
+  // NOLINTNEXTLINE
+  profile->rand = 0x2545F4914F6CDD1DULL;
+  profile->countdown = nextSamplePeriod(profile);
+}
+
+void startProfile(Profile *profile, const uint8_t *code) {
+  profile->code = code;
+  profile->tickOverhead = measureTickOverhead();
+}
+
+// the offset/line pairs of the debug header, which are in offset order.
+static DebugLines readDebugLines(Bytecode *bytecode) {
+  const uint8_t *bytes = bytecode->bytes;
+
+  // +2: skip the header’s length.
+  size_t offset = bytecode->debugHeaderOffset + sizeof (uint16_t);
+
+  DebugLines lines = {.pairs = NULL, .pairCount = 0, .isFull = false};
+
+  memcpy(&lines.pathLength, bytes + offset, sizeof (uint16_t));
+  offset += sizeof (uint16_t);
+
+  lines.srcPath = (const char *)bytes + offset;
+  offset += lines.pathLength;
+
+  uint32_t cap = 0;
+
+  while (true) {
+    LinePair pair;
+    memcpy(&pair.offset, bytes + offset, sizeof (uint32_t));
+
+    if (pair.offset == LAST_LINE_OFFSET) {
+      break;
+    }
+
+    memcpy(&pair.line, bytes + offset + sizeof (uint32_t), sizeof (uint32_t));
+    offset += 2 * sizeof (uint32_t);
+
+    if (lines.pairCount == cap) {
+      const uint32_t oldCap = cap;
+
+      cap = GROW_CAP(oldCap);
+      lines.pairs = GROW_ARR(LinePair, lines.pairs, oldCap, cap);
+    }
+
+    lines.pairs[lines.pairCount++] = pair;
+  }
+
+  lines.isFull =
+    (lines.pairCount + 1) * 2 * sizeof (uint32_t) > MAX_LINES_LENGTH;
+
+  // the count is all that’s needed to free them.
+  lines.pairs = GROW_ARR(LinePair, lines.pairs, cap, lines.pairCount);
+  return lines;
+}
+
+static int compareHotTimes(const void *a, const void *b) {
+  const Hot *hotA = a;
+  const Hot *hotB = b;
+
+  if (hotA->time != hotB->time) {
+    return hotA->time < hotB->time ? 1 : -1;
+  }
+
+  if (hotA->count != hotB->count) {
+    return hotA->count < hotB->count ? 1 : -1;
+  }
+
+  return hotA->key < hotB->key ? -1 : hotA->key > hotB->key;
+}
+
+static int compareSamples(const void *a, const void *b) {
+  const Sample *sampleA = a;
+  const Sample *sampleB = b;
+
+  return sampleA->offset < sampleB->offset ?
+    -1 : sampleA->offset > sampleB->offset;
+}
+
+static int compareHotLines(const void *a, const void *b) {
+  const Hot *hotA = a;
+  const Hot *hotB = b;
+
+  return hotA->line < hotB->line ? -1 : hotA->line > hotB->line;
+}
+
+static double percent(double part, double whole) {
+  // NOLINTNEXTLINE
+  return whole == 0 ? 0 : part * 100 / whole;
+}
+
+// `line`, marked with a "+" if it’s `mergedLine`, which stands for the
+// lines after it too.  no line is 0, so that means there isn’t one.
+static const char *lineLabel(
+  char label[LINE_LABEL_SIZE],
+  uint32_t line,
+  uint32_t mergedLine
+) {
+  snprintf(
+    label,
+    LINE_LABEL_SIZE,
+    "%u%s",
+    line,
+    mergedLine != 0 && line == mergedLine ? "+" : ""
+  );
+
+  return label;
+}
+
+// opcodes are timed on their own samples, so their estimates don’t depend
+// on how often the others were picked.
+static void reportOps(Profile *profile, uint64_t total) {
+  Hot hots[PROFILE_OPCODES];
+  uint32_t count = 0;
+  double time = 0;
+
+  for (uint32_t op = 0; op < PROFILE_OPCODES; op++) {
+    if (profile->opCounts[op] == 0) {
+      continue;
+    }
+
+    const double perOp = profile->opSamples[op] == 0 ? 0 :
+      (double)profile->opTicks[op] / (double)profile->opSamples[op];
+
+    const double opTime = perOp * (double)profile->opCounts[op];
+
+    hots[count++] = (Hot){op, 0, profile->opCounts[op], opTime};
+    time += opTime;
+  }
+
+  qsort(hots, count, sizeof (Hot), compareHotTimes);
+
+  fprintf(
+    stderr,
+    "\n%-12s %12s %7s %11s %7s\n",
+    "opcode",
+    "count",
+    "%",
+    TICK_UNIT "/op",
+    "time %"
+  );
+
+  for (uint32_t i = 0; i < count; i++) {
+    fprintf(
+      stderr,
+      "%-12s %12llu %6.1f%% %11.1f %6.1f%%\n",
+      opName((OpCode)hots[i].key),
+      (unsigned long long)hots[i].count,
+      percent((double)hots[i].count, (double)total),
+      hots[i].time / (double)hots[i].count,
+      percent(hots[i].time, time)
+    );
+  }
+}
+
+// keeps the HOT_COUNT hottest of what it’s given in `top`, hottest first.
+static void keepHot(Hot *top, uint32_t *count, Hot hot) {
+  if (
+    *count == HOT_COUNT &&
+    compareHotTimes(&hot, &top[HOT_COUNT - 1]) >= 0
+  ) {
+    return;
+  }
+
+  uint32_t i = *count < HOT_COUNT ? (*count)++ : HOT_COUNT - 1;
+
+  for (; i > 0 && compareHotTimes(&hot, &top[i - 1]) < 0; i--) {
+    top[i] = top[i - 1];
+  }
+
+  top[i] = hot;
+}
+
+// `hots` has an entry per offset/line pair, and one more for code before
+// the first pair; pairs that share a line are merged here.  counts are
+// scaled up from the kept samples by `scale`.
+static void reportLines(
+  Hot *hots,
+  uint32_t count,
+  double time,
+  double scale,
+  uint32_t mergedLine
+) {
+  qsort(hots, count, sizeof (Hot), compareHotLines);
+
+  uint32_t merged = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (merged != 0 && hots[merged - 1].line == hots[i].line) {
+      hots[merged - 1].count += hots[i].count;
+      hots[merged - 1].time += hots[i].time;
+    } else {
+      hots[merged++] = hots[i];
+    }
+  }
+
+  qsort(hots, merged, sizeof (Hot), compareHotTimes);
+
+  fprintf(stderr, "\n%-12s %12s %7s\n", "line", "~count", "time %");
+
+  for (uint32_t i = 0; i < merged && i < HOT_COUNT; i++) {
+    if (hots[i].count == 0) {
+      break;
+    }
+
+    char label[LINE_LABEL_SIZE];
+
+    fprintf(
+      stderr,
+      "%-12s %12.0f %6.1f%%\n",
+      lineLabel(label, hots[i].line, mergedLine),
+      (double)hots[i].count * scale,
+      percent(hots[i].time, time)
+    );
+  }
+}
+
+static void reportInstrs(
+  Profile *profile,
+  Hot *hots,
+  uint32_t count,
+  double time,
+  double scale,
+  uint32_t mergedLine
+) {
+  fprintf(
+    stderr,
+    "\n%-12s %-8s %-10s %12s %7s\n",
+    "offset",
+    "line",
+    "opcode",
+    "~count",
+    "time %"
+  );
+
+  for (uint32_t i = 0; i < count; i++) {
+    char label[LINE_LABEL_SIZE];
+
+    fprintf(
+      stderr,
+      "%-12u %-8s %-10s %12.0f %6.1f%%\n",
+      hots[i].key,
+      lineLabel(label, hots[i].line, mergedLine),
+      opName((OpCode)profile->code[hots[i].key]),
+      (double)hots[i].count * scale,
+      percent(hots[i].time, time)
+    );
+  }
+}
+
+void reportProfile(Profile *profile, Bytecode *bytecode) {
+  DebugLines lines = readDebugLines(bytecode);
+
+  // in offset order, so that they can be matched up with the pairs.
+  qsort(profile->kept, profile->keptCount, sizeof (Sample), compareSamples);
+
+  // the last entry is for code that comes before the first pair.
+  const uint32_t lineCount = lines.pairCount + 1;
+  Hot *byLine = ALLOC(Hot, lineCount);
+
+  for (uint32_t i = 0; i < lines.pairCount; i++) {
+    byLine[i] = (Hot){i, lines.pairs[i].line, 0, 0};
+  }
+
+  byLine[lines.pairCount] = (Hot){lines.pairCount, 0, 0, 0};
+
+  uint64_t total = 0;
+
+  for (uint32_t op = 0; op < PROFILE_OPCODES; op++) {
+    total += profile->opCounts[op];
+  }
+
+  Hot hottest[HOT_COUNT];
+  uint32_t hotCount = 0;
+
+  // lines and instructions only have the kept samples to go by.  each of
+  // those stands for the same share of everything that ran.
+  const double scale = profile->keptCount == 0 ?
+    0 : (double)total / (double)profile->keptCount;
+
+  double time = 0;
+  uint32_t nextPair = 0;
+
+  for (uint32_t i = 0; i < profile->keptCount;) {
+    const uint32_t offset = profile->kept[i].offset;
+
+    // pairs are in offset order, so this only ever moves forward.
+    while (
+      nextPair < lines.pairCount &&
+      lines.pairs[nextPair].offset <= offset
+    ) {
+      nextPair++;
+    }
+
+    uint64_t count = 0;
+    uint64_t ticks = 0;
+
+    for (; i < profile->keptCount && profile->kept[i].offset == offset; i++) {
+      ticks += profile->kept[i].ticks;
+      count++;
+    }
+
+    const uint32_t pair = nextPair == 0 ? lines.pairCount : nextPair - 1;
+    const Hot hot = {offset, byLine[pair].line, count, (double)ticks};
+
+    byLine[pair].count += hot.count;
+    byLine[pair].time += hot.time;
+    time += hot.time;
+
+    keepHot(hottest, &hotCount, hot);
+  }
+
+  fprintf(
+    stderr,
+    "\nprofile of %.*s: %llu instructions, %llu timed\n",
+    lines.pathLength,
+    lines.srcPath,
+    (unsigned long long)total,
+    (unsigned long long)profile->sampleCount
+  );
+
+  const uint32_t mergedLine =
+    lines.isFull ? lines.pairs[lines.pairCount - 1].line : 0;
+
+  if (lines.isFull) {
+    fprintf(
+      stderr,
+      "the debug header has no lines past offset %u, so line %u+ also\n"
+      "counts every line after it\n",
+      lines.pairs[lines.pairCount - 1].offset,
+      mergedLine
+    );
+  }
+
+  reportOps(profile, total);
+  reportLines(byLine, lineCount, time, scale, mergedLine);
+  reportInstrs(profile, hottest, hotCount, time, scale, mergedLine);
+
+  FREE_ARR(Hot, byLine, lineCount);
+  FREE_ARR(LinePair, lines.pairs, lines.pairCount);
+}
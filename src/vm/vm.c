@@ -1,11 +1,14 @@
-#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "common.h"
 #include "compiler.h"
 #include "err.h"
+#include "hash.h"
 #include "mem.h"
 #include "obj.h"
+#include "transcode.h"
+#include "utf8.h"
 #include "vm.h"
 
 #ifdef DEBUG_EXEC
@@ -14,15 +17,16 @@
 
 #ifdef DEBUG_EXEC
 static void printStack(NeveVM *vm) {
-  printf("    ");
+  WRITER_APPEND_LIT(&vm->out, "    ");
 
   for (Val *v = vm->regs; v < vm->top; v++) {
-    printf("[");
-    printVal(*v);
-    printf("] ");
+    WRITER_APPEND_LIT(&vm->out, "[");
+    printVal(&vm->out, *v);
+    WRITER_APPEND_LIT(&vm->out, "] ");
   } 
 
-  printf("\n");
+  WRITER_APPEND_LIT(&vm->out, "\n");
+  writerFlush(&vm->out);
 }
 #endif
 
@@ -31,14 +35,17 @@ NeveVM newVM() {
     .objs = NULL
   };
 
-  initTable(&vm.strs, 0);
+  initHashSeed();
+  initInternSet(&vm.strs);
+  initWriter(&vm.out, STDOUT_FILENO);
 
   return vm;
 }
 
 void freeVM(NeveVM *vm) {
   freeObjs(vm->objs);
-  freeTable(&vm->strs);
+  freeInternSet(&vm->strs);
+  freeWriter(&vm->out);
 
   vm->objs = NULL;
 }
@@ -50,67 +57,277 @@ void resetStack(NeveVM *vm) {
 #define READ_BYTE() (*vm->ip++)
 #define READ_CONST() (vm->ch->consts.consts[READ_BYTE()])
 
+// only strings that may end up interned are worth hashing right away; 
+// everything else gets hashed by hashObj() if it’s ever used as a key.
+static Val newStrVal(
+  NeveVM *vm,
+  Encoding encoding,
+  char *chars,
+  uint32_t length,
+  uint32_t byteLength
+) {
+  const bool isInterned = byteLength <= MAX_INTERNED_STR_SIZE;
+  const uint32_t hash = (
+    isInterned ? hashStr(chars, byteLength) : STR_UNHASHED
+  );
+
+  return OBJ_VAL(allocStr(
+    vm,
+    true,
+    isInterned,
+    encoding,
+    chars,
+    length,
+    byteLength,
+    hash
+  ));
+}
+
+// serves both OP_CONCAT and OP_UCONCAT now that every encoding shares the
+// same string layout.  the result keeps the left operand’s encoding; the 
+// right one is transcoded to it if need be.
 static void concat(NeveVM *vm) {
   uint8_t regC = READ_BYTE();
 
   ObjStr *a = VAL_AS_STR(vm->regs[READ_BYTE()]);
   ObjStr *b = VAL_AS_STR(vm->regs[READ_BYTE()]);
 
+  const Encoding encoding = STR_ENCODING(a);
+  b = reencodeStr(vm, b, encoding);
+
   uint32_t length = a->length + b->length;
+  uint32_t byteLength = a->byteLength + b->byteLength;
+
+  // long results are left as ropes so that repeated appends don’t keep 
+  // copying (and hashing) everything built so far.  shorter results can’t
+  // have a rope as an operand, so copying them right away is safe.
+  if (byteLength >= MIN_ROPE_SIZE) {
+    vm->regs[regC] = OBJ_VAL(allocRope(vm, a, b));
+    return;
+  }
 
-  char *chars = ALLOC(char, length + 1);
+  char *chars = ALLOC(char, byteLength + 1);
 
-  memcpy(chars, a->chars, a->length);
-  memcpy(chars + a->length, b->chars, b->length);
+  memcpy(chars, a->chars, a->byteLength);
+  memcpy(chars + a->byteLength, b->chars, b->byteLength);
+
+  chars[byteLength] = '\0';
+
+  vm->regs[regC] = newStrVal(vm, encoding, chars, length, byteLength);
+}
 
-  chars[length] = '\0';
+// strings are spliced in as they are (transcoded to UTF-8 if need be), 
+// anything else the way OP_SHOW would render it.  returns the logical 
+// length it added.
+static uint32_t writePiece(StrBuf *buf, Val val) {
+  if (IS_VAL_STR(val)) {
+    ObjStr *str = VAL_AS_STR(val);
+    strAsUtf8(buf, str);
 
-  uint32_t hash = hashStr(chars, length);
+    return str->length;
+  }
 
-  const bool isInterned = length <= MAX_INTERNED_STR_SIZE;
+  const uint32_t start = buf->length;
+  valAsStr(buf, val);
 
-  ObjStr *result = allocStr(vm, true, isInterned, chars, length, hash);
-  vm->regs[regC] = OBJ_VAL(result);
+  // shown tables may hold strings that aren’t ASCII.
+  return countUtf8(buf->chars + start, buf->length - start);
 }
 
-static void uConcat(NeveVM *vm) {
-  uint8_t regC = READ_BYTE();
+// string pieces are the only ones whose size is known without rendering 
+// them, and usually the bulk of the result.
+static uint32_t pieceSizeHint(Val val) {
+  return IS_VAL_STR(val) ? VAL_AS_STR(val)->byteLength : 0;
+}
+
+static Val takeStrVal(NeveVM *vm, StrBuf *buf, uint32_t length) {
+  const uint32_t byteLength = buf->length;
 
-  ObjUStr *a = VAL_AS_USTR(vm->regs[READ_BYTE()]);
-  ObjUStr *b = VAL_AS_USTR(vm->regs[READ_BYTE()]);
+  return newStrVal(vm, STR_UTF8, strBufTake(buf), length, byteLength);
+}
 
-  const Encoding encoding = a->encoding;
+// the register range comes straight from the bytecode, so it’s checked
+// before anything is read from it.  returns false if it runs past the
+// last register.
+static bool concatN(NeveVM *vm) {
+  const uint8_t destReg = READ_BYTE();
+  const uint8_t firstReg = READ_BYTE();
+  const uint8_t count = READ_BYTE();
 
-  uint32_t length = a->length + b->length;
-  uint32_t byteLength = a->byteLength + b->byteLength;
+  if (firstReg + count > STACK_MAX) {
+    return false;
+  }
 
-  void *chars = ALLOC(char, byteLength + 1);
+  const Val *vals = &vm->regs[firstReg];
 
-  memcpy(chars, a->chars, a->byteLength);
-  memcpy((char *)chars + a->byteLength, b->chars, b->byteLength);
+  uint32_t sizeHint = 0;
+
+  for (uint8_t i = 0; i < count; i++) {
+    sizeHint += pieceSizeHint(vals[i]);
+  }
+
+  StrBuf buf;
+  initStrBuf(&buf, sizeHint);
 
-  memset((char *)chars + byteLength, '\0', 1);
+  uint32_t length = 0;
 
-  uint32_t hash = hashStr(chars, length);
+  for (uint8_t i = 0; i < count; i++) {
+    length += writePiece(&buf, vals[i]);
+  }
+
+  vm->regs[destReg] = takeStrVal(vm, &buf, length);
+  return true;
+}
+
+static bool isPlaceholder(ObjStr *template, uint32_t i) {
+  return (
+    i + 1 < template->byteLength &&
+    template->chars[i] == '{' &&
+    template->chars[i + 1] == '}'
+  );
+}
+
+// each placeholder takes the next register after `firstReg`, so a template
+// with too many of them for the registers left is rejected the same way
+// as an OP_CONCATN range that runs past the end.
+static bool interp(NeveVM *vm) {
+  const uint8_t destReg = READ_BYTE();
+
+  // placeholders are looked for byte by byte.
+  ObjStr *template = reencodeStr(vm, VAL_AS_STR(READ_CONST()), STR_UTF8);
+  const uint8_t firstReg = READ_BYTE();
+
+  const Val *vals = &vm->regs[firstReg];
+
+  uint32_t sizeHint = template->byteLength;
+  uint32_t placeholders = 0;
+
+  for (uint32_t i = 0; i < template->byteLength; i++) {
+    if (!isPlaceholder(template, i)) {
+      continue;
+    }
+
+    if (firstReg + placeholders >= STACK_MAX) {
+      return false;
+    }
+
+    sizeHint += pieceSizeHint(vals[placeholders++]);
+    i++;
+  }
 
-  const bool isInterned = length <= MAX_INTERNED_STR_SIZE; 
+  StrBuf buf;
+  initStrBuf(&buf, sizeHint);
+
+  // each "{}" is two bytes and two code points that won’t make it out.
+  uint32_t length = template->length - 2 * placeholders;
+
+  uint32_t next = 0;
+  uint32_t start = 0;
+
+  for (uint32_t i = 0; i < template->byteLength; i++) {
+    if (!isPlaceholder(template, i)) {
+      continue;
+    }
+
+    strBufAppend(&buf, template->chars + start, i - start);
+    length += writePiece(&buf, vals[next++]);
+
+    i++;
+    start = i + 1;
+  }
+
+  strBufAppend(
+    &buf,
+    template->chars + start,
+    template->byteLength - start
+  );
+
+  vm->regs[destReg] = takeStrVal(vm, &buf, length);
+  return true;
+}
+
+// indices are clamped to the string, so out-of-range slices come out 
+// short or empty instead of reading past it.
+static uint32_t clampIndex(Val val, uint32_t length) {
+  const double index = VAL_AS_NUM(val);
+
+  if (!(index > 0)) {
+    return 0;
+  }
+
+  return index >= length ? length : (uint32_t)index;
+}
 
-  ObjUStr *result = allocUStr(
+static void slice(NeveVM *vm) {
+  const uint8_t destReg = READ_BYTE();
+  ObjStr *str = VAL_AS_STR(vm->regs[READ_BYTE()]);
+
+  const uint32_t start = clampIndex(vm->regs[READ_BYTE()], str->length);
+  const uint32_t end = clampIndex(vm->regs[READ_BYTE()], str->length);
+
+  vm->regs[destReg] = OBJ_VAL(sliceStr(
     vm,
-    true,
-    isInterned,
+    str,
+    start,
+    end < start ? start : end
+  ));
+}
+
+static void charAt(NeveVM *vm) {
+  const uint8_t destReg = READ_BYTE();
+  ObjStr *str = VAL_AS_STR(vm->regs[READ_BYTE()]);
+  const double index = VAL_AS_NUM(vm->regs[READ_BYTE()]);
+
+  if (!(index >= 0 && index < str->length)) {
+    vm->regs[destReg] = NIL_VAL;
+    return;
+  }
+
+  flattenStr(str);
+
+  const Encoding encoding = STR_ENCODING(str);
+  const uint32_t from = strOffset(str, (uint32_t)index);
+
+  const uint32_t byteLength = codePointOffset(
     encoding,
-    chars,
-    length,
-    byteLength,
-    hash
+    str->chars + from,
+    str->byteLength - from,
+    1
   );
 
-  vm->regs[regC] = OBJ_VAL(result);
+  char *chars = ALLOC(char, byteLength + 1);
+
+  memcpy(chars, str->chars + from, byteLength);
+  chars[byteLength] = '\0';
+
+  vm->regs[destReg] = newStrVal(vm, encoding, chars, 1, byteLength);
+}
+
+static Val settledVal(NeveVM *vm, Val val, bool isKey) {
+  if (!IS_VAL_STR(val)) {
+    return val;
+  }
+
+  return OBJ_VAL(settleStr(vm, VAL_AS_STR(val), isKey));
+}
+
+// whatever gets pushed may be written to later, so table constants hand 
+// out shared tables instead of themselves.
+static Val pushedConst(NeveVM *vm, Val val) {
+  if (!IS_VAL_TABLE(val)) {
+    return val;
+  }
+
+  return OBJ_VAL(shareTable(vm, VAL_AS_TABLE(val), NULL));
 }
 
+// `isProfiled` is always a constant, and run() is always inlined, so the
+// unprofiled copy of the loop has no trace of the profiler.
 // NOLINTBEGIN
-static Aftermath run(NeveVM *vm) {
+static inline __attribute__((always_inline)) Aftermath run(
+  NeveVM *vm,
+  const bool isProfiled
+) {
 #define BIN_OP(valType, op)                                                   \
   do {                                                                        \
     const uint8_t regC = READ_BYTE();                                         \
@@ -140,33 +357,38 @@ static Aftermath run(NeveVM *vm) {
     disasmInstr(vm->ch, vm->regs, offset);
 #endif
 
+    if (isProfiled) {
+      profileInstr(
+        vm->profile,
+        *vm->ip,
+        (uint32_t)(vm->ip - vm->ch->code)
+      );
+    }
+
     const uint8_t instr = READ_BYTE();
 
     switch (instr) {
       case OP_PUSH: {
         const uint8_t reg = READ_BYTE();
 
-        vm->regs[reg] = READ_CONST();
+        vm->regs[reg] = pushedConst(vm, READ_CONST());
         break;
       }
       
       case OP_PUSHLONG: {
-        Chunk *ch = vm->ch;
-
-#ifndef DEBUG_EXEC
-        const uint32_t offset = (uint32_t)(vm->ip - vm->ch->code);
-#endif
-
+        // the index comes first, least significant byte first.
         const uint8_t byteLength = 8;
         const uint32_t constOffset = (uint32_t)(
-          ch->code[offset + 1] |
-          (ch->code[offset + 2] << byteLength) |
-          (ch->code[offset + 3] << byteLength * 2)
+          vm->ip[0] |
+          (vm->ip[1] << byteLength) |
+          (vm->ip[2] << byteLength * 2)
         );
 
-        const Val val = ch->consts.consts[constOffset]; 
+        vm->ip += 3;
 
-        vm->regs[READ_BYTE()] = val;
+        const Val val = vm->ch->consts.consts[constOffset]; 
+
+        vm->regs[READ_BYTE()] = pushedConst(vm, val);
         break;
       }
 
@@ -217,18 +439,13 @@ static Aftermath run(NeveVM *vm) {
         const uint8_t destReg = READ_BYTE();
         const Val val = vm->regs[READ_BYTE()];
 
-        const uint32_t size = valStrLength(val);
-        char *buffer = ALLOC(char, size + 1);
-
-        uint32_t finalSize = valAsStr(buffer, size, val);
+        StrBuf buf;
+        initStrBuf(&buf, 0);
 
-        const bool isInterned = finalSize <= MAX_INTERNED_STR_SIZE;
-
-        uint32_t hash = hashStr(buffer, finalSize);
-        vm->regs[destReg] = OBJ_VAL(
-          allocStr(vm, true, isInterned, buffer, finalSize, hash)
-        );
+        valAsStr(&buf, val);
 
+        const uint32_t length = countUtf8(buf.chars, buf.length);
+        vm->regs[destReg] = takeStrVal(vm, &buf, length);
         break;
       }
 
@@ -253,9 +470,39 @@ static Aftermath run(NeveVM *vm) {
         break;
 
       case OP_UCONCAT:
-        uConcat(vm);
+        concat(vm);
+        break;
+
+      case OP_CONCATN:
+        if (!concatN(vm)) {
+          return AFTERMATH_RUNTIME_ERR;
+        }
+
+        break;
+
+      case OP_INTERP:
+        if (!interp(vm)) {
+          return AFTERMATH_RUNTIME_ERR;
+        }
+
+        break;
+
+      case OP_SLICE:
+        slice(vm);
+        break;
+
+      case OP_CHARAT:
+        charAt(vm);
         break;
 
+      case OP_STRLEN: {
+        const uint8_t destReg = READ_BYTE();
+        const ObjStr *str = VAL_AS_STR(vm->regs[READ_BYTE()]);
+
+        vm->regs[destReg] = NUM_VAL(str->length);
+        break;
+      }
+
       case OP_SHL:
         BIT_OP(<<);
         break;
@@ -325,18 +572,53 @@ static Aftermath run(NeveVM *vm) {
       }
 
       case OP_TABLESET: {
-        ObjTable *table = VAL_AS_TABLE(vm->regs[READ_BYTE()]);
+        ObjTable *obj = VAL_AS_TABLE(vm->regs[READ_BYTE()]);
+        if (IS_TABLE_SHARED(obj)) {
+          unshareTable(obj);
+        }
+
+        Table *table = obj->table;
+        Val key = settledVal(vm, vm->regs[READ_BYTE()], true);
+        Val val = settledVal(vm, vm->regs[READ_BYTE()], false);
+
+        // overwriting a list element is just a store.
+        Val *slot = tableArrSlot(table, key);
+        if (slot != NULL && !IS_VAL_EMPTY(*slot)) {
+          *slot = val;
+          break;
+        }
+
+        tableSet(table, key, val);
+        break;
+      }
+
+      case OP_TABLEGET: {
+        const uint8_t dest = READ_BYTE();
+
+        ObjTable *obj = VAL_AS_TABLE(vm->regs[READ_BYTE()]);
         Val key = vm->regs[READ_BYTE()];
 
-        tableSet(table->table, key, vm->regs[READ_BYTE()]);
+        const Val *slot = tableArrSlot(obj->table, key);
+
+        Val val = slot == NULL ? tableGet(obj->table, key) : (
+          IS_VAL_EMPTY(*slot) ? NIL_VAL : *slot
+        );
+
+        // tables inside a constant table are constants too.
+        if (IS_VAL_TABLE(val) && IS_TABLE_CONST(VAL_AS_TABLE(val))) {
+          val = shareField(vm, obj, key, VAL_AS_TABLE(val));
+        }
+
+        vm->regs[dest] = val;
         break;
       }
 
       case OP_RET: {
         Val val = vm->regs[READ_BYTE()];
 
-        printVal(val);
-        printf("\n");
+        printVal(&vm->out, val);
+        WRITER_APPEND_LIT(&vm->out, "\n");
+        writerFlush(&vm->out);
 
         return AFTERMATH_OK;
       }
@@ -366,7 +648,11 @@ Aftermath interpret(const char *fname, NeveVM *vm, Bytecode *bytecode) {
   vm->ch = &ch;
   vm->ip = ch.code;
 
-  Aftermath aftermath = run(vm);
+  if (vm->profile != NULL) {
+    startProfile(vm->profile, ch.code);
+  }
+
+  Aftermath aftermath = vm->profile == NULL ? run(vm, false) : run(vm, true);
 
   if (aftermath != AFTERMATH_OK) {
     const uint32_t offset = (uint32_t)(vm->ip - vm->ch->code);
@@ -387,6 +673,5 @@ Aftermath interpret(const char *fname, NeveVM *vm, Bytecode *bytecode) {
 
   freeChunk(&ch);
 
-  IGNORE(run);
-  return AFTERMATH_OK;
+  return aftermath;
 }